@@ -0,0 +1,139 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/dma.h>
+
+#include <arch/hardware.h>
+#include <arch/interrupt.h>
+#include <arch-generic/dma.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* maximum amount of transfers per descriptor (CTRLA.BTSIZE is 16 bits wide) */
+#define DMA_BTSIZE_MAX 0xffff
+
+/* channels with a transfer in flight, for the irq handler */
+static struct dma_chan *dma_running[DMA_NCHAN];
+
+int arch_dma_init(void)
+{
+	/* enable peripheral clock for the DMAC (PID is taken from Atmel Datasheet, Section 9.1 */
+	PMC->PMC_PCER1 = PMC_PCER1_PID39;
+
+	DMAC->DMAC_EN = 0;
+	DMAC->DMAC_CHDR = DMAC_CHDR_DIS0 | DMAC_CHDR_DIS1 | DMAC_CHDR_DIS2
+			| DMAC_CHDR_DIS3 | DMAC_CHDR_DIS4 | DMAC_CHDR_DIS5;
+	DMAC->DMAC_EBCIDR = 0xffffffff;
+	/* reading the status register clears all pending flags */
+	(void)DMAC->DMAC_EBCISR;
+
+	DMAC->DMAC_GCFG = DMAC_GCFG_ARB_CFG_ROUND_ROBIN;
+	DMAC->DMAC_EN = DMAC_EN_ENABLE;
+
+	NVIC_EnableIRQ(DMAC_IRQn);
+	return 0;
+}
+
+size_t arch_dma_desc_init(struct dma_desc *desc, void *dest, const void *src, size_t len)
+{
+	uintptr_t align = (uintptr_t)dest | (uintptr_t)src;
+	unsigned int shift;
+	uint32_t width;
+
+	/* use the widest transfers that the alignment of both ends allows */
+	if ((align & 3) == 0 && len >= 4) {
+		shift = 2;
+		width = DMAC_CTRLA_SRC_WIDTH_WORD | DMAC_CTRLA_DST_WIDTH_WORD;
+	} else if ((align & 1) == 0 && len >= 2) {
+		shift = 1;
+		width = DMAC_CTRLA_SRC_WIDTH_HALF_WORD | DMAC_CTRLA_DST_WIDTH_HALF_WORD;
+	} else {
+		shift = 0;
+		width = DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+	}
+
+	size_t count = len >> shift;
+	if (count > DMA_BTSIZE_MAX)
+		count = DMA_BTSIZE_MAX;
+
+	desc->saddr = (uint32_t)src;
+	desc->daddr = (uint32_t)dest;
+	desc->ctrla = DMAC_CTRLA_BTSIZE(count) | DMAC_CTRLA_SCSIZE_CHK_1
+		    | DMAC_CTRLA_DCSIZE_CHK_1 | width;
+	desc->ctrlb = DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM | DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM
+		    | DMAC_CTRLB_FC_MEM2MEM_DMA_FC
+		    | DMAC_CTRLB_SRC_INCR_INCREMENTING | DMAC_CTRLB_DST_INCR_INCREMENTING;
+	desc->dscr = 0;
+
+	return count << shift;
+}
+
+void arch_dma_desc_chain(struct dma_desc *desc, struct dma_desc *next)
+{
+	desc->dscr = (uint32_t)next;
+}
+
+int arch_dma_start(struct dma_chan *chan, struct dma_desc *desc)
+{
+	unsigned int id = chan->id;
+
+	if (DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << id))
+		return -EBUSY;
+
+	dma_running[id] = chan;
+
+	/* the first buffer is loaded directly, the rest is fetched through dscr */
+	DMAC->DMAC_CH_NUM[id].DMAC_SADDR = desc->saddr;
+	DMAC->DMAC_CH_NUM[id].DMAC_DADDR = desc->daddr;
+	DMAC->DMAC_CH_NUM[id].DMAC_DSCR = desc->dscr;
+	DMAC->DMAC_CH_NUM[id].DMAC_CTRLA = desc->ctrla;
+	DMAC->DMAC_CH_NUM[id].DMAC_CTRLB = desc->ctrlb;
+	DMAC->DMAC_CH_NUM[id].DMAC_CFG = DMAC_CFG_AHB_PROT(1) | DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+	/* CBTC fires once the descriptor with dscr == 0 is done */
+	DMAC->DMAC_EBCIER = (DMAC_EBCIER_CBTC0 | DMAC_EBCIER_ERR0) << id;
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << id;
+
+	return 0;
+}
+
+void irq_dmac(void)
+{
+	__irq_enter();
+
+	/* reading the status register clears it, so handle every channel at once */
+	uint32_t state = DMAC->DMAC_EBCISR & DMAC->DMAC_EBCIMR;
+
+	for (unsigned int id = 0; id < DMA_NCHAN; id++) {
+		uint32_t done = DMAC_EBCISR_CBTC0 << id;
+		uint32_t err = DMAC_EBCISR_ERR0 << id;
+
+		if ((state & (done | err)) == 0)
+			continue;
+
+		DMAC->DMAC_EBCIDR = done | err;
+		if (state & err)
+			DMAC->DMAC_CHDR = DMAC_CHDR_DIS0 << id;
+
+		struct dma_chan *chan = dma_running[id];
+		dma_running[id] = NULL;
+		if (chan != NULL)
+			dma_chan_complete(chan, (state & err) ? -EIO : 0);
+	}
+
+	__irq_leave();
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
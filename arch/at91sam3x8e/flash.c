@@ -0,0 +1,193 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file flash.c
+ * @brief Storage area in the internal flash, programmed through EEFC1.
+ *
+ * The SAM3X8E has two flash banks with one controller each.  The kernel image
+ * lives in bank 0 (see the assertion in flash.ld), and the storage area is
+ * the last `FLASH_STORAGE_PAGES` pages of bank 1.  That way, we can keep
+ * executing code while bank 1 is being programmed, and other tasks keep
+ * running instead of the whole system stalling for several milliseconds.
+ */
+
+#include <ardix/device.h>
+#include <ardix/flash.h>
+#include <ardix/kevent.h>
+#include <ardix/sched.h>
+#include <ardix/task.h>
+
+#include <arch/hardware.h>
+#include <arch/interrupt.h>
+#include <arch-generic/flash.h>
+#include <arch-generic/sched.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if FLASH_STORAGE_PAGES > IFLASH1_NB_OF_PAGES
+#error "Flash storage area is larger than flash bank 1"
+#endif
+
+#define EFC1_FIRST_PAGE (IFLASH1_NB_OF_PAGES - FLASH_STORAGE_PAGES)
+#define EFC1_PAGE_ADDR(page) ( IFLASH1_ADDR + ((EFC1_FIRST_PAGE + (page)) * IFLASH1_PAGE_SIZE) )
+
+/** EEFC command key, see Atmel Datasheet, Section 18.5.3 */
+#define EEFC_KEY		0x5a
+/** Write page command (the page must have been erased before) */
+#define EEFC_CMD_WP		0x01
+/** Erase page and write page command */
+#define EEFC_CMD_EWP		0x03
+
+/* how long we wait for a command before checking again in case the kevent got lost */
+#define EFC1_TIMEOUT_MS		10
+
+static struct flash efc1_flash;
+
+/* set by the irq handler when the current command has finished */
+static volatile bool efc1_done;
+static volatile uint32_t efc1_status;
+
+struct efc1_kevent_extra {
+	struct task *task;
+	bool woken;
+};
+
+void irq_efc1(void)
+{
+	__irq_enter();
+
+	/* FRDY is level triggered, mask it until the next command */
+	EFC1->EEFC_FMR &= ~EEFC_FMR_FRDY;
+	/* this also clears the error bits */
+	efc1_status = EFC1->EEFC_FSR;
+	efc1_done = true;
+
+	device_kevent_create_and_dispatch(&efc1_flash.device, DEVICE_KEVENT_TX);
+
+	__irq_leave();
+}
+
+static int efc1_kevent_listener(struct kevent *event, void *_extra)
+{
+	struct efc1_kevent_extra *extra = _extra;
+
+	if (kevent_to_device(event) != &efc1_flash.device)
+		return KEVENT_CB_NONE;
+
+	extra->woken = true;
+	extra->task->state = TASK_QUEUE;
+	return KEVENT_CB_LISTENER_DEL | KEVENT_CB_STOP;
+}
+
+static int efc1_read(struct flash *flash, void *dest, unsigned int page, size_t offset, size_t len)
+{
+	/* the flash is memory mapped, no need for any commands */
+	memcpy(dest, (const void *)(EFC1_PAGE_ADDR(page) + offset), len);
+	return 0;
+}
+
+/* run a command on a page whose contents are in the latch buffer and wait for it */
+static int efc1_command(unsigned int page, uint32_t cmd)
+{
+	efc1_done = false;
+	EFC1->EEFC_FCR = EEFC_FCR_FKEY(EEFC_KEY)
+		       | EEFC_FCR_FARG(EFC1_FIRST_PAGE + page)
+		       | EEFC_FCR_FCMD(cmd);
+	EFC1->EEFC_FMR |= EEFC_FMR_FRDY;
+
+	while (!efc1_done) {
+		struct efc1_kevent_extra extra = {
+			.task = current,
+			.woken = false,
+		};
+		/*
+		 * If we are called with interrupts enabled, the command might
+		 * have finished already.  That's fine though, because kevents
+		 * are only processed by the scheduler, so the listener will
+		 * still see the event.  If we couldn't register a listener or
+		 * the irq handler was unable to allocate the kevent, we merely
+		 * poll the status once the timeout expires.
+		 */
+		struct kevent_listener *listener = kevent_listener_add(KEVENT_DEVICE,
+								       efc1_kevent_listener,
+								       &extra);
+		current->sleep = ms_to_ticks(EFC1_TIMEOUT_MS);
+		if (current->sleep == 0)
+			current->sleep = 1;
+		yield(TASK_SLEEP);
+
+		if (listener != NULL && !extra.woken)
+			kevent_listener_del(listener);
+	}
+
+	if (efc1_status & EEFC_FSR_FLOCKE)
+		return -EROFS;
+	if (efc1_status & EEFC_FSR_FCMDE)
+		return -EIO;
+
+	return 0;
+}
+
+static int efc1_program(struct flash *flash, unsigned int page, const void *src)
+{
+	volatile uint32_t *latch = (volatile uint32_t *)EFC1_PAGE_ADDR(page);
+	const uint32_t *words = src;
+
+	/*
+	 * Writing anywhere within the page actually goes to the latch buffer,
+	 * which only accepts aligned 32-bit accesses.
+	 */
+	for (unsigned int i = 0; i < IFLASH1_PAGE_SIZE / sizeof(*words); i++)
+		latch[i] = words[i];
+
+	return efc1_command(page, EEFC_CMD_EWP);
+}
+
+static int efc1_write(struct flash *flash, unsigned int page, size_t offset, const void *src,
+		      size_t len)
+{
+	volatile uint32_t *latch = (volatile uint32_t *)EFC1_PAGE_ADDR(page);
+	const uint32_t *words = src;
+	unsigned int first = offset / sizeof(*words);
+	unsigned int end = first + len / sizeof(*words);
+
+	/* programming can only clear bits, so all ones leave the rest untouched */
+	for (unsigned int i = 0; i < IFLASH1_PAGE_SIZE / sizeof(*words); i++)
+		latch[i] = (i >= first && i < end) ? words[i - first] : 0xffffffff;
+
+	return efc1_command(page, EEFC_CMD_WP);
+}
+
+struct flash *arch_flash_init(void)
+{
+	/* flash is only accessed through the flash API, not as a device */
+	if (device_init(&efc1_flash.device) != 0)
+		return NULL;
+
+	efc1_flash.page_size = IFLASH1_PAGE_SIZE;
+	efc1_flash.page_count = FLASH_STORAGE_PAGES;
+	efc1_flash.read = efc1_read;
+	efc1_flash.program = efc1_program;
+	efc1_flash.write = efc1_write;
+
+	NVIC_EnableIRQ(EFC1_IRQn);
+
+	return &efc1_flash;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
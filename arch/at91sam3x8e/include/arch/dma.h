@@ -0,0 +1,35 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdint.h>
+
+/** @brief Number of channels of the DMA controller */
+#define DMA_NCHAN 6
+
+/**
+ * @brief Linked list item as fetched by the DMAC.
+ * The layout is defined by the hardware, see the "Multi-buffer Transfers"
+ * section of the DMAC chapter in the datasheet.
+ */
+struct dma_desc {
+	uint32_t saddr;
+	uint32_t daddr;
+	uint32_t ctrla;
+	uint32_t ctrlb;
+	/** @brief Address of the next descriptor, or 0 if this is the last one */
+	uint32_t dscr;
+};
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
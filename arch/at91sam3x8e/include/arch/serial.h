@@ -7,13 +7,59 @@
 #include <ardix/serial.h>
 #include <ardix/util.h>
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of serial ports: the debug UART (`ttyS0`) and USART0-3 (`ttyS1`-`ttyS4`) */
+#define ARCH_SERIAL_NPORTS 5
+
+struct arch_serial_port;
+
 /** Architecture-specific extension of `struct serial_device` */
 struct arch_serial_device {
 	struct serial_device device;
+	/* hardware resources and buffer sizes of the port */
+	const struct arch_serial_port *port;
 
-	/* TODO: Use two buffers per direction as supported by hardware */
+	/* buffer the transmit PDC is currently working on (TPR/TCR) */
 	struct dmabuf *txbuf;
-	/* TODO: Use DMA for TX as well */
+	/*
+	 * buffer queued in TNPR/TNCR, which the PDC switches to as soon as
+	 * `txbuf` is done; writes are appended to it until that happens
+	 */
+	struct dmabuf *txnext;
+	/* amount of bytes in `txnext` (its `len` is the capacity) */
+	size_t txnext_len;
+
+	/*
+	 * The receive PDC fills these alternately, the current one is
+	 * `rxbuf[rxcur]` and the other one is queued as the next buffer.
+	 * `rxpos` is how much of the current one was already moved to `rx`.
+	 * Both are allocated by `arch_serial_init()`.
+	 */
+	uint8_t *rxbuf[2];
+	unsigned int rxcur;
+	size_t rxpos;
+	/*
+	 * Set when the current buffer is complete, but the ring buffer had no
+	 * room for all of it.  It isn't handed back to the PDC until there is.
+	 * This only happens with hardware flow control.
+	 */
+	bool rx_held;
+	/* whether RTS/CTS hardware flow control is enabled (`CRTSCTS`) */
+	bool hwflow;
+
+	/* RC values of the receive timer for the idle check (UART only) and VTIME */
+	uint32_t rx_idle_rc;
+	uint32_t rx_timeout_rc;
+	/* whether the receive timer is counting down the VTIME timeout */
+	bool rx_waiting;
+	/* receive PDC pointer at the last idle check, to tell if the line is busy */
+	uintptr_t rx_last_rpr;
+
+	/* flow control character waiting for THR while the transmit PDC is paused */
+	uint8_t xchar;
+	bool xchar_pending;
 };
 
 /**
@@ -92,6 +92,27 @@ unsigned long int ms_to_ticks(unsigned long int ms)
 	return ( ms * (unsigned long int)tick_freq ) / 1000lu /* 1 s = 1000 ms */;
 }
 
+unsigned long int arch_timestamp_us(void)
+{
+	unsigned long int ticks;
+	uint32_t val;
+
+	/* retry if the SysTick irq incremented tick while we were reading */
+	do {
+		ticks = tick;
+		val = SysTick->VAL;
+	} while (ticks != tick);
+
+	/*
+	 * SysTick counts down from systick_reload to zero.  If we are called
+	 * with irqs disabled and the counter has just wrapped around, tick
+	 * hasn't been incremented yet and the result may lag behind by one
+	 * tick.  This is acceptable for the statistics we use this for.
+	 */
+	return ticks * (1000000lu / tick_freq)
+		+ (systick_reload - val) / (SystemCoreClock / 1000000lu);
+}
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
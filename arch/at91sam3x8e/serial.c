@@ -3,8 +3,9 @@
 #include <ardix/atomic.h>
 #include <ardix/dma.h>
 #include <ardix/io.h>
+#include <ardix/kent.h>
 #include <ardix/malloc.h>
-#include <ardix/ringbuf.h>
+#include <ardix/rxring.h>
 #include <ardix/serial.h>
 #include <ardix/types.h>
 
@@ -12,132 +13,989 @@
 #include <arch/interrupt.h>
 #include <arch-generic/serial.h>
 
+#include <config.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
-struct arch_serial_device arch_serial_default_device = {
-	.device = {
-		.rx = NULL,
-		.id = 0,
-		.baud = 0,
+/* otherwise, rxring_create() fails and the port reports -ENOMEM when it is opened */
+#define SERIAL_BUFSZ_VALID(sz) ((sz) != 0 && ((sz) & ((sz) - 1)) == 0)
+#if !SERIAL_BUFSZ_VALID(CONFIG_SERIAL_BUFSZ)
+#error "CONFIG_SERIAL_BUFSZ must be a power of two"
+#endif
+#if !SERIAL_BUFSZ_VALID(CONFIG_SERIAL_USART0_BUFSZ)
+#error "CONFIG_SERIAL_USART0_BUFSZ must be a power of two"
+#endif
+#if !SERIAL_BUFSZ_VALID(CONFIG_SERIAL_USART1_BUFSZ)
+#error "CONFIG_SERIAL_USART1_BUFSZ must be a power of two"
+#endif
+#if !SERIAL_BUFSZ_VALID(CONFIG_SERIAL_USART2_BUFSZ)
+#error "CONFIG_SERIAL_USART2_BUFSZ must be a power of two"
+#endif
+#if !SERIAL_BUFSZ_VALID(CONFIG_SERIAL_USART3_BUFSZ)
+#error "CONFIG_SERIAL_USART3_BUFSZ must be a power of two"
+#endif
+
+/* the PDC counters are 16 bits wide */
+#if CONFIG_SERIAL_RXDMA_BUFSZ == 0 || CONFIG_SERIAL_RXDMA_BUFSZ > 0xffff
+#error "CONFIG_SERIAL_RXDMA_BUFSZ must be between 1 and 65535"
+#endif
+#if CONFIG_SERIAL_USART0_RXDMA_BUFSZ == 0 || CONFIG_SERIAL_USART0_RXDMA_BUFSZ > 0xffff
+#error "CONFIG_SERIAL_USART0_RXDMA_BUFSZ must be between 1 and 65535"
+#endif
+#if CONFIG_SERIAL_USART1_RXDMA_BUFSZ == 0 || CONFIG_SERIAL_USART1_RXDMA_BUFSZ > 0xffff
+#error "CONFIG_SERIAL_USART1_RXDMA_BUFSZ must be between 1 and 65535"
+#endif
+#if CONFIG_SERIAL_USART2_RXDMA_BUFSZ == 0 || CONFIG_SERIAL_USART2_RXDMA_BUFSZ > 0xffff
+#error "CONFIG_SERIAL_USART2_RXDMA_BUFSZ must be between 1 and 65535"
+#endif
+#if CONFIG_SERIAL_USART3_RXDMA_BUFSZ == 0 || CONFIG_SERIAL_USART3_RXDMA_BUFSZ > 0xffff
+#error "CONFIG_SERIAL_USART3_RXDMA_BUFSZ must be between 1 and 65535"
+#endif
+
+/* US_RTOR counts up to 65535 bit periods, i.e. 6553 characters */
+#if CONFIG_SERIAL_USART0_RX_IDLE_CHARS == 0 || CONFIG_SERIAL_USART0_RX_IDLE_CHARS > 6553
+#error "CONFIG_SERIAL_USART0_RX_IDLE_CHARS must be between 1 and 6553"
+#endif
+#if CONFIG_SERIAL_USART1_RX_IDLE_CHARS == 0 || CONFIG_SERIAL_USART1_RX_IDLE_CHARS > 6553
+#error "CONFIG_SERIAL_USART1_RX_IDLE_CHARS must be between 1 and 6553"
+#endif
+#if CONFIG_SERIAL_USART2_RX_IDLE_CHARS == 0 || CONFIG_SERIAL_USART2_RX_IDLE_CHARS > 6553
+#error "CONFIG_SERIAL_USART2_RX_IDLE_CHARS must be between 1 and 6553"
+#endif
+#if CONFIG_SERIAL_USART3_RX_IDLE_CHARS == 0 || CONFIG_SERIAL_USART3_RX_IDLE_CHARS > 6553
+#error "CONFIG_SERIAL_USART3_RX_IDLE_CHARS must be between 1 and 6553"
+#endif
+
+/*
+ * Hardware resources of a port.  The UART's registers are a subset of the
+ * USART's ones, at the same offsets and with the same bit positions, so all
+ * ports are driven through `Usart`.  Only the mode and baud rate generator
+ * registers need to be treated differently.
+ */
+struct arch_serial_port {
+	Usart *regs;
+	IRQn_Type irq;
+	/* timer channel for VTIME and, on the UART, the receive idle check */
+	TcChannel *tc;
+	IRQn_Type tc_irq;
+	Pio *pio;
+	uint32_t pins;
+	/* whether the pins are on peripheral B rather than A */
+	bool periph_b;
+	/* RTS and CTS pins (peripheral A), or 0 if there is no hardware flow control */
+	Pio *flow_pio;
+	uint32_t flow_pins;
+	bool is_uart;
+	/* size of each of the two receive PDC buffers */
+	size_t rxdma_bufsz;
+	/* idle time in characters after which partial PDC buffers are flushed */
+	uint32_t rx_idle_chars;
+};
+
+static const struct arch_serial_port arch_serial_ports[ARCH_SERIAL_NPORTS] = {
+	{
+		.regs = (Usart *)UART,
+		.irq = UART_IRQn,
+		.tc = &TC0->TC_CHANNEL[0],
+		.tc_irq = TC0_IRQn,
+		.pio = PIOA,
+		.pins = PIO_PA8A_URXD | PIO_PA9A_UTXD,
+		.periph_b = false,
+		.flow_pio = NULL,
+		.flow_pins = 0,
+		.is_uart = true,
+		.rxdma_bufsz = CONFIG_SERIAL_RXDMA_BUFSZ,
+		.rx_idle_chars = CONFIG_SERIAL_RX_IDLE_CHARS,
+	},
+	{
+		.regs = USART0,
+		.irq = USART0_IRQn,
+		.tc = &TC0->TC_CHANNEL[1],
+		.tc_irq = TC1_IRQn,
+		.pio = PIOA,
+		.pins = PIO_PA10A_RXD0 | PIO_PA11A_TXD0,
+		.periph_b = false,
+		.flow_pio = PIOB,
+		.flow_pins = PIO_PB25A_RTS0 | PIO_PB26A_CTS0,
+		.is_uart = false,
+		.rxdma_bufsz = CONFIG_SERIAL_USART0_RXDMA_BUFSZ,
+		.rx_idle_chars = CONFIG_SERIAL_USART0_RX_IDLE_CHARS,
+	},
+	{
+		.regs = USART1,
+		.irq = USART1_IRQn,
+		.tc = &TC0->TC_CHANNEL[2],
+		.tc_irq = TC2_IRQn,
+		.pio = PIOA,
+		.pins = PIO_PA12A_RXD1 | PIO_PA13A_TXD1,
+		.periph_b = false,
+		.flow_pio = PIOA,
+		.flow_pins = PIO_PA14A_RTS1 | PIO_PA15A_CTS1,
+		.is_uart = false,
+		.rxdma_bufsz = CONFIG_SERIAL_USART1_RXDMA_BUFSZ,
+		.rx_idle_chars = CONFIG_SERIAL_USART1_RX_IDLE_CHARS,
+	},
+	{
+		.regs = USART2,
+		.irq = USART2_IRQn,
+		.tc = &TC1->TC_CHANNEL[0],
+		.tc_irq = TC3_IRQn,
+		.pio = PIOB,
+		.pins = PIO_PB21A_RXD2 | PIO_PB20A_TXD2,
+		.periph_b = false,
+		.flow_pio = PIOB,
+		.flow_pins = PIO_PB22A_RTS2 | PIO_PB23A_CTS2,
+		.is_uart = false,
+		.rxdma_bufsz = CONFIG_SERIAL_USART2_RXDMA_BUFSZ,
+		.rx_idle_chars = CONFIG_SERIAL_USART2_RX_IDLE_CHARS,
+	},
+	{
+		.regs = USART3,
+		.irq = USART3_IRQn,
+		.tc = &TC1->TC_CHANNEL[1],
+		.tc_irq = TC4_IRQn,
+		.pio = PIOD,
+		.pins = PIO_PD5B_RXD3 | PIO_PD4B_TXD3,
+		.periph_b = true,
+		/* RTS3 and CTS3 are on PIOF, which only the 217-pin package has */
+		.flow_pio = NULL,
+		.flow_pins = 0,
+		.is_uart = false,
+		.rxdma_bufsz = CONFIG_SERIAL_USART3_RXDMA_BUFSZ,
+		.rx_idle_chars = CONFIG_SERIAL_USART3_RX_IDLE_CHARS,
 	},
-	.txbuf = NULL,
 };
-struct serial_device *serial_default_device = &arch_serial_default_device.device;
 
-int arch_serial_init(struct serial_device *dev)
+static void arch_serial_device_destroy(struct kent *kent)
 {
-	if (dev->baud <= 0 || dev->id != 0)
-		return -1;
+	/* the ports are statically allocated, so there is nothing to free */
+}
 
-	/* enable peripheral clock for UART (which has peripheral id 8) */
-	PMC->PMC_PCER0 |= PMC_PCER0_PID8;
+#define ARCH_SERIAL_DEVICE(_id, _bufsz, _baud) {				\
+	.device = {								\
+		.device = {							\
+			.kent = {						\
+				.destroy = arch_serial_device_destroy,		\
+			},							\
+		},								\
+		.rx = NULL,							\
+		.rx_owner = NULL,						\
+		.rx_bufsz = (_bufsz),						\
+		.baud = (_baud),						\
+		.id = (_id),							\
+	},									\
+	.port = &arch_serial_ports[_id],					\
+	.txbuf = NULL,								\
+	.txnext = NULL,								\
+	.txnext_len = 0,							\
+	.rxbuf = { NULL, NULL },						\
+	.rxcur = 0,								\
+	.rxpos = 0,								\
+	.rx_idle_rc = 0,							\
+	.rx_timeout_rc = 0,							\
+	.rx_waiting = false,							\
+	.rx_last_rpr = 0,							\
+	.rx_held = false,							\
+	.hwflow = false,							\
+	.xchar = 0,								\
+	.xchar_pending = false,							\
+}
 
-	/* ensure the PIO controller is turned off on the serial pins */
-	PIOA->PIO_PDR = PIO_PDR_P8 | PIO_PDR_P9;
+static struct arch_serial_device arch_serial_devices[ARCH_SERIAL_NPORTS] = {
+	ARCH_SERIAL_DEVICE(0, CONFIG_SERIAL_BUFSZ, CONFIG_SERIAL_BAUD),
+	ARCH_SERIAL_DEVICE(1, CONFIG_SERIAL_USART0_BUFSZ, CONFIG_SERIAL_USART0_BAUD),
+	ARCH_SERIAL_DEVICE(2, CONFIG_SERIAL_USART1_BUFSZ, CONFIG_SERIAL_USART1_BAUD),
+	ARCH_SERIAL_DEVICE(3, CONFIG_SERIAL_USART2_BUFSZ, CONFIG_SERIAL_USART2_BAUD),
+	ARCH_SERIAL_DEVICE(4, CONFIG_SERIAL_USART3_BUFSZ, CONFIG_SERIAL_USART3_BAUD),
+};
+struct serial_device *serial_default_device = &arch_serial_devices[0].device;
 
-	/* configure peripheral DMA controller */
-	UART->UART_PTCR = UART_PTCR_RXTDIS | UART_PTCR_TXTEN;
+struct serial_device *arch_serial_get(unsigned int index)
+{
+	if (index >= ARCH_SERIAL_NPORTS)
+		return NULL;
 
-	/* reset & disable rx and tx */
-	UART->UART_CR = UART_CR_RXDIS | UART_CR_RSTRX
-		      | UART_CR_TXDIS | UART_CR_RSTTX;
+	return &arch_serial_devices[index].device;
+}
+
+/*
+ * Received data is written to memory by the PDC, which only raises an
+ * interrupt when one of the two buffers is full.  The USARTs have a receiver
+ * timeout (US_RTOR) that is restarted by every byte, so they get exactly one
+ * TIMEOUT interrupt per idle gap and flush the partial buffer then.
+ *
+ * The UART doesn't have one, so it uses a timer channel that checks whether
+ * the PDC has moved on since the previous period.  As long as it has, the line is busy
+ * and the data stays where it is until the buffer is full or the line goes
+ * quiet.  Once a whole period has passed without any new data, whatever has
+ * arrived is moved to the ring buffer, the timer is stopped and the RXRDY
+ * interrupt is armed to restart it as soon as the next byte comes in.  If an
+ * inter-byte timeout (VTIME) is set, the timer runs for that long once more,
+ * and then reports the timeout unless RXRDY has restarted the idle check by
+ * then.
+ */
+
+/* UART only: restart the idle check when data comes in */
+static void rx_timer_start(struct arch_serial_device *arch_dev)
+{
+	const struct arch_serial_port *port = arch_dev->port;
+
+	port->regs->US_IDR = US_IDR_RXRDY;
+	if (arch_dev->rx_waiting) {
+		arch_dev->rx_waiting = false;
+		port->tc->TC_RC = arch_dev->rx_idle_rc;
+	}
+	arch_dev->rx_last_rpr = port->regs->US_RPR;
+	port->tc->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+}
+
+/* UART only: stop the idle check and wait for the next byte */
+static void rx_timer_stop(struct arch_serial_device *arch_dev)
+{
+	const struct arch_serial_port *port = arch_dev->port;
+
+	port->tc->TC_CCR = TC_CCR_CLKDIS;
+	port->regs->US_IER = US_IER_RXRDY;
+}
+
+/* start counting down the VTIME timeout after the line went idle, if any */
+static void rx_vtime_start(struct arch_serial_device *arch_dev)
+{
+	const struct arch_serial_port *port = arch_dev->port;
+
+	if (arch_dev->rx_timeout_rc == 0)
+		return;
+
+	arch_dev->rx_waiting = true;
+	arch_dev->rx_last_rpr = port->regs->US_RPR;
+	port->tc->TC_RC = arch_dev->rx_timeout_rc;
+	port->tc->TC_CCR = TC_CCR_CLKEN | TC_CCR_SWTRG;
+}
+
+/*
+ * Move `len` bytes of the current receive buffer, starting at `rxpos`, to the
+ * ring buffer.  Whatever doesn't fit is dropped, unless hardware flow control
+ * is enabled, in which case it stays where it is.  Returns whether all of it
+ * was consumed, and adds the amount of bytes to `received`.
+ */
+static bool rx_move(struct arch_serial_device *arch_dev, size_t len, size_t *received)
+{
+	uint8_t *src = arch_dev->rxbuf[arch_dev->rxcur] + arch_dev->rxpos;
+	size_t written = rxring_write(arch_dev->device.rx, src, len);
+
+	if (written != len && arch_dev->hwflow) {
+		arch_dev->rxpos += written;
+		*received += written;
+		return false;
+	}
+
+	arch_dev->device.stats.dropped += len - written;
+	arch_dev->rxpos += len;
+	*received += len;
+	return true;
+}
+
+/*
+ * Move everything the PDC has received so far to the ring buffer, and hand
+ * completed buffers back to the PDC.  Must only be called with irqs disabled.
+ * Returns the amount of new bytes (including ones the ring had no room for).
+ */
+static size_t rx_flush(struct arch_serial_device *arch_dev)
+{
+	Usart *regs = arch_dev->port->regs;
+	size_t bufsz = arch_dev->port->rxdma_bufsz;
+	size_t received = 0;
+	uint8_t *cur = arch_dev->rxbuf[arch_dev->rxcur];
+	uintptr_t rpr = regs->US_RPR;
+
+	/*
+	 * The PDC has switched over to the next buffer, or it has stopped
+	 * because both are full.  In the latter case, RPR may point right
+	 * behind the other buffer, which is the start of the current one.
+	 */
+	while (rpr < (uintptr_t)cur || rpr >= (uintptr_t)cur + bufsz || regs->US_RCR == 0) {
+		if (!rx_move(arch_dev, bufsz - arch_dev->rxpos, &received)) {
+			/*
+			 * Keep the buffer until the ring has room for the rest.
+			 * Once the PDC has filled the other one as well, the
+			 * USART raises RTS to pause the sender.  ENDRX stays set
+			 * until we write RNCR, so mask it in the meantime.
+			 */
+			if (!arch_dev->rx_held) {
+				arch_dev->rx_held = true;
+				regs->US_IDR = US_IDR_ENDRX;
+			}
+			goto out;
+		}
+
+		/* writing RNCR also clears ENDRX */
+		regs->US_RNPR = (uintptr_t)cur;
+		regs->US_RNCR = bufsz;
+
+		arch_dev->rxcur ^= 1;
+		arch_dev->rxpos = 0;
+		cur = arch_dev->rxbuf[arch_dev->rxcur];
+		rpr = regs->US_RPR;
+	}
+
+	if (arch_dev->rx_held) {
+		arch_dev->rx_held = false;
+		regs->US_IER = US_IER_ENDRX;
+	}
+
+	size_t pos = rpr - (uintptr_t)cur;
+	if (pos > arch_dev->rxpos)
+		rx_move(arch_dev, pos - arch_dev->rxpos, &received);
+
+out:
+	arch_dev->device.stats.rx_bytes += received;
+	return received;
+}
+
+/*
+ * Compute the mode and baud rate generator register values for a baud rate.
+ * The UART only has an integer divider with 16x oversampling, the USARTs
+ * also have a fractional part and can switch to 8x oversampling.
+ */
+static int baud_regs(const struct arch_serial_port *port, long int baud,
+		     uint32_t *mr, uint32_t *brgr)
+{
+	/* this also keeps the calculations below from overflowing */
+	if (baud <= 0 || (uint32_t)baud > SystemCoreClock / (port->is_uart ? 16 : 8))
+		return -EINVAL;
+
+	uint32_t rate = (uint32_t)baud;
+
+	if (port->is_uart) {
+		/* From Atmel Datasheet: baud rate = MCK / (UART_BRGR * 16) */
+		uint32_t cd = (SystemCoreClock + rate * 8) / (rate * 16);
+		if (cd > 0xffff)
+			return -EINVAL;
+
+		*mr = UART_MR_PAR_NO | UART_MR_CHMODE_NORMAL;
+		*brgr = UART_BRGR_CD(cd);
+		return 0;
+	}
 
-	/* no parity, normal mode */
-	UART->UART_MR = UART_MR_PAR_NO | UART_MR_CHMODE_NORMAL;
+	*mr = US_MR_USART_MODE_NORMAL | US_MR_USCLKS_MCK | US_MR_CHRL_8_BIT
+	    | US_MR_PAR_NO | US_MR_NBSTOP_1_BIT | US_MR_CHMODE_NORMAL;
+
+	/*
+	 * baud rate = MCK / (8 * (2 - OVER) * (CD + FP / 8)), so this is the
+	 * divider in eighths.  16x oversampling tolerates more clock deviation,
+	 * so 8x is only used for rates that can't be reached otherwise.
+	 */
+	uint32_t div = (SystemCoreClock + rate) / (rate * 2);
+	if (div < 8) {
+		*mr |= US_MR_OVER;
+		div = (SystemCoreClock + rate / 2) / rate;
+	}
+	if (div < 8 || div / 8 > 0xffff)
+		return -EINVAL;
+
+	*brgr = US_BRGR_CD(div / 8) | US_BRGR_FP(div % 8);
+	return 0;
+}
+
+/* RC value of the idle check timer, counting at MCK / 128 */
+static uint32_t rx_idle_rc(const struct arch_serial_port *port, long int baud)
+{
+	/* each character is 10 bits long with start and stop bit */
+	uint32_t rc = (SystemCoreClock / 128) * 10 * port->rx_idle_chars / (uint32_t)baud;
+
+	return rc != 0 ? rc : 1;
+}
 
-	/* From Atmel Datasheet: baud rate = MCK / (UART_BRGR * 16) */
-	UART->UART_BRGR = UART_BRGR_CD(( SystemCoreClock / (uint32_t)dev->baud ) >> 4);
+int arch_serial_init(struct serial_device *dev)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	const struct arch_serial_port *port = arch_dev->port;
+	Usart *regs = port->regs;
+	uint32_t mr;
+	uint32_t brgr;
+
+	if (dev->id < 0 || dev->id >= ARCH_SERIAL_NPORTS)
+		return -ENODEV;
+	if (baud_regs(port, dev->baud, &mr, &brgr) != 0)
+		return -EINVAL;
+
+	uint8_t *rxmem = kmalloc(2 * port->rxdma_bufsz);
+	if (rxmem == NULL)
+		return -ENOMEM;
+	arch_dev->rxbuf[0] = rxmem;
+	arch_dev->rxbuf[1] = rxmem + port->rxdma_bufsz;
 
-	/* choose the events we want an interrupt on */
-	UART->UART_IDR = 0xffffffff; /* make sure all interrupts are disabled first */
-	UART->UART_IER = UART_IER_RXRDY | UART_IER_OVRE | UART_IER_FRAME;
+	/*
+	 * enable the peripheral clock, all of our peripheral ids are below 32
+	 * and the same as the irq numbers (Atmel Datasheet, Section 9.1)
+	 */
+	PMC->PMC_PCER0 = 1u << port->irq;
 
-	NVIC_EnableIRQ(UART_IRQn);
+	/* ensure the PIO controller is turned off on the serial pins */
+	if (port->periph_b)
+		port->pio->PIO_ABSR |= port->pins;
+	else
+		port->pio->PIO_ABSR &= ~port->pins;
+	port->pio->PIO_PDR = port->pins;
+
+	/* configure peripheral DMA controller, rx starts out with both buffers */
+	regs->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+	arch_dev->rxcur = 0;
+	arch_dev->rxpos = 0;
+	arch_dev->rx_held = false;
+	arch_dev->hwflow = false;
+	regs->US_RPR = (uintptr_t)arch_dev->rxbuf[0];
+	regs->US_RCR = port->rxdma_bufsz;
+	regs->US_RNPR = (uintptr_t)arch_dev->rxbuf[1];
+	regs->US_RNCR = port->rxdma_bufsz;
+	regs->US_PTCR = US_PTCR_RXTEN | US_PTCR_TXTEN;
+
+	/* reset & disable rx and tx */
+	regs->US_CR = US_CR_RXDIS | US_CR_RSTRX
+		    | US_CR_TXDIS | US_CR_RSTTX;
+
+	/* 8 data bits, no parity, one stop bit, normal mode */
+	regs->US_MR = mr;
+	regs->US_BRGR = brgr;
+
+	/*
+	 * Receive timer, counting at MCK / 128 and raising an interrupt every
+	 * `rx_idle_chars` characters (UART only) or once VTIME has expired.
+	 */
+	PMC->PMC_PCER0 = 1u << port->tc_irq;
+	port->tc->TC_CCR = TC_CCR_CLKDIS;
+	port->tc->TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK4 | TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC;
+	arch_dev->rx_idle_rc = port->is_uart ? rx_idle_rc(port, dev->baud) : 0;
+	arch_dev->rx_waiting = false;
+	port->tc->TC_RC = arch_dev->rx_idle_rc;
+	port->tc->TC_IDR = 0xffffffff;
+	port->tc->TC_IER = TC_IER_CPCS;
+	NVIC_EnableIRQ(port->tc_irq);
+
+	/*
+	 * choose the events we want an interrupt on; RXRDY is only used to
+	 * start the idle timer because the PDC takes care of the data itself
+	 */
+	regs->US_IDR = 0xffffffff; /* make sure all interrupts are disabled first */
+	if (port->is_uart) {
+		regs->US_IER = US_IER_RXRDY | US_IER_ENDRX | US_IER_OVRE | US_IER_FRAME;
+	} else {
+		/* the timeout is in bit periods, so it doesn't depend on the baud rate */
+		regs->US_RTOR = US_RTOR_TO(port->rx_idle_chars * 10);
+		regs->US_IER = US_IER_TIMEOUT | US_IER_ENDRX | US_IER_OVRE | US_IER_FRAME;
+	}
+
+	NVIC_EnableIRQ(port->irq);
 
 	/* enable receiver and transmitter */
-	UART->UART_CR = UART_CR_RXEN | UART_CR_TXEN;
+	regs->US_CR = US_CR_RXEN | US_CR_TXEN;
+	/* the receiver timeout starts counting after the first byte */
+	if (!port->is_uart)
+		regs->US_CR = US_CR_STTTO;
 
 	return 0;
 }
 
 void arch_serial_exit(struct serial_device *dev)
 {
-	if (dev->id != 0)
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	const struct arch_serial_port *port = arch_dev->port;
+	Usart *regs = port->regs;
+
+	if (dev->id < 0)
 		return;
 
 	/* disable receiver and transmitter */
-	UART->UART_CR = UART_CR_RXDIS | UART_CR_TXDIS;
+	regs->US_CR = US_CR_RXDIS | US_CR_TXDIS;
+
+	NVIC_DisableIRQ(port->irq);
+	regs->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+
+	/* the buffers may come from the device's pool, which is about to go away */
+	if (arch_dev->txnext != NULL) {
+		dmabuf_put(arch_dev->txnext);
+		arch_dev->txnext = NULL;
+	}
+	if (arch_dev->txbuf != NULL) {
+		dmabuf_put(arch_dev->txbuf);
+		arch_dev->txbuf = NULL;
+	}
+
+	port->tc->TC_CCR = TC_CCR_CLKDIS;
+	NVIC_DisableIRQ(port->tc_irq);
+	PMC->PMC_PCDR0 = 1u << port->tc_irq;
 
-	NVIC_DisableIRQ(UART_IRQn);
+	PMC->PMC_PCDR0 = 1u << port->irq;
 
-	/* disable peripheral clock for UART (PID is taken from Atmel Datasheet, Section 9.1 */
-	PMC->PMC_PCDR0 = PMC_PCDR0_PID8;
+	kfree(arch_dev->rxbuf[0]);
+	arch_dev->rxbuf[0] = NULL;
+	arch_dev->rxbuf[1] = NULL;
 
 	dev->id = -1;
 }
 
 ssize_t arch_serial_write(struct serial_device *dev, const void *buf, size_t len)
+{
+	struct iovec iov = {
+		.iov_base = (void *)buf,
+		.iov_len = len,
+	};
+
+	/* anything that doesn't fit into US_TCR is left for the next call */
+	return arch_serial_writev(dev, &iov, 1);
+}
+
+/*
+ * Transmission uses both PDC slots: `txbuf` is being sent, and `txnext` is
+ * queued to follow it immediately so the line doesn't go idle in between.
+ * The ENDTX interrupt fires whenever a buffer is done.  Until the PDC has
+ * switched to `txnext`, small writes are merged into it rather than each
+ * getting a transfer of its own.
+ */
+
+/*
+ * Drop the buffers the PDC is done with.  Neither check can be invalidated
+ * by the PDC advancing in between, so this is safe to call with the PDC
+ * running, from both irq and syscall context.
+ */
+static void tx_reap(struct arch_serial_device *arch_dev)
+{
+	Usart *regs = arch_dev->port->regs;
+
+	/* the PDC has moved on to the queued buffer */
+	if (arch_dev->txnext != NULL && regs->US_TNCR == 0) {
+		dmabuf_put(arch_dev->txbuf);
+		arch_dev->txbuf = arch_dev->txnext;
+		arch_dev->txnext = NULL;
+	}
+
+	if (arch_dev->txbuf != NULL && arch_dev->txnext == NULL && regs->US_TCR == 0) {
+		dmabuf_put(arch_dev->txbuf);
+		arch_dev->txbuf = NULL;
+	}
+}
+
+/* hand the first `len` bytes of `buf` to the PDC, or return -EBUSY */
+static ssize_t tx_queue(struct arch_serial_device *arch_dev, struct dmabuf *buf, size_t len)
+{
+	Usart *regs = arch_dev->port->regs;
+
+	if (arch_dev->txbuf == NULL) {
+		dmabuf_get(buf);
+		arch_dev->txbuf = buf;
+		regs->US_TPR = (uintptr_t)buf->data;
+		regs->US_TCR = len;
+		regs->US_IER = US_IER_ENDTX;
+	} else if (arch_dev->txnext == NULL) {
+		dmabuf_get(buf);
+		arch_dev->txnext = buf;
+		arch_dev->txnext_len = len;
+		/* the counter must be written last because that arms the slot */
+		regs->US_TNPR = (uintptr_t)buf->data;
+		regs->US_TNCR = len;
+	} else {
+		return -EBUSY;
+	}
+
+	return (ssize_t)len;
+}
+
+static void iov_gather(uint8_t *dest, const struct iovec *iov, size_t len)
+{
+	for (int i = 0; len != 0; i++) {
+		size_t chunk = iov[i].iov_len;
+		if (chunk > len)
+			chunk = len;
+		memcpy(dest, iov[i].iov_base, chunk);
+		dest += chunk;
+		len -= chunk;
+	}
+}
+
+/*
+ * Append to `txnext`.  Returns the amount of bytes appended, -EBUSY if it is
+ * full, or 0 if the PDC has already started sending it.
+ */
+static ssize_t tx_append(struct arch_serial_device *arch_dev, const struct iovec *iov,
+			 size_t len)
+{
+	Usart *regs = arch_dev->port->regs;
+	struct dmabuf *next = arch_dev->txnext;
+	size_t room = next->len - arch_dev->txnext_len;
+	ssize_t ret = 0;
+
+	if (room == 0)
+		return -EBUSY;
+	if (len > room)
+		len = room;
+
+	/*
+	 * Pause the PDC so it can't switch to the buffer while we extend it.
+	 * The copy is short enough for the byte in THR to cover it.
+	 */
+	regs->US_PTCR = US_PTCR_TXTDIS;
+
+	if (regs->US_TNCR != 0) {
+		iov_gather(next->data + arch_dev->txnext_len, iov, len);
+		arch_dev->txnext_len += len;
+		regs->US_TNCR = arch_dev->txnext_len;
+		ret = (ssize_t)len;
+	}
+
+	/* a pending flow control character resumes the PDC once it is out */
+	if (!arch_dev->xchar_pending)
+		regs->US_PTCR = US_PTCR_TXTEN;
+
+	return ret;
+}
+
+ssize_t arch_serial_writev(struct serial_device *dev, const struct iovec *iov, int iovcnt)
 {
 	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	size_t len = 0;
+	ssize_t ret;
+
+	/* US_TCR is only 16 bits wide, so truncate to what fits in there */
+	for (int i = 0; i < iovcnt && len < 0xffff; i++) {
+		len += iov[i].iov_len;
+		if (len > 0xffff)
+			len = 0xffff;
+	}
+	if (len == 0)
+		return 0;
 
-	if (len > 0xffff)
-		return -E2BIG;
+	tx_reap(arch_dev);
+
+	if (arch_dev->txnext != NULL) {
+		ret = tx_append(arch_dev, iov, len);
+		if (ret != 0)
+			return ret;
+		tx_reap(arch_dev);
+	}
 
-	if (arch_dev->txbuf != NULL)
+	if (arch_dev->txnext != NULL)
 		return -EBUSY;
 
-	struct dmabuf *dmabuf = dmabuf_create(&dev->device, len);
+	/* queued buffers get some extra room for later writes to be merged into */
+	size_t size = len;
+	if (arch_dev->txbuf != NULL && size < CONFIG_SERIAL_TXBUFSZ)
+		size = CONFIG_SERIAL_TXBUFSZ;
+
+	struct dmabuf *dmabuf = dmabuf_create(&dev->device, size);
 	if (dmabuf == NULL)
 		return -ENOMEM;
 
-	memcpy(dmabuf->data, buf, len);
+	iov_gather(dmabuf->data, iov, len);
 
-	arch_dev->txbuf = dmabuf;
-	UART->UART_TPR = (uintptr_t)dmabuf->data;
-	UART->UART_TCR = dmabuf->len;
-	UART->UART_IER = UART_IER_TXBUFE;
+	/* the irq handler owns the buffer from now on */
+	ret = tx_queue(arch_dev, dmabuf, len);
+	dmabuf_put(dmabuf);
+	return ret;
+}
 
-	return (ssize_t)len;
+void arch_serial_send_xchar(struct serial_device *dev, uint8_t c)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	Usart *regs = arch_dev->port->regs;
+
+	/*
+	 * The PDC owns THR while it is running, so pause it and let the
+	 * TXRDY interrupt write the character as soon as THR is empty.
+	 */
+	arch_dev->xchar = c;
+	arch_dev->xchar_pending = true;
+	regs->US_PTCR = US_PTCR_TXTDIS;
+	regs->US_IER = US_IER_TXRDY;
 }
 
-void irq_uart(void)
+void arch_serial_set_rx_timeout(struct serial_device *dev, unsigned int ms)
 {
-	__irq_enter();
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+
+	/* the timer counts at MCK / 128, 25.5 s (VTIME = 255) fit easily */
+	arch_dev->rx_timeout_rc = (SystemCoreClock / 128 / 1000) * ms;
+}
+
+int arch_serial_set_baud(struct serial_device *dev, long int baud)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	const struct arch_serial_port *port = arch_dev->port;
+	uint32_t mr;
+	uint32_t brgr;
+
+	if (baud_regs(port, baud, &mr, &brgr) != 0)
+		return -EINVAL;
+
+	if (arch_dev->hwflow)
+		mr = (mr & ~US_MR_USART_MODE_Msk) | US_MR_USART_MODE_HW_HANDSHAKING;
+
+	port->regs->US_MR = mr;
+	port->regs->US_BRGR = brgr;
+
+	/* US_RTOR counts bit periods, only the UART's timer has to be adjusted */
+	if (port->is_uart) {
+		arch_dev->rx_idle_rc = rx_idle_rc(port, baud);
+		if (!arch_dev->rx_waiting)
+			port->tc->TC_RC = arch_dev->rx_idle_rc;
+	}
+
+	return 0;
+}
+
+bool arch_serial_has_hwflow(struct serial_device *dev)
+{
+	return to_arch_serial_device(dev)->port->flow_pins != 0;
+}
+
+/*
+ * In hardware handshaking mode, the USART drives RTS high (telling the other
+ * side to stop) while both receive PDC buffers are full, and stops sending
+ * while CTS is high.  rx_flush() holds back full buffers that don't fit into
+ * the ring buffer, so RTS is raised before we run out of room.
+ */
+void arch_serial_set_hwflow(struct serial_device *dev, bool enable)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+	const struct arch_serial_port *port = arch_dev->port;
+	uint32_t mr = port->regs->US_MR & ~US_MR_USART_MODE_Msk;
+
+	if (enable == arch_dev->hwflow || port->flow_pins == 0)
+		return;
+
+	if (enable) {
+		port->flow_pio->PIO_ABSR &= ~port->flow_pins;
+		port->flow_pio->PIO_PDR = port->flow_pins;
+		port->regs->US_MR = mr | US_MR_USART_MODE_HW_HANDSHAKING;
+	} else {
+		port->regs->US_MR = mr | US_MR_USART_MODE_NORMAL;
+		port->flow_pio->PIO_PER = port->flow_pins;
+	}
+	arch_dev->hwflow = enable;
+
+	/* without flow control, held back data is dropped if it doesn't fit */
+	if (!enable)
+		arch_serial_rx_drained(dev);
+}
+
+void arch_serial_rx_drained(struct serial_device *dev)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+
+	/* without hardware flow control, nothing is ever left behind */
+	if (!arch_dev->hwflow && !arch_dev->rx_held)
+		return;
 
-	uint8_t tmp;
-	uint32_t state = UART->UART_SR;
+	/* we are called from syscalls, which run with irqs disabled */
+	if (rx_flush(arch_dev) != 0)
+		serial_rx_notify(dev, SERIAL_RX_DATA);
+}
 
-	/* RX has received a byte, store it into the ring buffer */
-	if (state & UART_SR_RXRDY) {
-		tmp = (uint8_t)UART->UART_RHR;
-		ringbuf_write(arch_serial_default_device.device.rx, &tmp, sizeof(tmp));
+ssize_t serial_write_dma(struct serial_device *dev, struct dmabuf *buf)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
 
-		device_kevent_create_and_dispatch(&serial_default_device->device,
-						  DEVICE_KEVENT_RX);
+	if (buf->len > 0xffff)
+		return -E2BIG;
+
+	tx_reap(arch_dev);
+
+	/* the buffer has no room, so nothing will ever be appended to it */
+	return tx_queue(arch_dev, buf, buf->len);
+}
+
+bool arch_serial_tx_ready(struct serial_device *dev)
+{
+	struct arch_serial_device *arch_dev = to_arch_serial_device(dev);
+
+	tx_reap(arch_dev);
+	return arch_dev->txnext == NULL || arch_dev->txnext_len != arch_dev->txnext->len;
+}
+
+static void serial_irq(struct arch_serial_device *arch_dev)
+{
+	Usart *regs = arch_dev->port->regs;
+	struct serial_device *dev = &arch_dev->device;
+
+	uint32_t imr = regs->US_IMR;
+	/* ENDTX is also set while TX is idle, so ignore flags we didn't ask for */
+	uint32_t state = regs->US_CSR & imr;
+
+	/*
+	 * The PDC reads RHR right away, so RXRDY is usually clear again by
+	 * now.  If the interrupt is enabled at all, we were idle until now.
+	 */
+	if (imr & US_IMR_RXRDY)
+		rx_timer_start(arch_dev);
+
+	/* the current RX buffer is full and the PDC has moved on to the next one */
+	if (state & US_CSR_ENDRX) {
+		if (rx_flush(arch_dev) != 0)
+			serial_rx_notify(dev, SERIAL_RX_DATA);
+		if (arch_dev->port->is_uart)
+			rx_timer_start(arch_dev);
+	}
+
+	/* USARTs only: the line has been idle for `rx_idle_chars` */
+	if (state & US_CSR_TIMEOUT) {
+		/* this clears TIMEOUT, the counter restarts with the next byte */
+		regs->US_CR = US_CR_STTTO;
+		if (rx_flush(arch_dev) != 0)
+			serial_rx_notify(dev, SERIAL_RX_DATA);
+		rx_vtime_start(arch_dev);
 	}
 
-	/* UART_TCR has reached zero */
-	if (state & UART_SR_TXBUFE) {
-		dmabuf_put(arch_serial_default_device.txbuf);
-		arch_serial_default_device.txbuf = NULL;
+	/* US_TCR has reached zero */
+	if (state & US_CSR_ENDTX) {
+		tx_reap(arch_dev);
 
-		UART->UART_IDR = UART_IDR_TXBUFE;
+		if (arch_dev->txbuf == NULL)
+			regs->US_IDR = US_IDR_ENDTX;
+		else if (arch_dev->txnext == NULL)
+			regs->US_TNCR = 0; /* acknowledge ENDTX */
 
-		device_kevent_create_and_dispatch(&serial_default_device->device,
-						  DEVICE_KEVENT_TX);
+		/*
+		 * always notify waiters, the slot may also have been
+		 * freed up by a tx_reap() call from syscall context
+		 */
+		device_kevent_create_and_dispatch(&dev->device, DEVICE_KEVENT_TX);
+	}
+
+	/* THR is free for the flow control character */
+	if (state & US_CSR_TXRDY) {
+		regs->US_IDR = US_IDR_TXRDY;
+		if (arch_dev->xchar_pending) {
+			regs->US_THR = arch_dev->xchar;
+			arch_dev->xchar_pending = false;
+			regs->US_PTCR = US_PTCR_TXTEN;
+		}
 	}
 
 	/* check for error conditions */
-	if ((state & UART_SR_OVRE) || (state & UART_SR_FRAME)) {
-		UART->UART_CR = UART_CR_RSTSTA;
+	if ((state & US_CSR_OVRE) || (state & US_CSR_FRAME)) {
+		if (state & US_CSR_OVRE)
+			dev->stats.overruns++;
+		if (state & US_CSR_FRAME)
+			dev->stats.frame_errors++;
+		regs->US_CR = US_CR_RSTSTA;
 		device_kevent_create_and_dispatch(
-			&serial_default_device->device,
+			&dev->device,
 			DEVICE_KEVENT_RX | DEVICE_KEVENT_TX | DEVICE_KEVENT_ERR
 		);
 	}
+}
 
+static void rx_timer_irq(struct arch_serial_device *arch_dev)
+{
+	TcChannel *tc = arch_dev->port->tc;
+
+	/* reading the status register acknowledges the interrupt */
+	(void)tc->TC_SR;
+
+	if (arch_dev->rx_waiting) {
+		tc->TC_CCR = TC_CCR_CLKDIS;
+		arch_dev->rx_waiting = false;
+		if (arch_dev->port->is_uart)
+			tc->TC_RC = arch_dev->rx_idle_rc;
+		/*
+		 * On the UART, RXRDY would have cancelled this if anything had
+		 * come in.  The USARTs restart it once the line is idle again.
+		 */
+		if (arch_dev->port->regs->US_RPR == arch_dev->rx_last_rpr)
+			serial_rx_notify(&arch_dev->device, SERIAL_RX_TIMEOUT);
+		return;
+	}
+
+	/* the USARTs only use the timer for VTIME */
+	if (!arch_dev->port->is_uart) {
+		tc->TC_CCR = TC_CCR_CLKDIS;
+		return;
+	}
+
+	/* still receiving, the data is flushed once the line goes quiet */
+	uintptr_t rpr = arch_dev->port->regs->US_RPR;
+	if (rpr != arch_dev->rx_last_rpr) {
+		arch_dev->rx_last_rpr = rpr;
+		return;
+	}
+
+	/* RXRDY is armed first so that nothing can slip in unnoticed */
+	rx_timer_stop(arch_dev);
+	if (rx_flush(arch_dev) != 0)
+		serial_rx_notify(&arch_dev->device, SERIAL_RX_DATA);
+
+	rx_vtime_start(arch_dev);
+}
+
+void irq_uart(void)
+{
+	__irq_enter();
+	serial_irq(&arch_serial_devices[0]);
+	__irq_leave();
+}
+
+void irq_usart0(void)
+{
+	__irq_enter();
+	serial_irq(&arch_serial_devices[1]);
+	__irq_leave();
+}
+
+void irq_usart1(void)
+{
+	__irq_enter();
+	serial_irq(&arch_serial_devices[2]);
+	__irq_leave();
+}
+
+void irq_usart2(void)
+{
+	__irq_enter();
+	serial_irq(&arch_serial_devices[3]);
+	__irq_leave();
+}
+
+void irq_usart3(void)
+{
+	__irq_enter();
+	serial_irq(&arch_serial_devices[4]);
+	__irq_leave();
+}
+
+void irq_tc0(void)
+{
+	__irq_enter();
+	rx_timer_irq(&arch_serial_devices[0]);
+	__irq_leave();
+}
+
+void irq_tc1(void)
+{
+	__irq_enter();
+	rx_timer_irq(&arch_serial_devices[1]);
+	__irq_leave();
+}
+
+void irq_tc2(void)
+{
+	__irq_enter();
+	rx_timer_irq(&arch_serial_devices[2]);
+	__irq_leave();
+}
+
+void irq_tc3(void)
+{
+	__irq_enter();
+	rx_timer_irq(&arch_serial_devices[3]);
+	__irq_leave();
+}
+
+void irq_tc4(void)
+{
+	__irq_enter();
+	rx_timer_irq(&arch_serial_devices[4]);
 	__irq_leave();
 }
 
@@ -0,0 +1,58 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/dma.h>
+
+/**
+ * @brief Initialize the DMA controller.
+ *
+ * @returns 0 on success, or a negative error code on failure
+ */
+int arch_dma_init(void);
+
+/**
+ * @brief Set up a descriptor for a memory to memory copy.
+ * The descriptor is the last one in its chain until `arch_dma_desc_chain()`
+ * is called on it.
+ *
+ * @param desc Descriptor to set up
+ * @param dest Where to copy to
+ * @param src Where to copy from
+ * @param len Amount of bytes to copy
+ * @returns The amount of bytes the descriptor covers, which may be less
+ *	than `len` if the hardware can't do that many at once
+ */
+size_t arch_dma_desc_init(struct dma_desc *desc, void *dest, const void *src, size_t len);
+
+/**
+ * @brief Make the DMA controller continue with `next` after `desc`.
+ *
+ * @param desc Descriptor to append to
+ * @param next Descriptor to append
+ */
+void arch_dma_desc_chain(struct dma_desc *desc, struct dma_desc *next);
+
+/**
+ * @brief Start processing a descriptor chain on a channel.
+ * When the transfer is done or has failed, the irq handler calls
+ * `dma_chan_complete()`.  The descriptors must remain valid until then.
+ *
+ * @param chan Idle channel to start the transfer on
+ * @param desc First descriptor of the chain
+ * @returns 0 on success, or a negative error code on failure
+ */
+int arch_dma_start(struct dma_chan *chan, struct dma_desc *desc);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,26 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/flash.h>
+
+/**
+ * Initialize the hardware backend for the storage area and register its
+ * device.  The area is `FLASH_STORAGE_PAGES` pages long.
+ *
+ * @returns The storage area, or `NULL` if it is not supported or out of memory
+ */
+struct flash *arch_flash_init(void);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -35,6 +35,15 @@ __naked int _idle(void);
  */
 unsigned long int ms_to_ticks(unsigned long ms);
 
+/**
+ * @brief Get a high resolution timestamp in microseconds since boot.
+ * The value overflows, so only ever use the difference between two
+ * timestamps.  Safe to call from irq context.
+ *
+ * @returns Current timestamp in microseconds
+ */
+unsigned long int arch_timestamp_us(void);
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
@@ -8,6 +8,53 @@
 int arch_serial_init(struct serial_device *dev);
 void arch_serial_exit(struct serial_device *dev);
 
+/**
+ * Get a serial port by its index, which is also its `id`.  The port is not
+ * necessarily initialized yet, see `serial_open()`.
+ *
+ * @param index: port number, 0 is the default console
+ * @returns the serial device, or `NULL` if there is no such port
+ */
+struct serial_device *arch_serial_get(unsigned int index);
+
+/**
+ * Change the baud rate of an initialized serial device.  Data that is being
+ * sent or received at the same time may get garbled.
+ *
+ * @param dev: serial device to configure
+ * @param baud: new baud rate (bits/sec)
+ * @returns 0 on success, or `-EINVAL` if the port can't run at that rate
+ */
+int arch_serial_set_baud(struct serial_device *dev, long int baud);
+
+/**
+ * Check whether a serial device supports RTS/CTS hardware flow control.
+ *
+ * @param dev: serial device to check
+ * @returns `true` if `arch_serial_set_hwflow()` can be used
+ */
+bool arch_serial_has_hwflow(struct serial_device *dev);
+
+/**
+ * Turn RTS/CTS hardware flow control on or off.  While it is on, the sender
+ * is paused through RTS instead of received data being dropped when the
+ * receive ring is full, and transmission stops while CTS is high.  This does
+ * nothing if the device doesn't support it.
+ *
+ * @param dev: serial device to configure
+ * @param enable: whether to use hardware flow control
+ */
+void arch_serial_set_hwflow(struct serial_device *dev, bool enable);
+
+/**
+ * Called after data was consumed from the receive ring, so that received
+ * data held back by hardware flow control can be moved in.  Must not be
+ * called from irq context.
+ *
+ * @param dev: serial device whose receive ring was read from
+ */
+void arch_serial_rx_drained(struct serial_device *dev);
+
 /**
  * Copy `buf` to a hardware buffer in the TX queue.
  * The transmission is performed asynchronously.
@@ -19,6 +66,47 @@ void arch_serial_exit(struct serial_device *dev);
  */
 ssize_t arch_serial_write(struct serial_device *dev, const void *buf, size_t len);
 
+/**
+ * Gather multiple buffers into a single hardware buffer in the TX queue.
+ * This is the same as `arch_serial_write()`, except that all segments go out
+ * in one transfer.  If the segments don't fit into a single transfer, only
+ * as many bytes as possible are enqueued.
+ *
+ * @param dev: serial device to enqueue the buffers for
+ * @param iov: buffers to enqueue
+ * @param iovcnt: number of entries in `iov`
+ * @returns actual amount of bytes enqueued, or a negative error code on failure
+ */
+ssize_t arch_serial_writev(struct serial_device *dev, const struct iovec *iov, int iovcnt);
+
+/**
+ * Check whether the TX channel is idle, i.e. whether `arch_serial_write()`
+ * would accept new data without returning `-EBUSY`.
+ *
+ * @param dev: serial device to check
+ * @returns `true` if the device is ready for writing
+ */
+bool arch_serial_tx_ready(struct serial_device *dev);
+
+/**
+ * Set the inter-byte timeout for the receiving side.  Once the line has been
+ * silent for this long after receiving something, the irq handler calls
+ * `serial_rx_notify()` with `SERIAL_RX_TIMEOUT`.
+ *
+ * @param dev: serial device to configure
+ * @param ms: timeout in milliseconds, or 0 to disable it
+ */
+void arch_serial_set_rx_timeout(struct serial_device *dev, unsigned int ms);
+
+/**
+ * Send a flow control character (XON/XOFF) ahead of all queued output.
+ * Safe to call from irq context.
+ *
+ * @param dev: serial device to send the character on
+ * @param c: character to send
+ */
+void arch_serial_send_xchar(struct serial_device *dev, uint8_t c);
+
 /**
  * Directly enqueue a DMA buffer to a serial device, resulting in a zero-copy
  * write.  This will increment the buffer's refcount and decrement it again when
@@ -10,6 +10,26 @@
 #define ARCH_SYS_exec		5
 #define ARCH_SYS_exit		6
 #define ARCH_SYS_waitpid	7
+#define ARCH_SYS_poll		8
+#define ARCH_SYS_kevent_stats	9
+#define ARCH_SYS_fcntl		10
+#define ARCH_SYS_readv		11
+#define ARCH_SYS_writev		12
+#define ARCH_SYS_ioring_setup	13
+#define ARCH_SYS_ioring_enter	14
+#define ARCH_SYS_open		15
+#define ARCH_SYS_close		16
+#define ARCH_SYS_lseek		17
+#define ARCH_SYS_mkdir		18
+#define ARCH_SYS_pipe		19
+#define ARCH_SYS_splice		20
+#define ARCH_SYS_rxring_map	21
+#define ARCH_SYS_bcast		22
+#define ARCH_SYS_txbuf_reserve	23
+#define ARCH_SYS_txbuf_commit	24
+#define ARCH_SYS_tcgetattr	25
+#define ARCH_SYS_tcsetattr	26
+#define ARCH_SYS_tcgetstats	27
 
 /*
  * This file is part of Ardix.
@@ -11,6 +11,7 @@ void atom_init(atom_t *atom);
 
 extern int _atom_get(int *count);
 extern int _atom_put(int *count);
+extern int _atom_get_unless_zero(int *count);
 
 __always_inline int atom_get(atom_t *atom)
 {
@@ -22,8 +23,37 @@ __always_inline int atom_put(atom_t *atom)
 	return _atom_put(&atom->count);
 }
 
+/**
+ * @brief Increment the counter, unless it is zero.
+ *
+ * @param atom Counter to increment
+ * @returns The new value, or 0 if the counter was zero and left untouched
+ */
+__always_inline int atom_get_unless_zero(atom_t *atom)
+{
+	return _atom_get_unless_zero(&atom->count);
+}
+
 int atom_count(atom_t *atom);
 
+/**
+ * @brief Atomically clear the lowest set bit in a bitmap.
+ * Safe to use from irq context, this is how lock-free free lists are built.
+ *
+ * @param map Bitmap to claim a bit from
+ * @returns The index of the cleared bit, or -1 if no bit was set
+ */
+extern int atom_claim_bit(unsigned int *map);
+
+/**
+ * @brief Atomically set a bit in a bitmap.
+ * All memory accesses before this call complete before the bit is set.
+ *
+ * @param map Bitmap to modify
+ * @param bit Index of the bit to set
+ */
+extern void atom_set_bit(unsigned int *map, int bit);
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
@@ -0,0 +1,32 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/file.h>
+#include <ardix/types.h>
+
+/**
+ * @brief Move the position of a broadcast read end, see `lseek()`.
+ * Positions are free-running byte counts that wrap around, so unlike for
+ * regular files, the result is not range checked.  Called by `sys_lseek()`
+ * with the file's lock held.
+ *
+ * @param file Read end of a broadcast stream (`FILE_TYPE_BROADCAST`)
+ * @param offset New position, relative to what `whence` specifies
+ * @param whence One of `SEEK_SET`, `SEEK_CUR` and `SEEK_END`
+ * @returns The new position with the top bit cleared, or `-EINVAL`
+ */
+long bcast_lseek(struct file *file, off_t offset, int whence);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
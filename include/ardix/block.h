@@ -0,0 +1,87 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/device.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file block.h
+ * @brief Devices that can only be accessed in units of fixed-size sectors.
+ *
+ * All block devices share a common write-back cache of
+ * `CONFIG_BLOCK_CACHE_SIZE` sectors, which is managed in LRU order.  The
+ * embedded `struct device` provides byte-granular access through the cache,
+ * so partial sector writes only read the sector from the backend once, and
+ * repeated writes to the same sector reach the backend only once.  Dirty
+ * sectors are written back when they get evicted, when the device is closed,
+ * or when `block_sync()` is called; adjacent dirty sectors are always written
+ * back in a single request.  If a read misses the cache right where the
+ * previous one ended, the following `CONFIG_BLOCK_READAHEAD` sectors are
+ * fetched as well.
+ *
+ * Block device I/O may sleep, so it is only possible from syscall context
+ * and not through the I/O ring.
+ */
+
+struct block_device {
+	struct device device;
+	/** @brief Size of a sector in bytes, a power of two up to `CONFIG_BLOCK_SECTOR_SIZE` */
+	size_t sector_size;
+	/** @brief Total number of sectors */
+	uint32_t sector_count;
+	/**
+	 * @brief Read `count` consecutive sectors, starting at `sector`.
+	 * Every entry in `bufs` points to the buffer for one sector.  This may
+	 * sleep.  Returns 0 on success or a negative error code.
+	 */
+	int (*read)(struct block_device *bdev, uint32_t sector, void *const bufs[],
+		    unsigned int count);
+	/**
+	 * @brief Write `count` consecutive sectors, starting at `sector`.
+	 * Every entry in `bufs` points to the data for one sector.  This may
+	 * sleep.  Returns 0 on success or a negative error code.
+	 */
+	int (*write)(struct block_device *bdev, uint32_t sector, const void *const bufs[],
+		     unsigned int count);
+
+	/* first sector after the last read, for detecting sequential access */
+	uint32_t next_sector;
+};
+
+#define device_to_block_device(ptr) container_of(ptr, struct block_device, device)
+
+/**
+ * @brief Initialize a block device and add it to the device tree.
+ * The caller must fill in the sector geometry and the `read` and `write`
+ * callbacks, as well as the `kent` destroy callback of the embedded device.
+ * All other device callbacks are set by this function.
+ *
+ * @param bdev Block device to initialize
+ * @returns 0 on success, or a negative error code
+ */
+int block_device_init(struct block_device *bdev);
+
+/**
+ * @brief Write back all cached dirty sectors of a block device.
+ * Must only be called from syscall context.
+ *
+ * @param bdev Block device to flush
+ * @returns 0 on success, or a negative error code
+ */
+int block_sync(struct block_device *bdev);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,31 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Compute the CRC-32 (IEEE 802.3) checksum of a buffer.
+ * To checksum data in multiple steps, pass the return value of the previous
+ * call as `crc` for the next one.  The first call must pass 0.
+ *
+ * @param crc Checksum of the data preceding `buf`, or 0
+ * @param buf Data to checksum
+ * @param len Length of `buf` in bytes
+ * @returns The updated checksum
+ */
+uint32_t crc32(uint32_t crc, const void *buf, size_t len);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
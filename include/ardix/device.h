@@ -10,15 +10,112 @@
 #include <ardix/types.h>
 #include <ardix/util.h>
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <sys/uio.h>
 #include <toolchain.h>
 
+enum device_flags {
+	/**
+	 * @brief The device cannot operate on user memory directly.
+	 * Reads and writes are copied through a small kernel buffer in
+	 * chunks of `CONFIG_IO_BOUNCE_BUFSZ` bytes.
+	 */
+	DEVICE_BOUNCE_IO	= (1 << 0),
+	/**
+	 * @brief Every successful `read` returns a single record.
+	 * This is the case for terminals in canonical mode, where a record is
+	 * one line.  Reads on streams don't keep going until the device runs
+	 * dry, but return after the first record.
+	 */
+	DEVICE_READ_RECORDS	= (1 << 1),
+};
+
+struct dmabuf;
+struct dmapool;
+struct file;
+struct rxring;
+struct tcstats;
+struct termios;
+
 /** Top-level abstraction for any device connected to the system. */
 struct device {
 	struct kent kent;
 	struct mutex lock;
+	enum device_flags flags;
+	/** @brief Preallocated DMA buffers, if any (see `dmapool_create()`) */
+	struct dmapool *dmapool;
+	/**
+	 * @brief Read up to `size` bytes, without blocking.
+	 * Returns the amount of bytes read, 0 on EOF, or `-EBUSY` if no data
+	 * is available yet.  In the latter case, the device must dispatch a
+	 * `DEVICE_KEVENT_RX` event as soon as there is.
+	 */
 	ssize_t (*read)(void *dest, struct device *device, size_t size, off_t offset);
+	/**
+	 * @brief Write up to `size` bytes, without blocking.
+	 * Returns the amount of bytes written, or `-EBUSY` if the device can't
+	 * accept any data right now.  In the latter case, the device must
+	 * dispatch a `DEVICE_KEVENT_TX` event as soon as it can.
+	 */
 	ssize_t (*write)(struct device *device, const void *src, size_t size, off_t offset);
+	/**
+	 * @brief Gather multiple buffers into a single write operation (optional).
+	 * Returns the total amount of bytes written, which may be less than
+	 * the sum of all segments.  If this is `NULL`, `write` is called
+	 * once for every segment instead.
+	 */
+	ssize_t (*writev)(struct device *device, const struct iovec *iov, int iovcnt, off_t offset);
+	/**
+	 * @brief Get the current I/O readiness state (optional).
+	 * Returns a combination of `POLLIN`, `POLLOUT` and `POLLERR` from
+	 * `<poll.h>` for a file at position `offset`.  Devices without this
+	 * callback are always ready.
+	 */
+	int (*poll)(struct device *device, off_t offset);
+	/**
+	 * @brief Get the total size in bytes (optional).
+	 * Only meaningful for seekable devices, this is used for `SEEK_END`
+	 * and `O_APPEND`.
+	 */
+	ssize_t (*size)(struct device *device);
+	/**
+	 * @brief Called when a file referring to this device is destroyed (optional).
+	 * This happens when the last reference to the file is dropped, i.e.
+	 * when all file descriptors referring to it have been closed.
+	 */
+	void (*close)(struct device *device, struct file *file);
+	/**
+	 * @brief Enqueue a DMA buffer for writing without copying it (optional).
+	 * The device takes its own reference to `buf` and drops it once the
+	 * transfer is complete.  Either the entire buffer is accepted and its
+	 * length is returned, or nothing is and the return value is a negative
+	 * error code (`-EBUSY` has the same meaning as for `write`).
+	 */
+	ssize_t (*write_dma)(struct device *device, struct dmabuf *buf);
+	/**
+	 * @brief Grant `file` direct access to the receive ring (optional).
+	 * Stores the ring in `ring` and returns 0, or returns a negative error
+	 * code.  The mapping is released through `close`.
+	 */
+	int (*map_rx)(struct device *device, struct file *file, struct rxring **ring);
+	/**
+	 * @brief Get the line discipline settings, or set them if `set` is true (optional).
+	 * Returns 0 or a negative error code.  Devices without this callback
+	 * are not terminals.
+	 */
+	int (*tcattr)(struct device *device, struct termios *termios, bool set);
+	/**
+	 * @brief Discard all received data that hasn't been read yet (optional).
+	 * Returns 0 or a negative error code.  This is required for
+	 * `tcsetattr()` with `TCSAFLUSH`.
+	 */
+	int (*tcflush)(struct device *device);
+	/**
+	 * @brief Get the line statistics of a terminal (optional).
+	 * Returns 0 or a negative error code.
+	 */
+	int (*tcstats)(struct device *device, struct tcstats *stats);
 };
 
 /** Cast a kent out to its containing struct device */
@@ -59,6 +156,7 @@ struct device_kevent *device_kevent_create(struct device *device, enum device_ke
 
 /**
  * @brief Convenience wrapper for creating and immediately dispatching a device kevent.
+ * If there are no listeners for device kevents, this does nothing.
  *
  * @param device Device the event refers to
  * @param channel Which channel (in or out) the event applies to
@@ -70,6 +168,10 @@ int devices_init(void);
 
 /**
  * @brief Initialize a device and add it to the device tree.
+ * This clears the flags and sets all callbacks to `NULL`, so drivers only
+ * assign the ones they implement afterwards.  The `kent` destroy callback
+ * and parent have to be set before, or they default to freeing the device
+ * and to the devices kent respectively.
  *
  * @param dev: device to initialze
  * @returns 0 on success, or a negative error code on failure
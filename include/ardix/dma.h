@@ -2,21 +2,58 @@
 
 #pragma once
 
+#include <arch/dma.h>
+
 #include <ardix/device.h>
 #include <ardix/kent.h>
+#include <ardix/kevent.h>
 #include <ardix/types.h>
 
+#include <stdbool.h>
+
+struct dmapool;
+struct task;
+
 struct dmabuf {
 	struct kent kent;
+	/** @brief Pool the buffer belongs to, or `NULL` if it is on the heap */
+	struct dmapool *pool;
 	size_t len;
 	uint8_t data[0];
 };
 
+/**
+ * @brief DMA buffer pool statistics, see `dmapool_stats()`.
+ * All counters are cumulative since the pool was created.
+ */
+struct dmapool_stats {
+	/** @brief Buffers that were taken from the pool */
+	unsigned long int allocated;
+	/** @brief Requests that fell back to the heap because the pool was empty */
+	unsigned long int exhausted;
+	/** @brief Requests that fell back to the heap because they were too large */
+	unsigned long int oversize;
+};
+
+struct dmapool {
+	/** @brief Bit `i` is set if buffer `i` is free */
+	unsigned int free;
+	unsigned int count;
+	/** @brief Maximum `len` of every buffer */
+	size_t bufsz;
+	/** @brief Distance between two buffers in `mem` */
+	size_t stride;
+	struct dmapool_stats stats;
+	uint8_t *mem;
+};
+
 #define kent_to_dmabuf(ptr) container_of(ptr, struct dmabuf, kent)
 
 /**
  * Create a new DMA buffer and its corresponding kent.
  * Use `dmabuf_get` and `dmabuf_put` for refcounting.
+ * If the device has a pool with a free buffer that is large enough, the buffer
+ * is taken from there, otherwise it is allocated from the atomic heap.
  *
  * @param dev: device to create the buffer for
  * @param len: buffer length in bytes
@@ -30,6 +67,145 @@ void dmabuf_get(struct dmabuf *buf);
 /** Decrement a DMA buffer's reference counter. */
 void dmabuf_put(struct dmabuf *buf);
 
+/**
+ * @brief Preallocate a pool of fixed size DMA buffers for a device.
+ * Buffers are taken from and returned to the pool without locking, so
+ * `dmabuf_create()` and `dmabuf_put()` never touch the heap while the pool
+ * has a buffer to spare.  Must be called after `device_init()`.
+ *
+ * @param dev Device to create the pool for
+ * @param count Number of buffers, at most 32
+ * @param bufsz Size of every buffer in bytes
+ * @returns 0 on success, or a negative error code on failure
+ */
+int dmapool_create(struct device *dev, unsigned int count, size_t bufsz);
+
+/**
+ * @brief Release a device's DMA buffer pool.
+ * All buffers from the pool must have been released.
+ *
+ * @param dev Device whose pool to destroy
+ */
+void dmapool_destroy(struct device *dev);
+
+/**
+ * @brief Get a copy of a device's DMA buffer pool statistics.
+ *
+ * @param dev Device to get the statistics of
+ * @param stats Where to store the statistics
+ * @returns 0 on success, or `-ENODEV` if the device has no pool
+ */
+int dmapool_stats(struct device *dev, struct dmapool_stats *stats);
+
+/**
+ * @brief Channel of the DMA controller, see `dma_chan_request()`.
+ * Transfers are described by a chain of `struct dma_desc`, which is set up
+ * with `dma_desc_init()` and `dma_desc_chain()`.
+ */
+struct dma_chan {
+	unsigned int id;
+	/** @brief Whether a transfer is in flight */
+	volatile bool busy;
+	/** @brief Result of the last transfer, 0 or a negative error code */
+	int status;
+	/**
+	 * @brief Task to put back on the run queue when the transfer is done.
+	 * Unlike the `KEVENT_DMA` event, this doesn't depend on allocating
+	 * memory in irq context, so it can't get lost.
+	 */
+	struct task *waiter;
+};
+
+/** @brief Dispatched as `KEVENT_DMA` when a transfer is complete. */
+struct dma_kevent {
+	struct kevent kevent;
+	struct dma_chan *chan;
+	int status;
+};
+
+__always_inline struct dma_kevent *kevent_to_dma_kevent(struct kevent *event)
+{
+	return container_of(event, struct dma_kevent, kevent);
+}
+
+/**
+ * @brief Initialize the DMA controller.
+ * No channels can be requested before this was called.
+ *
+ * @returns 0 on success, or a negative error code on failure
+ */
+int dma_init(void);
+
+/**
+ * @brief Get exclusive access to an idle channel.
+ * Safe to call from irq context.
+ *
+ * @returns The channel, or `NULL` if all channels are taken
+ */
+struct dma_chan *dma_chan_request(void);
+
+/**
+ * @brief Give a channel back.  It must not have a transfer in flight.
+ *
+ * @param chan Channel to release
+ */
+void dma_chan_release(struct dma_chan *chan);
+
+/**
+ * @brief Set up a descriptor for copying memory.
+ *
+ * @param desc Descriptor to set up
+ * @param dest Where to copy to
+ * @param src Where to copy from
+ * @param len Amount of bytes to copy
+ * @returns The amount of bytes the descriptor covers, which may be less
+ *	than `len`; the rest needs another descriptor
+ */
+size_t dma_desc_init(struct dma_desc *desc, void *dest, const void *src, size_t len);
+
+/**
+ * @brief Append a descriptor to another one.
+ *
+ * @param desc Descriptor to append to
+ * @param next Descriptor to append
+ */
+void dma_desc_chain(struct dma_desc *desc, struct dma_desc *next);
+
+/**
+ * @brief Start a transfer.
+ * When the transfer is complete, `busy` is cleared and a `KEVENT_DMA` event
+ * is dispatched.  All descriptors must remain valid until then.
+ *
+ * @param chan Channel to run the transfer on
+ * @param desc First descriptor of the chain
+ * @returns 0 on success, or a negative error code (`-EBUSY` if the channel
+ *	already has a transfer in flight)
+ */
+int dma_submit(struct dma_chan *chan, struct dma_desc *desc);
+
+/**
+ * @brief Called by the irq handler when a transfer is complete.
+ * Clears `busy` and wakes up the channel's `waiter` before anything else.
+ *
+ * @param chan Channel that finished
+ * @param status 0 on success, or a negative error code if the transfer failed
+ */
+void dma_chan_complete(struct dma_chan *chan, int status);
+
+/**
+ * @brief Copy memory using the DMA controller.
+ * The calling task sleeps while the data is moved, so other tasks can run in
+ * the meantime.  Copies shorter than `CONFIG_DMA_MEMCPY_MIN`, ones from
+ * atomic context, and ones for which no channel is available are done by the
+ * CPU instead.  Either way, the copy is complete when this returns.
+ *
+ * @param dest Where to copy to
+ * @param src Where to copy from
+ * @param len Amount of bytes to copy
+ * @returns `dest`
+ */
+void *dma_memcpy(void *dest, const void *src, size_t len);
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
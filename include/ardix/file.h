@@ -7,28 +7,165 @@
 #include <ardix/mutex.h>
 #include <ardix/types.h>
 
+#include <config.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+struct dmabuf;
+
 enum file_type {
+	/** Seekable file, reads block until `len` bytes or EOF */
 	FILE_TYPE_REGULAR,
+	/** Stream, reads return whatever is available */
 	FILE_TYPE_PIPE,
+	/** Stream that keeps its own read position in `pos`, see `bcast()` */
+	FILE_TYPE_BROADCAST,
 };
 
 struct file {
 	struct kent kent;
-	int fd;
 	off_t pos;
 	struct mutex lock;
 	struct device *device;
 	enum file_type type;
+	/** File status flags from `<fcntl.h>` (`O_*`) */
+	int flags;
 };
 
+#define FDTAB_BITS_PER_WORD (sizeof(unsigned long int) * 8)
+
+/**
+ * @brief Per-task file descriptor table.
+ * Only the owning task ever modifies its table (and it is copied on exec),
+ * so lookups don't need a lock.
+ */
+struct fdtab {
+	/** Bit `n` is set if file descriptor `n` is in use */
+	unsigned long int bitmap[(CONFIG_NFILE + FDTAB_BITS_PER_WORD - 1) / FDTAB_BITS_PER_WORD];
+	struct file *files[CONFIG_NFILE];
+};
+
+/**
+ * @brief Create a new file for a device.
+ * The file is not assigned a descriptor yet, use `fd_install()` for that.
+ *
+ * @param dev Device the file operates on
+ * @param type File type
+ * @param err Where to store the error code (will be written 0 on success)
+ * @returns The new file with a reference count of one, or `NULL` on failure
+ */
 struct file *file_create(struct device *dev, enum file_type type, int *err);
 
+/**
+ * @brief Look up a file descriptor of the current task and acquire a reference.
+ * This is lockless and never sleeps.
+ *
+ * @param fd File descriptor
+ * @returns The file, or `NULL` if `fd` is invalid
+ */
 struct file *file_get(int fd);
 void file_put(struct file *file);
 
+/**
+ * @brief Assign the lowest free file descriptor of the current task to a file.
+ * The table acquires its own reference to the file.
+ *
+ * @param file File to install
+ * @returns The new file descriptor, or `-EMFILE` if the table is full
+ */
+int fd_install(struct file *file);
+
+/**
+ * @brief Remove a file descriptor from the current task's table.
+ *
+ * @param fd File descriptor to close
+ * @returns 0 on success, or `-EBADF` if `fd` is invalid
+ */
+int fd_close(int fd);
+
+/**
+ * @brief Copy a file descriptor table, acquiring a reference to every file.
+ * This is used to let new tasks inherit all open files from their parent.
+ *
+ * @param dest Table to initialize
+ * @param src Table to copy
+ */
+void fdtab_clone(struct fdtab *dest, const struct fdtab *src);
+
+/**
+ * @brief Close all file descriptors in a table.
+ *
+ * @param tab Table to release
+ */
+void fdtab_release(struct fdtab *tab);
+
+/**
+ * @brief Write to a file.
+ * If the device is busy, this blocks until at least some data could be
+ * written, unless the file has `O_NONBLOCK` set.
+ *
+ * @param file File to write to
+ * @param buf Data to write
+ * @param len Length of `buf` in bytes
+ * @returns The amount of bytes written, or a negative error code.
+ *	If the file has `O_NONBLOCK` set and no data could be written
+ *	without blocking, this is `-EAGAIN`.
+ */
 ssize_t file_write(struct file *file, const void *buf, size_t len);
+
+/**
+ * @brief Read from a file.
+ * Regular files block until `len` bytes have been read or EOF is reached.
+ * Pipes only block if no data is available at all and return whatever is
+ * there otherwise.  Files with `O_NONBLOCK` set never block.
+ *
+ * @param buf Where to store the data
+ * @param file File to read from
+ * @param len Maximum amount of bytes to read
+ * @returns The amount of bytes read, or a negative error code.
+ *	If the file has `O_NONBLOCK` set and no data is available,
+ *	this is `-EAGAIN`.
+ */
 ssize_t file_read(void *buf, struct file *file, size_t len);
 
+/**
+ * @brief Write multiple buffers to a file.
+ * This behaves like `file_write()`, except that devices supporting it see all
+ * segments at once and can gather them into a single operation.
+ *
+ * @param file File to write to
+ * @param iov Array of buffers to write; this is modified in place
+ * @param iovcnt Number of entries in `iov`
+ * @returns The total amount of bytes written, or a negative error code
+ */
+ssize_t file_writev(struct file *file, struct iovec *iov, int iovcnt);
+
+/**
+ * @brief Write the contents of a DMA buffer to a file.
+ * Devices that support it get the buffer handed over directly, without the
+ * data being copied.  Since the caller typically can't put the data back to
+ * where it came from, this always blocks until the entire buffer has been
+ * written, even if the file has `O_NONBLOCK` set.
+ *
+ * @param file File to write to
+ * @param buf Buffer to write; the caller keeps its own reference
+ * @returns The amount of bytes written, which is only less than `buf->len`
+ *	if an error occurred halfway through, or a negative error code
+ */
+ssize_t file_write_dma(struct file *file, struct dmabuf *buf);
+
+/**
+ * @brief Read from a file into multiple buffers.
+ * This behaves like `file_read()`, except that the data is scattered over
+ * all segments of `iov` in order.
+ *
+ * @param file File to read from
+ * @param iov Array of buffers to read into; this is modified in place
+ * @param iovcnt Number of entries in `iov`
+ * @returns The total amount of bytes read, or a negative error code
+ */
+ssize_t file_readv(struct file *file, struct iovec *iov, int iovcnt);
+
 enum file_kevent_flags {
 	FILE_KEVENT_READ		= (1 << 0),
 	FILE_KEVENT_WRITE		= (1 << 1),
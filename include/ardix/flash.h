@@ -0,0 +1,120 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/device.h>
+
+#include <config.h>
+#include <stddef.h>
+
+/**
+ * @file flash.h
+ * @brief Persistent storage in non-volatile memory.
+ *
+ * The storage area is divided into pages, which are the smallest unit that
+ * can be erased.  Programming a whole page erases it first, so there is no
+ * separate erase operation.  Parts of a page that have been erased before
+ * can also be programmed without erasing the rest of the page.  All access
+ * goes through `flash_read()`, `flash_program()` and `flash_write()`, which
+ * serialize operations on the device lock; most flash controllers can't be
+ * read from while they are busy programming.
+ *
+ * The storage area is shared by the flash filesystem, which uses the first
+ * `CONFIG_FLASHFS_PAGES` pages, and the key-value store, which uses the
+ * `CONFIG_KVSTORE_PAGES` pages after that.
+ */
+
+/** @brief Total number of pages in the storage area. */
+#define FLASH_STORAGE_PAGES (CONFIG_FLASHFS_PAGES + CONFIG_KVSTORE_PAGES)
+
+struct flash {
+	struct device device;
+	/** @brief Size of a single page in bytes */
+	size_t page_size;
+	/** @brief Number of pages in the storage area */
+	unsigned int page_count;
+	/**
+	 * @brief Copy `len` bytes, starting at byte `offset` within `page`.
+	 * Returns 0 on success or a negative error code.
+	 */
+	int (*read)(struct flash *flash, void *dest, unsigned int page, size_t offset, size_t len);
+	/**
+	 * @brief Erase a page and program it with `page_size` bytes from `src`.
+	 * This may sleep until the operation is complete, but must never
+	 * busy wait.  `src` is word aligned.  Returns 0 on success or a
+	 * negative error code, in which case the page contents are undefined.
+	 */
+	int (*program)(struct flash *flash, unsigned int page, const void *src);
+	/**
+	 * @brief Program `len` bytes at byte `offset` within `page` without
+	 * erasing the page first.  The affected area must be erased, and the
+	 * rest of the page remains unchanged.  `src`, `offset` and `len` are
+	 * word aligned.  Same rules as for `program` apply otherwise.
+	 */
+	int (*write)(struct flash *flash, unsigned int page, size_t offset, const void *src,
+		     size_t len);
+};
+
+/** @brief The storage area, or `NULL` if there is none. */
+extern struct flash *flash_storage;
+
+/**
+ * @brief Initialize the storage area.
+ * Must be called after `devices_init()`.
+ *
+ * @returns 0 on success, or a negative error code
+ */
+int flash_init(void);
+
+/**
+ * @brief Read from a page.
+ * Must only be called from syscall context (i.e. not from a kevent listener).
+ *
+ * @param flash Storage to read from
+ * @param dest Where to store the data
+ * @param page Page number
+ * @param offset Byte offset within the page
+ * @param len Number of bytes to read
+ * @returns 0 on success, or a negative error code
+ */
+int flash_read(struct flash *flash, void *dest, unsigned int page, size_t offset, size_t len);
+
+/**
+ * @brief Erase a page and program it with new data.
+ * Must only be called from syscall context.  The calling task is suspended
+ * until programming is complete, so other tasks keep running in the meantime.
+ *
+ * @param flash Storage to program
+ * @param page Page number
+ * @param src Page contents, must be word aligned and exactly one page long
+ * @returns 0 on success, or a negative error code
+ */
+int flash_program(struct flash *flash, unsigned int page, const void *src);
+
+/**
+ * @brief Program part of a page that has been erased before.
+ * Must only be called from syscall context.  The calling task is suspended
+ * until programming is complete.
+ *
+ * @param flash Storage to program
+ * @param page Page number
+ * @param offset Byte offset within the page, must be word aligned
+ * @param src Data to program, must be word aligned
+ * @param len Number of bytes to program, must be a multiple of the word size
+ * @returns 0 on success, or a negative error code
+ */
+int flash_write(struct flash *flash, unsigned int page, size_t offset, const void *src,
+		size_t len);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
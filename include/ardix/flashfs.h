@@ -0,0 +1,42 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/file.h>
+
+/** @brief Paths below this directory refer to files in the flash filesystem. */
+#define FLASHFS_MOUNTPOINT "/flash"
+
+/**
+ * @brief Mount the flash filesystem by scanning the storage area.
+ * Must be called after `flash_init()`.
+ *
+ * @returns 0 on success, or a negative error code
+ */
+int flashfs_init(void);
+
+/**
+ * @brief Open a file in the flash filesystem.
+ * The filesystem has no directories, so `name` must not contain any slashes.
+ * Data written to the file is guaranteed to be persistent once the file has
+ * been closed.
+ *
+ * @param name Name of the file, relative to `FLASHFS_MOUNTPOINT`
+ * @param flags Access mode and flags from `<fcntl.h>`
+ * @param err Where to store the error code (will be written 0 on success)
+ * @returns A new file with a reference count of one, or `NULL` on failure
+ */
+struct file *flashfs_open(const char *name, int flags, int *err);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,26 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+struct task;
+
+/**
+ * @brief Unregister a task's I/O ring and cancel all requests in flight.
+ * Called when the task exits.  Does nothing if the task has no ring.
+ *
+ * @param task Task whose ring to release
+ */
+void ioring_release(struct task *task);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
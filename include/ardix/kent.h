@@ -5,6 +5,8 @@
 #include <ardix/atom.h>
 #include <ardix/types.h>
 
+#include <stdbool.h>
+
 /**
  * struct kent: Kernel Entity
  *
@@ -50,6 +52,16 @@ int kent_init(struct kent *kent);
  */
 void kent_get(struct kent *kent);
 
+/**
+ * Increment the reference counter, unless the kent is already being destroyed.
+ * This never sleeps, so it is safe to use on objects that are only looked up
+ * without any locks held.
+ *
+ * @param kent: The kent.
+ * @returns `true` if a reference was acquired
+ */
+bool kent_tryget(struct kent *kent);
+
 /**
  * Decrement the reference counter.
  * If it reaches zero, the kent is destroyed by invoking the respective callback
@@ -5,6 +5,7 @@
 #include <ardix/kent.h>
 #include <ardix/list.h>
 
+#include <stdbool.h>
 #include <toolchain.h>
 
 /**
@@ -27,6 +28,8 @@ enum kevent_kind {
 	KEVENT_FILE,
 	/** @brief Task has exited */
 	KEVENT_TASK,
+	/** @brief DMA transfer has completed */
+	KEVENT_DMA,
 
 	KEVENT_KIND_COUNT,
 };
@@ -39,6 +42,8 @@ struct kevent {
 	struct kent kent;
 	struct list_head link;	/**< list node for the event queue */
 	enum kevent_kind kind;
+	/** time of dispatch as per `arch_timestamp_us()`, set by `kevent_dispatch()` */
+	unsigned long int timestamp;
 };
 
 /**
@@ -64,6 +69,28 @@ struct kevent_listener {
 	struct list_head link;
 	int (*cb)(struct kevent *event, void *extra);
 	void *extra;
+	enum kevent_kind kind;
+};
+
+/**
+ * @brief Per-kind kevent statistics, see `sys_kevent_stats()`.
+ * All counters are cumulative since boot.
+ */
+struct kevent_stats {
+	/** @brief Events passed to `kevent_dispatch()` */
+	unsigned long int dispatched;
+	/** @brief Events that have been passed to the listeners and released */
+	unsigned long int processed;
+	/** @brief Events that could not be enqueued and were discarded */
+	unsigned long int dropped;
+	/** @brief Events that are currently waiting in the queue */
+	unsigned long int in_flight;
+	/** @brief Total amount of listener callback invocations */
+	unsigned long int listener_calls;
+	/** @brief Maximum time between dispatch and processing in microseconds */
+	unsigned long int latency_max;
+	/** @brief Average time between dispatch and processing in microseconds */
+	unsigned long int latency_avg;
 };
 
 /** @brief Initialize the kevent subsystem. */
@@ -104,6 +131,17 @@ struct kevent_listener *kevent_listener_add(enum kevent_kind kind,
  */
 void kevent_listener_del(struct kevent_listener *listener);
 
+/**
+ * @brief Check whether there is at least one listener for a kind of kevent.
+ * Event sources should call this before creating an event, because events
+ * that nobody listens for are discarded anyway and would only waste memory.
+ * Safe to call from irq context.
+ *
+ * @param kind Kind of kevent to check for
+ * @returns `true` if a listener is registered for `kind`
+ */
+bool kevent_has_listeners(enum kevent_kind kind);
+
 __always_inline void kevent_get(struct kevent *event)
 {
 	kent_get(&event->kent);
@@ -0,0 +1,62 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/types.h>
+
+#include <stddef.h>
+
+/**
+ * @brief Mount the key-value store, formatting it if necessary.
+ * Must be called after `flash_init()`.
+ *
+ * @returns 0 on success, or a negative error code
+ */
+int kvstore_init(void);
+
+/**
+ * @brief Get the value of a key.
+ * Must only be called from syscall context.
+ *
+ * @param key NUL terminated key, up to `CONFIG_KVSTORE_KEYLEN` characters
+ * @param buf Where to store the value
+ * @param len Size of `buf`; if the value is larger, it is truncated
+ * @returns The total length of the value (which may exceed `len`),
+ *	`-ENOENT` if the key doesn't exist, or another negative error code
+ */
+ssize_t kvstore_get(const char *key, void *buf, size_t len);
+
+/**
+ * @brief Create a key or change its value.
+ * Must only be called from syscall context.  The new value is persistent as
+ * soon as this function returns.
+ *
+ * @param key NUL terminated key, up to `CONFIG_KVSTORE_KEYLEN` characters
+ * @param value New value
+ * @param len Length of `value` in bytes
+ * @returns 0 on success, or a negative error code
+ */
+int kvstore_set(const char *key, const void *value, size_t len);
+
+/**
+ * @brief Delete a key.
+ * Must only be called from syscall context.
+ *
+ * @param key NUL terminated key
+ * @returns 0 on success, `-ENOENT` if the key doesn't exist, or another
+ *	negative error code
+ */
+int kvstore_delete(const char *key);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,33 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/block.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Create a new block device backed by zeroed memory.
+ * The device is destroyed, and its memory released, when its last reference
+ * is dropped.
+ *
+ * @param sector_size Size of a single sector in bytes
+ * @param sector_count Total number of sectors
+ * @param err Where to store the error code (will be written 0 on success)
+ * @returns The new block device with a reference count of one, or `NULL`
+ */
+struct block_device *ramdisk_create(size_t sector_size, uint32_t sector_count, int *err);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
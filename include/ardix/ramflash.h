@@ -0,0 +1,34 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/flash.h>
+
+#include <stddef.h>
+
+/**
+ * @brief Create a new storage area backed by erased memory.
+ * Programming behaves like NOR flash: `program` erases the page first, and
+ * `write` can only clear bits, so writing to an area that hasn't been erased
+ * yields the bitwise AND of the old and new data.  The device is destroyed,
+ * and its memory released, when its last reference is dropped.
+ *
+ * @param page_size Size of a single page in bytes, must be a multiple of 4
+ * @param page_count Total number of pages
+ * @param err Where to store the error code (will be written 0 on success)
+ * @returns The new storage area with a reference count of one, or `NULL`
+ */
+struct flash *ramflash_create(size_t page_size, unsigned int page_count, int *err);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,66 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/types.h>
+
+#include <rxring.h>
+
+/*
+ * Kernel side of `struct rxring`, which is the kernel's single producer,
+ * single consumer ring buffer.  Besides device receive buffers, it also backs
+ * pipes.  There must only be a single producer (e.g. an irq handler) and a
+ * single consumer, which is either the kernel or a task that has mapped the
+ * ring.  Neither of them needs to lock anything because each index is only
+ * ever written by one side.
+ */
+
+/**
+ * @brief Create a new receive ring.
+ *
+ * @param size Capacity in bytes, must be a power of two
+ * @returns The ring, or `NULL` if `size` is invalid or we are out of memory
+ */
+struct rxring *rxring_create(unsigned int size);
+
+/** @brief Destroy a ring created with `rxring_create()`. */
+void rxring_destroy(struct rxring *ring);
+
+/** @brief Get the amount of bytes available for reading. */
+__always_inline unsigned int rxring_len(const struct rxring *ring)
+{
+	return ring->head - ring->tail;
+}
+
+/** @brief Get the amount of bytes that can be written without overflowing. */
+__always_inline unsigned int rxring_space(const struct rxring *ring)
+{
+	return ring->size - rxring_len(ring);
+}
+
+/**
+ * @brief Append up to `len` bytes (producer side).
+ *
+ * @returns The amount of bytes written, less than `len` if the ring is full
+ */
+size_t rxring_write(struct rxring *ring, const void *src, size_t len);
+
+/**
+ * @brief Consume up to `len` bytes (consumer side).
+ *
+ * @returns The amount of bytes read
+ */
+size_t rxring_read(void *dest, struct rxring *ring, size_t len);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -3,18 +3,47 @@
 #pragma once
 
 #include <ardix/device.h>
+#include <ardix/rxring.h>
 #include <ardix/types.h>
-#include <ardix/ringbuf.h>
 
+#include <stdbool.h>
+#include <termios.h>
 #include <toolchain.h>
 
+/** Directory the serial ports appear in as `ttyS0`, `ttyS1` and so on */
+#define SERIAL_DEVDIR "/dev"
+
 struct serial_device {
 	struct device device;
-	struct ringbuf *rx;
+	/** Receive ring, `NULL` until the device is initialized */
+	struct rxring *rx;
+	/** Capacity of `rx` in bytes (power of two), set up by the architecture */
+	unsigned int rx_bufsz;
+	/** File that has `rx` mapped through `rxring_map()`, if any */
+	struct file *rx_owner;
+	/** Line discipline settings (see `tcsetattr()`) */
+	struct termios termios;
+	/** Index in `rx` up to which we have looked for newlines */
+	unsigned int rx_scan;
+	/** Set when the line went silent for `VTIME` with less than `VMIN` bytes */
+	bool rx_expired;
+	/** Fill levels of `rx` at which the sender is paused and resumed (`IXOFF`) */
+	unsigned int rx_hiwat;
+	unsigned int rx_lowat;
+	/** Whether we have sent `VSTOP` and are waiting for `rx` to drain */
+	bool rx_stopped;
+	struct tcstats stats;
 	long int baud;
 	int id;
 };
 
+enum serial_rx_event {
+	/** New data was written to the receive ring */
+	SERIAL_RX_DATA,
+	/** The inter-byte timeout set by `arch_serial_set_rx_timeout()` expired */
+	SERIAL_RX_TIMEOUT,
+};
+
 /** The default serial console (this is where printk outputs to) */
 extern struct serial_device *serial_default_device;
 
@@ -30,6 +59,17 @@ int serial_init(struct serial_device *dev, long int baud);
 /** Flush all buffers (if possible) and close the serial device. */
 void serial_exit(struct serial_device *dev);
 
+/**
+ * Open a serial port, and initialize it at its default baud rate if this
+ * hasn't happened yet.
+ *
+ * @param name: name of the port relative to `SERIAL_DEVDIR`, e.g. `ttyS1`
+ * @param flags: flags passed to `open()`
+ * @param err: where to store the error code
+ * @returns the new file, or `NULL` on failure
+ */
+struct file *serial_open(const char *name, int flags, int *err);
+
 /**
  * Read from the serial buffer.
  *
@@ -50,6 +90,34 @@ ssize_t serial_read(void *dest, struct serial_device *dev, size_t len);
  */
 ssize_t serial_write(struct serial_device *dev, const void *data, size_t len);
 
+/**
+ * Write multiple buffers to the serial device in a single transfer.
+ *
+ * @param dev: serial device to write to
+ * @param iov: buffers to write
+ * @param iovcnt: number of entries in `iov`
+ * @returns actual amount of bytes written
+ */
+ssize_t serial_writev(struct serial_device *dev, const struct iovec *iov, int iovcnt);
+
+/**
+ * Called by the irq handlers when something happened on the receiving side.
+ * Applies the line discipline and wakes up readers if their read can be
+ * satisfied, i.e. once per line in canonical mode.
+ *
+ * @param dev: serial device that received data
+ * @param event: what happened
+ */
+void serial_rx_notify(struct serial_device *dev, enum serial_rx_event event);
+
+/**
+ * Get the I/O readiness state of a serial device.
+ *
+ * @param dev: serial device to check
+ * @returns a combination of `POLLIN` and `POLLOUT`
+ */
+int serial_poll(struct serial_device *dev);
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
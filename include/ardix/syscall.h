@@ -4,9 +4,15 @@
 
 #include <arch-generic/syscall.h>
 
+#include <ardix/kevent.h>
 #include <ardix/types.h>
 
 #include <errno.h>
+#include <ioring.h>
+#include <poll.h>
+#include <rxring.h>
+#include <termios.h>
+#include <sys/uio.h>
 #include <toolchain.h>
 
 enum syscall {
@@ -18,6 +24,26 @@ enum syscall {
 	SYS_exec		= ARCH_SYS_exec,
 	SYS_exit		= ARCH_SYS_exit,
 	SYS_waitpid		= ARCH_SYS_waitpid,
+	SYS_poll		= ARCH_SYS_poll,
+	SYS_kevent_stats	= ARCH_SYS_kevent_stats,
+	SYS_fcntl		= ARCH_SYS_fcntl,
+	SYS_readv		= ARCH_SYS_readv,
+	SYS_writev		= ARCH_SYS_writev,
+	SYS_ioring_setup	= ARCH_SYS_ioring_setup,
+	SYS_ioring_enter	= ARCH_SYS_ioring_enter,
+	SYS_open		= ARCH_SYS_open,
+	SYS_close		= ARCH_SYS_close,
+	SYS_lseek		= ARCH_SYS_lseek,
+	SYS_mkdir		= ARCH_SYS_mkdir,
+	SYS_pipe		= ARCH_SYS_pipe,
+	SYS_splice		= ARCH_SYS_splice,
+	SYS_rxring_map		= ARCH_SYS_rxring_map,
+	SYS_bcast		= ARCH_SYS_bcast,
+	SYS_txbuf_reserve	= ARCH_SYS_txbuf_reserve,
+	SYS_txbuf_commit	= ARCH_SYS_txbuf_commit,
+	SYS_tcgetattr		= ARCH_SYS_tcgetattr,
+	SYS_tcsetattr		= ARCH_SYS_tcsetattr,
+	SYS_tcgetstats		= ARCH_SYS_tcgetstats,
 	NSYSCALLS
 };
 
@@ -39,6 +65,26 @@ void sys_free(void *ptr);
 long sys_exec(int (*entry)(void));
 void sys_exit(int code);
 long sys_waitpid(pid_t pid, int *stat_loc, int options);
+long sys_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+long sys_kevent_stats(enum kevent_kind kind, struct kevent_stats *stats);
+long sys_fcntl(int fd, int cmd, int arg);
+long sys_readv(int fd, const struct iovec *iov, int iovcnt);
+long sys_writev(int fd, const struct iovec *iov, int iovcnt);
+long sys_ioring_setup(struct ioring *ring);
+long sys_ioring_enter(unsigned int to_submit, unsigned int min_complete);
+long sys_open(const char *path, int flags);
+long sys_close(int fd);
+long sys_lseek(int fd, off_t offset, int whence);
+long sys_mkdir(const char *path);
+long sys_pipe(int fildes[2]);
+long sys_splice(int fd_in, int fd_out, size_t len);
+long sys_rxring_map(int fd, struct rxring **ring);
+long sys_bcast(int fildes[], unsigned int nreaders);
+long sys_txbuf_reserve(int fd, size_t len, void **data);
+long sys_txbuf_commit(size_t len);
+long sys_tcgetattr(int fd, struct termios *termios);
+long sys_tcsetattr(int fd, int optional_actions, const struct termios *termios);
+long sys_tcgetstats(int fd, struct tcstats *stats);
 
 /*
  * This file is part of Ardix.
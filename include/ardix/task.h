@@ -4,6 +4,7 @@
 
 #include <arch/hardware.h>
 
+#include <ardix/file.h>
 #include <ardix/kent.h>
 #include <ardix/kevent.h>
 #include <ardix/malloc.h>
@@ -27,6 +28,9 @@ enum task_state {
 	TASK_WAITPID,
 };
 
+struct dmabuf;
+struct ioring_ctx;
+
 /** @brief Core structure holding information about a task. */
 struct task {
 	struct tcb tcb;
@@ -51,6 +55,16 @@ struct task {
 	struct list_head pending_sigchld;
 	struct mutex pending_sigchld_lock;
 
+	/** @brief Open file descriptors */
+	struct fdtab fdtab;
+
+	/** @brief Registered I/O ring, if any (see `ioring_setup()`) */
+	struct ioring_ctx *ioring;
+	/** @brief Reserved transmit buffer, if any (see `txbuf_reserve()`) */
+	struct dmabuf *txbuf;
+	/** @brief File that `txbuf` is reserved for */
+	struct file *txbuf_file;
+
 	enum task_state state;
 	pid_t pid;
 };
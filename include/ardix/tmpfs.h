@@ -0,0 +1,44 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/file.h>
+
+/**
+ * @brief Initialize the in-memory filesystem with an empty root directory.
+ * Must be called after `devices_init()`.
+ *
+ * @returns 0 on success, or a negative error code
+ */
+int tmpfs_init(void);
+
+/**
+ * @brief Open a file in the in-memory filesystem.
+ *
+ * @param path Absolute path to the file; this is modified during the lookup
+ * @param flags Access mode and flags from `<fcntl.h>`
+ * @param err Where to store the error code (will be written 0 on success)
+ * @returns A new file with a reference count of one, or `NULL` on failure
+ */
+struct file *tmpfs_open(char *path, int flags, int *err);
+
+/**
+ * @brief Create a new directory.
+ *
+ * @param path Absolute path to the directory; this is modified during the lookup
+ * @returns 0 on success, or a negative error code
+ */
+int tmpfs_mkdir(char *path);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,26 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+struct task;
+
+/**
+ * @brief Drop a task's transmit buffer reservation, if any.
+ * Called when the task exits.
+ *
+ * @param task Task whose reservation to drop
+ */
+void txbuf_release(struct task *task);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -4,8 +4,22 @@
 
 #include <ardix/types.h>
 
+#include <stdbool.h>
+#include <sys/uio.h>
 #include <toolchain.h>
 
+/**
+ * Check whether a memory area in user space may be accessed by the kernel.
+ * This should be done once for every buffer passed to a syscall, so that
+ * subsystems further down may operate on the user buffer directly.
+ *
+ * @param ptr: start of the memory area
+ * @param len: length of the memory area in bytes
+ * @param write: whether the kernel is going to write to the area
+ * @returns `true` if the area is valid
+ */
+bool access_ok(__user const void *ptr, size_t len, bool write);
+
 /**
  * Copy data from user space to kernel space.
  *
@@ -26,6 +40,28 @@ size_t copy_from_user(void *dest, __user const void *src, size_t len);
  */
 size_t copy_to_user(__user void *dest, __user const void *src, size_t len);
 
+/**
+ * Copy a NUL terminated string from user space to kernel space.
+ *
+ * @param dest: where to copy to
+ * @param src: string in user space
+ * @param size: size of `dest` in bytes, including the NUL terminator
+ * @returns the length of the string, `-EFAULT` if `src` is invalid,
+ *	or `-ENAMETOOLONG` if the string doesn't fit into `dest`
+ */
+long strncpy_from_user(char *dest, __user const char *src, size_t size);
+
+/**
+ * Copy an iovec array from user space and validate all of its segments.
+ *
+ * @param dest: where to copy the array to, must have room for `iovcnt` entries
+ * @param src: array in user space
+ * @param iovcnt: number of entries in `src`, at most `IOV_MAX`
+ * @param write: whether the kernel is going to write to the segments
+ * @returns the total length of all segments, or a negative error code
+ */
+long copy_iov_from_user(struct iovec *dest, __user const struct iovec *src, int iovcnt, bool write);
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
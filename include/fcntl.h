@@ -0,0 +1,65 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <toolchain.h>
+
+/** Open for reading only */
+#define O_RDONLY	0
+/** Open for writing only */
+#define O_WRONLY	(1 << 0)
+/** Open for reading and writing */
+#define O_RDWR		(1 << 1)
+/** Mask for the file access modes */
+#define O_ACCMODE	(O_RDONLY | O_WRONLY | O_RDWR)
+
+/** Return `-EAGAIN` instead of blocking if no I/O is possible */
+#define O_NONBLOCK	(1 << 2)
+/** Move to the end of the file before every write */
+#define O_APPEND	(1 << 3)
+/** Create the file if it doesn't exist */
+#define O_CREAT		(1 << 4)
+/** Fail if the file exists (only together with `O_CREAT`) */
+#define O_EXCL		(1 << 5)
+/** Truncate the file to zero length if it is opened for writing */
+#define O_TRUNC		(1 << 6)
+
+/** Get file status flags */
+#define F_GETFL		3
+/** Set file status flags */
+#define F_SETFL		4
+
+/**
+ * @brief Open a file.
+ * Currently, only files in the in-memory filesystem can be opened, and paths
+ * must be absolute.
+ *
+ * @param path Path to the file
+ * @param flags Exactly one of `O_RDONLY`, `O_WRONLY` and `O_RDWR`, optionally
+ *	combined with `O_APPEND`, `O_CREAT`, `O_EXCL`, `O_NONBLOCK` and `O_TRUNC`
+ * @returns The new file descriptor, or a negative error code
+ */
+__shared int open(const char *path, int flags, ...);
+
+/**
+ * @brief Perform an operation on an open file descriptor.
+ * Currently, only `F_GETFL` and `F_SETFL` are supported.
+ *
+ * @param fildes File descriptor to operate on
+ * @param cmd Operation to perform
+ * @returns A value depending on `cmd`, or a negative error code
+ */
+__shared int fcntl(int fildes, int cmd, ...);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
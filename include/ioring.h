@@ -0,0 +1,109 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <toolchain.h>
+
+/**
+ * @file ioring.h
+ * @brief Asynchronous I/O through shared submission and completion rings.
+ *
+ * A task sets up a `struct ioring` in its own memory and registers it with
+ * `ioring_setup()`.  Requests are queued by filling in the submission queue
+ * entry at `sq_tail` and then incrementing `sq_tail`; `ioring_enter()` tells
+ * the kernel to pick them up.  Requests that can't complete immediately stay
+ * in flight and are finished by the kernel as soon as the device becomes
+ * ready, without any further syscalls.  Completions are posted to the
+ * completion ring at `cq_tail`, and the task consumes them by incrementing
+ * `cq_head`.
+ *
+ * All indices are free-running, i.e. they are only ever incremented and the
+ * actual array index is obtained by masking them with `entries - 1`.
+ */
+
+enum ioring_op {
+	/** Do nothing, just post a completion */
+	IORING_OP_NOP = 0,
+	/** Equivalent to `read()` */
+	IORING_OP_READ,
+	/** Equivalent to `write()` */
+	IORING_OP_WRITE,
+};
+
+/** Submission queue entry */
+struct ioring_sqe {
+	/** Operation to perform (`enum ioring_op`) */
+	uint8_t opcode;
+	/** File descriptor to operate on */
+	int fd;
+	/** Buffer to read into or write from */
+	void *buf;
+	/** Length of `buf` in bytes */
+	size_t len;
+	/** Arbitrary value that is copied to the completion */
+	uintptr_t user_data;
+};
+
+/** Completion queue entry */
+struct ioring_cqe {
+	/** `user_data` from the submission queue entry */
+	uintptr_t user_data;
+	/** Result of the operation, same as the return value of the syscall */
+	long res;
+};
+
+struct ioring {
+	/** Next submission the kernel will consume (written by the kernel) */
+	volatile unsigned int sq_head;
+	/** Next free submission slot (written by the task) */
+	volatile unsigned int sq_tail;
+	/** Size of `sqes`, must be a power of two */
+	unsigned int sq_entries;
+	struct ioring_sqe *sqes;
+
+	/** Next completion the task will consume (written by the task) */
+	volatile unsigned int cq_head;
+	/** Next free completion slot (written by the kernel) */
+	volatile unsigned int cq_tail;
+	/** Size of `cqes`, must be a power of two */
+	unsigned int cq_entries;
+	struct ioring_cqe *cqes;
+};
+
+/**
+ * @brief Register an I/O ring for the calling task.
+ * The ring and its arrays must stay valid until the task exits or the ring
+ * is unregistered.  The entry counts and array pointers are copied when the
+ * ring is registered, changing them later has no effect.
+ *
+ * @param ring The ring to register, or `NULL` to unregister the current one.
+ *	Any requests still in flight are canceled when unregistering.
+ * @returns 0 on success, or a negative error code
+ */
+__shared int ioring_setup(struct ioring *ring);
+
+/**
+ * @brief Submit queued requests and optionally wait for completions.
+ *
+ * @param to_submit Maximum amount of submission queue entries to consume
+ * @param min_complete Block until at least this many completions are
+ *	available in the completion ring, or no more requests are in flight
+ * @returns The amount of consumed submission queue entries,
+ *	or a negative error code
+ */
+__shared int ioring_enter(unsigned int to_submit, unsigned int min_complete);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
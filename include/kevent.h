@@ -0,0 +1,30 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/kevent.h>
+
+#include <toolchain.h>
+
+/**
+ * @brief Get the statistics of one kind of kevent (non-standard).
+ *
+ * @param kind Kind of kevent to get the statistics for
+ * @param stats Where to store the statistics
+ * @returns 0 on success, or a negative error code (`-EINVAL` if `kind` is
+ *	out of range)
+ */
+__shared int kevent_stats(enum kevent_kind kind, struct kevent_stats *stats);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
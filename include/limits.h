@@ -27,6 +27,9 @@
 #define ULLONG_MAX		((unsigned long long)0 - 1)
 #define ULLONG_MIN		((unsigned long long)0)
 
+/** Maximum number of segments in a `readv()` or `writev()` call */
+#define IOV_MAX			16
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
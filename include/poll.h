@@ -0,0 +1,55 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdint.h>
+#include <toolchain.h>
+
+/** Data may be read without blocking. */
+#define POLLIN		(1 << 0)
+/** High priority data may be read without blocking (unused). */
+#define POLLPRI		(1 << 1)
+/** Data may be written without blocking. */
+#define POLLOUT		(1 << 2)
+/** An error has occurred (`revents` only). */
+#define POLLERR		(1 << 3)
+/** The device has been disconnected (`revents` only). */
+#define POLLHUP		(1 << 4)
+/** Invalid `fd` member (`revents` only). */
+#define POLLNVAL	(1 << 5)
+
+typedef unsigned int nfds_t;
+
+struct pollfd {
+	/** File descriptor to poll, negative values are ignored */
+	int fd;
+	/** Requested events */
+	short events;
+	/** Returned events, set by the kernel */
+	short revents;
+};
+
+/**
+ * @brief Wait for one of a set of file descriptors to become ready for I/O.
+ *
+ * @param fds Array of file descriptors and the events to watch for
+ * @param nfds Number of entries in `fds`
+ * @param timeout Maximum time to wait in milliseconds, or a negative value to
+ *	wait indefinitely.  If zero, `poll()` returns immediately.
+ * @returns The number of entries in `fds` with a nonzero `revents` member,
+ *	0 if the timeout expired, or a negative error code
+ */
+__shared int poll(struct pollfd fds[], nfds_t nfds, int timeout);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
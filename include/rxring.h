@@ -0,0 +1,58 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdint.h>
+#include <toolchain.h>
+
+/**
+ * @file rxring.h
+ * @brief Direct access to a device's receive buffer.
+ *
+ * `rxring_map()` hands out the ring buffer that a device stores received data
+ * in, so a task can consume it in place without a syscall or copy per read.
+ * The kernel appends data at `head` and the task consumes it by advancing
+ * `tail`.  Both indices are free-running, i.e. they are only ever incremented
+ * and the byte at index `i` is at `data[i & (size - 1)]`.  There are
+ * `head - tail` bytes available; if the ring is full, new data is dropped.
+ *
+ * Read `head` before touching the data it covers, and only write `tail` after
+ * you are done with the data, or the compiler may reorder the accesses.
+ * If the ring is empty, `poll()` with `POLLIN` blocks until data arrives.
+ */
+
+struct rxring {
+	/** Capacity of `data` in bytes, always a power of two */
+	unsigned int size;
+	/** Total amount of bytes received (written by the kernel) */
+	volatile unsigned int head;
+	/** Total amount of bytes consumed (written by the task) */
+	volatile unsigned int tail;
+	uint8_t data[];
+};
+
+/**
+ * @brief Map the receive ring of a device.
+ * Only one file can have a device's ring mapped at a time, and the mapping
+ * is released when that file is closed.  While the ring is mapped, the task
+ * is the only consumer and `read()` on the device fails with `-EACCES`.
+ *
+ * @param fildes File descriptor of the device, must be open for reading
+ * @param ring Where to store the address of the ring
+ * @returns 0 on success, or a negative error code (`-ENODEV` if the device
+ *	doesn't support this, `-EBUSY` if another file has it mapped)
+ */
+__shared int rxring_map(int fildes, struct rxring **ring);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
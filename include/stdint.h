@@ -67,6 +67,8 @@ typedef __UINT64_TYPE__		uint_fast64_t;
 #define UINT32_MAX		0xffffffffu
 #define UINT64_MAX		0xffffffffffffffffu
 
+#define SIZE_MAX		__SIZE_MAX__
+
 #define INT_LEAST8_MIN		-0x80
 #define INT_LEAST16_MIN		-0x8000
 #define INT_LEAST32_MIN		-0x80000000
@@ -6,6 +6,18 @@
 
 #include <toolchain.h>
 
+/**
+ * Compare the first `n` bytes of the memory areas `s1` and `s2`.
+ *
+ * @param s1: The first memory area.
+ * @param s2: The second memory area.
+ * @param n: The amount of bytes to compare.
+ * @returns `0` if both areas are equal, a positive value if the first
+ *	differing byte in `s1` is greater than the one in `s2`, and a negative
+ *	value if it is less.
+ */
+__shared int memcmp(const void *s1, const void *s2, size_t n);
+
 /**
  * Copy `n` bytes from `src` to `dest`.
  *
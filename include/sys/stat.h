@@ -0,0 +1,29 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <toolchain.h>
+
+/**
+ * @brief Create a new directory.
+ * Currently, directories can only be created in the in-memory filesystem,
+ * and paths must be absolute.
+ *
+ * @param path Path to the new directory
+ * @param mode Ignored, there are no file permissions
+ * @returns 0 on success, or a negative error code
+ */
+__shared int mkdir(const char *path, unsigned int mode);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
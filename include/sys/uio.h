@@ -0,0 +1,50 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <toolchain.h>
+
+/** A single buffer segment for vectored I/O. */
+struct iovec {
+	/** Start of the segment */
+	void *iov_base;
+	/** Length of the segment in bytes */
+	size_t iov_len;
+};
+
+/**
+ * @brief Read from a file into multiple buffers.
+ * The buffers are filled in order, each one completely before the next one.
+ *
+ * @param fildes File descriptor to read from
+ * @param iov Array of buffers to read into
+ * @param iovcnt Number of entries in `iov`, at most `IOV_MAX`
+ * @returns The total amount of bytes read, or a negative error code
+ */
+__shared ssize_t readv(int fildes, const struct iovec *iov, int iovcnt);
+
+/**
+ * @brief Write data from multiple buffers to a file.
+ * Devices that support it gather all buffers into a single operation.
+ *
+ * @param fildes File descriptor to write to
+ * @param iov Array of buffers to write
+ * @param iovcnt Number of entries in `iov`, at most `IOV_MAX`
+ * @returns The total amount of bytes written, or a negative error code
+ */
+__shared ssize_t writev(int fildes, const struct iovec *iov, int iovcnt);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
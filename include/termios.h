@@ -0,0 +1,187 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <toolchain.h>
+
+typedef unsigned int tcflag_t;
+typedef unsigned char cc_t;
+/** Baud rate in bits per second; unlike on most systems, `Bxxx` are plain numbers. */
+typedef unsigned long int speed_t;
+
+/** Index of the minimum amount of bytes for a non-canonical read in `c_cc`. */
+#define VMIN		0
+/** Index of the inter-byte timeout in tenths of a second in `c_cc`. */
+#define VTIME		1
+/** Index of the character that resumes the sender (XON) in `c_cc`. */
+#define VSTART		2
+/** Index of the character that pauses the sender (XOFF) in `c_cc`. */
+#define VSTOP		3
+/** Size of `c_cc`. */
+#define NCCS		4
+
+/**
+ * Input flow control (`c_iflag`): send `VSTOP` when the receive buffer is
+ * getting full, and `VSTART` once it has been drained again.
+ */
+#define IXOFF		(1 << 0)
+
+/**
+ * RTS/CTS hardware flow control (`c_cflag`): the sender is paused through RTS
+ * when the receive buffer is full, and we stop sending while CTS is high.
+ * Only USART0-2 (`ttyS1`-`ttyS3`) support this.
+ */
+#define CRTSCTS		(1 << 0)
+
+/** Canonical mode: reads are only satisfied by complete lines (`c_lflag`). */
+#define ICANON		(1 << 0)
+
+/*
+ * Common baud rates.  Any other rate the hardware can generate is accepted
+ * as well, the debug UART goes up to MCK / 16 and the USARTs to MCK / 8.
+ */
+#define B0		0ul
+#define B9600		9600ul
+#define B19200		19200ul
+#define B38400		38400ul
+#define B57600		57600ul
+#define B115200		115200ul
+#define B230400		230400ul
+#define B460800		460800ul
+#define B921600		921600ul
+#define B1000000	1000000ul
+#define B2000000	2000000ul
+#define B3000000	3000000ul
+#define B4000000	4000000ul
+
+/** Apply the changes immediately. */
+#define TCSANOW		0
+/** Same as `TCSANOW`, output is not drained first. */
+#define TCSADRAIN	1
+/** Apply the changes and discard all input that hasn't been read yet. */
+#define TCSAFLUSH	2
+
+/**
+ * @brief Line discipline settings of a terminal.
+ *
+ * In canonical mode, `read()` blocks until a complete line (including the
+ * newline) has arrived or the receive buffer is full, and returns at most one
+ * line.  Otherwise, it blocks until at least `c_cc[VMIN]` bytes are available,
+ * or the line has been silent for `c_cc[VTIME]` tenths of a second after at
+ * least one byte has arrived.  A `VMIN` of 0 is treated as 1, and a `VTIME`
+ * of 0 disables the timeout.  Readers are only woken up when one of these
+ * conditions is met, not for every byte.
+ */
+struct termios {
+	tcflag_t c_iflag;
+	tcflag_t c_oflag;
+	tcflag_t c_cflag;
+	tcflag_t c_lflag;
+	cc_t c_cc[NCCS];
+	/**
+	 * Input and output baud rates, which must be the same (or `c_ispeed`
+	 * 0).  A `c_ospeed` of `B0` leaves the current rate unchanged, there
+	 * is no modem connection to hang up.
+	 */
+	speed_t c_ispeed;
+	speed_t c_ospeed;
+};
+
+/**
+ * @brief Line statistics of a terminal, see `tcgetstats()`.
+ * All counters are cumulative since the terminal was initialized.
+ */
+struct tcstats {
+	/** @brief Bytes received, including dropped ones */
+	unsigned long int rx_bytes;
+	/** @brief Bytes queued for transmission */
+	unsigned long int tx_bytes;
+	/** @brief Hardware overruns, each of which lost at least one byte */
+	unsigned long int overruns;
+	/** @brief Bytes received with a framing error */
+	unsigned long int frame_errors;
+	/** @brief Bytes dropped because the receive buffer was full */
+	unsigned long int dropped;
+	/** @brief Times the sender was paused through `VSTOP` */
+	unsigned long int xoff;
+};
+
+/**
+ * @brief Get the line discipline settings of a terminal.
+ *
+ * @param fildes File descriptor of the terminal
+ * @param termios_p Where to store the settings
+ * @returns 0 on success, or a negative error code (`-ENOTTY` if `fildes`
+ *	doesn't refer to a terminal)
+ */
+__shared int tcgetattr(int fildes, struct termios *termios_p);
+
+/**
+ * @brief Change the line discipline settings of a terminal.
+ *
+ * @param fildes File descriptor of the terminal
+ * @param optional_actions One of `TCSANOW`, `TCSADRAIN` and `TCSAFLUSH`
+ * @param termios_p The new settings
+ * @returns 0 on success, or a negative error code (`-ENOTTY` if `fildes`
+ *	doesn't refer to a terminal, `-EINVAL` if the baud rate or `CRTSCTS` is unsupported)
+ */
+__shared int tcsetattr(int fildes, int optional_actions, const struct termios *termios_p);
+
+/**
+ * @brief Get the input baud rate from a `struct termios`.
+ *
+ * @param termios_p The settings to get the baud rate from
+ * @returns The baud rate
+ */
+__shared speed_t cfgetispeed(const struct termios *termios_p);
+
+/**
+ * @brief Get the output baud rate from a `struct termios`.
+ *
+ * @param termios_p The settings to get the baud rate from
+ * @returns The baud rate
+ */
+__shared speed_t cfgetospeed(const struct termios *termios_p);
+
+/**
+ * @brief Set the input baud rate in a `struct termios`.
+ * This only takes effect when the settings are passed to `tcsetattr()`.
+ *
+ * @param termios_p The settings to modify
+ * @param speed The new baud rate, or 0 for the same as the output rate
+ * @returns 0
+ */
+__shared int cfsetispeed(struct termios *termios_p, speed_t speed);
+
+/**
+ * @brief Set the output baud rate in a `struct termios`.
+ * This only takes effect when the settings are passed to `tcsetattr()`.
+ *
+ * @param termios_p The settings to modify
+ * @param speed The new baud rate
+ * @returns 0
+ */
+__shared int cfsetospeed(struct termios *termios_p, speed_t speed);
+
+/**
+ * @brief Get the line statistics of a terminal (non-standard).
+ *
+ * @param fildes File descriptor of the terminal
+ * @param stats Where to store the statistics
+ * @returns 0 on success, or a negative error code (`-ENOTTY` if `fildes`
+ *	doesn't refer to a terminal)
+ */
+__shared int tcgetstats(int fildes, struct tcstats *stats);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -53,6 +53,9 @@
 /** Function attribute for hinting this function has malloc-like behavior. */
 #define __malloc(deallocator, argn) __attribute__(( malloc ))
 
+/** Prevent the compiler from moving memory accesses across this point. */
+#define barrier() __asm__ volatile("" ::: "memory")
+
 #define __preinit_call(fn) __section(.preinit_array) void (*fn##_ptr)(void) = fn
 
 #define __init_call(fn) __section(.init_array) void (*fn##_ptr)(void) = fn
@@ -0,0 +1,53 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdint.h>
+#include <toolchain.h>
+
+/**
+ * @file txbuf.h
+ * @brief Build output directly in a device's transmit buffer.
+ *
+ * `txbuf_reserve()` allocates a DMA buffer for a device and hands out its
+ * address, so a task can write its output there in place.  `txbuf_commit()`
+ * then passes the buffer to the device as it is, without copying it to a
+ * kernel buffer first like `write()` does.  Every task can hold at most one
+ * reservation at a time; it is dropped if the task exits without committing.
+ */
+
+/**
+ * @brief Reserve a transmit buffer.
+ *
+ * @param fildes File descriptor of the device, must be open for writing
+ * @param len Size of the buffer in bytes
+ * @param data Where to store the address of the buffer
+ * @returns 0 on success, or a negative error code (`-EOPNOTSUPP` if the
+ *	device can't transmit from DMA buffers, `-E2BIG` if `len` exceeds what
+ *	the device can transmit at once, `-EBUSY` if the task already has a
+ *	reservation)
+ */
+__shared int txbuf_reserve(int fildes, size_t len, void **data);
+
+/**
+ * @brief Transmit the first `len` bytes of the reserved buffer and release it.
+ * This blocks until the device accepts the buffer, even if the file is in
+ * non-blocking mode.  If `len` is 0, the reservation is just dropped.
+ *
+ * @param len Amount of bytes to transmit, at most the reserved size
+ * @returns The amount of bytes written, or a negative error code
+ */
+__shared ssize_t txbuf_commit(size_t len);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -5,8 +5,68 @@
 #include <stdint.h>
 #include <toolchain.h>
 
+/** Set the file offset to `offset` bytes */
+#define SEEK_SET	0
+/** Set the file offset to its current value plus `offset` bytes */
+#define SEEK_CUR	1
+/** Set the file offset to the size of the file plus `offset` bytes */
+#define SEEK_END	2
+
 __shared ssize_t read(int fildes, void *buf, size_t nbyte);
 __shared ssize_t write(int fildes, const void *buf, size_t nbyte);
+__shared int close(int fildes);
+/**
+ * @brief Create a pipe.
+ * Data written to `fildes[1]` can be read from `fildes[0]`.  Reading from a
+ * pipe whose write end has been closed returns 0 (EOF), writing to a pipe
+ * whose read end has been closed fails with `-EPIPE`.
+ *
+ * @param fildes Where to store the file descriptors for the read and write end
+ * @returns 0 on success, or a negative error code
+ */
+__shared int pipe(int fildes[2]);
+/**
+ * @brief Create a broadcast stream with one writer and multiple readers.
+ * Every reader sees all data written to `fildes[0]`, which is stored only
+ * once.  Readers have their own position and the writer never blocks, so a
+ * reader that falls behind by more than the buffer size loses data.  Its
+ * next `read()` then fails with `-EOVERFLOW`, after which it can skip ahead
+ * with `lseek()`, e.g. to `SEEK_END` for the most recent data.  Reading
+ * returns 0 (EOF) once the writer has been closed and all data was read.
+ *
+ * @param fildes Where to store the file descriptors, the write end goes to
+ *	`fildes[0]` and the read ends to `fildes[1]` through `fildes[nreaders]`
+ * @param nreaders Amount of read ends to create
+ * @returns 0 on success, or a negative error code
+ */
+__shared int bcast(int fildes[], unsigned int nreaders);
+/**
+ * @brief Move data from one file to another without copying it to userspace.
+ * This reads up to `len` bytes from `fd_in` and writes them to `fd_out`.  If
+ * `fd_out` is the serial console, the data goes straight to the DMA engine.
+ * A short read from `fd_in` (e.g. an empty pipe) ends the transfer early.
+ * Data that was already read from `fd_in` when writing it to `fd_out` fails
+ * is lost, it is not included in the return value.
+ *
+ * @param fd_in File descriptor to read from
+ * @param fd_out File descriptor to write to
+ * @param len Maximum amount of bytes to move
+ * @returns The amount of bytes moved, 0 on EOF, or a negative error code
+ *	(`-EAGAIN` if either file has `O_NONBLOCK` set and would block)
+ */
+__shared ssize_t splice(int fd_in, int fd_out, size_t len);
+/**
+ * @brief Move the read/write offset of a regular file.
+ *
+ * @param fildes File descriptor
+ * @param offset New offset, relative to what `whence` specifies
+ * @param whence One of `SEEK_SET`, `SEEK_CUR` and `SEEK_END`
+ * @returns The new offset from the beginning of the file, or a negative
+ *	error code (`-ESPIPE` if the file is not seekable).  Positions in a
+ *	broadcast stream wrap around, so for its read ends, this is the new
+ *	position with the top bit cleared.
+ */
+__shared off_t lseek(int fildes, off_t offset, int whence);
 __shared ssize_t sleep(unsigned long int millis);
 /**
  * @brief Create a new thread.
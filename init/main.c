@@ -6,10 +6,13 @@
 #include <ardix/sched.h>
 
 #include <config.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <termios.h>
 #include <unistd.h>
 
 int child_test(void)
@@ -20,6 +23,133 @@ int child_test(void)
 	return 69;
 }
 
+#if CONFIG_SERIAL_LOOPBACK_PORT != 0
+
+/* amount of bytes sent at every baud rate */
+#define LOOPBACK_LEN 16384u
+/* give up if nothing moves for this long (in milliseconds) */
+#define LOOPBACK_TIMEOUT 1000u
+
+#define LOOPBACK_STR(x) #x
+#define LOOPBACK_PATH(port) "/dev/ttyS" LOOPBACK_STR(port)
+
+static const speed_t loopback_speeds[] = {
+	B115200, B460800, B921600, B2000000, B3000000, B4000000,
+};
+
+static uint8_t loopback_byte(unsigned int i)
+{
+	return (uint8_t)(i ^ (i >> 8));
+}
+
+/* returns the amount of bytes that came back intact */
+static unsigned int loopback_run(int fd)
+{
+	uint8_t buf[64];
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	unsigned int idle = 0;
+
+	while (received < LOOPBACK_LEN && idle < LOOPBACK_TIMEOUT) {
+		bool progress = false;
+
+		if (sent < LOOPBACK_LEN) {
+			unsigned int len = LOOPBACK_LEN - sent;
+			if (len > sizeof(buf))
+				len = sizeof(buf);
+			for (unsigned int i = 0; i < len; i++)
+				buf[i] = loopback_byte(sent + i);
+
+			ssize_t ret = write(fd, buf, len);
+			if (ret > 0) {
+				sent += (unsigned int)ret;
+				progress = true;
+			}
+		}
+
+		ssize_t ret = read(fd, buf, sizeof(buf));
+		if (ret > 0) {
+			for (unsigned int i = 0; i < (unsigned int)ret; i++) {
+				if (buf[i] != loopback_byte(received + i))
+					return received + i;
+			}
+			received += (unsigned int)ret;
+			progress = true;
+		}
+
+		if (progress) {
+			idle = 0;
+		} else {
+			sleep(1);
+			idle++;
+		}
+	}
+
+	return received;
+}
+
+/*
+ * Send a test pattern over a serial port whose TX is wired to its own RX (and
+ * RTS to CTS, if the port has them) at increasing baud rates, and report the
+ * line counters.  A rate passes if every byte came back in order and none of
+ * the counters show any lost bytes.
+ */
+static int loopback_test(void)
+{
+	const char *path = LOOPBACK_PATH(CONFIG_SERIAL_LOOPBACK_PORT);
+	struct termios t;
+	int failed = 0;
+
+	int fd = open(path, O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+		printf("[loopback] can't open %s: %d\n", path, fd);
+		return 1;
+	}
+
+	for (unsigned int i = 0; i < sizeof(loopback_speeds) / sizeof(loopback_speeds[0]); i++) {
+		struct tcstats before;
+		struct tcstats after;
+
+		tcgetattr(fd, &t);
+		t.c_iflag = 0;
+		t.c_lflag = 0;
+		t.c_cflag = CRTSCTS;
+		cfsetospeed(&t, loopback_speeds[i]);
+		cfsetispeed(&t, 0);
+		/* not all ports have RTS and CTS */
+		if (tcsetattr(fd, TCSAFLUSH, &t) == -EINVAL) {
+			t.c_cflag = 0;
+			if (tcsetattr(fd, TCSAFLUSH, &t) != 0) {
+				printf("[loopback] %lu baud: unsupported\n", loopback_speeds[i]);
+				continue;
+			}
+		}
+
+		tcgetstats(fd, &before);
+		unsigned int received = loopback_run(fd);
+		tcgetstats(fd, &after);
+
+		unsigned long int overruns = after.overruns - before.overruns;
+		unsigned long int frame_errors = after.frame_errors - before.frame_errors;
+		unsigned long int dropped = after.dropped - before.dropped;
+		bool ok = received == LOOPBACK_LEN && overruns == 0 && frame_errors == 0
+			  && dropped == 0;
+		if (!ok)
+			failed++;
+
+		printf("[loopback] %lu baud%s: %u/%u bytes, %lu overruns, %lu frame errors, "
+		       "%lu dropped: %s\n",
+		       loopback_speeds[i], t.c_cflag & CRTSCTS ? " (RTS/CTS)" : "",
+		       received, LOOPBACK_LEN, overruns, frame_errors, dropped,
+		       ok ? "ok" : "FAILED");
+	}
+
+	close(fd);
+	return failed;
+}
+
+#endif /* CONFIG_SERIAL_LOOPBACK_PORT != 0 */
+
 /**
  * @brief init daemon entry point.
  */
@@ -35,6 +165,12 @@ int init_main(void)
 	printf("[parent] waitpid() returned, child exit code = %d\n", status);
 	printf("[parent] my child has died, goodbye cruel world qwq\n");
 
+#if CONFIG_SERIAL_LOOPBACK_PORT != 0
+	pid = exec(loopback_test);
+	waitpid(pid, &status, 0);
+	printf("[parent] serial loopback test done, %d rates failed\n", status);
+#endif
+
 	return 0;
 }
 
@@ -0,0 +1,387 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/atomic.h>
+#include <ardix/block.h>
+#include <ardix/device.h>
+#include <ardix/list.h>
+#include <ardix/malloc.h>
+#include <ardix/mutex.h>
+
+#include <config.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct block_buf {
+	struct list_head lru;
+	/* owner of the cached sector (holds a reference), or NULL if unused */
+	struct block_device *bdev;
+	uint32_t sector;
+	bool dirty;
+	uint8_t *data;
+};
+
+/* what the caller of block_get() is going to do with the sector */
+enum block_access {
+	BLOCK_READ,
+	/* modify part of the sector */
+	BLOCK_WRITE,
+	/* replace the entire sector, so it doesn't need to be read on a miss */
+	BLOCK_OVERWRITE,
+};
+
+static struct block_buf *block_cache = NULL;
+/* most recently used buffers first */
+static LIST_HEAD(block_lru);
+/* protects the entire cache, and is held during backend I/O */
+static MUTEX(block_lock);
+
+static int block_cache_init(void)
+{
+	if (block_cache != NULL)
+		return 0;
+
+	struct block_buf *cache = kmalloc(CONFIG_BLOCK_CACHE_SIZE * sizeof(*cache));
+	if (cache == NULL)
+		return -ENOMEM;
+
+	uint8_t *data = kmalloc(CONFIG_BLOCK_CACHE_SIZE * CONFIG_BLOCK_SECTOR_SIZE);
+	if (data == NULL) {
+		kfree(cache);
+		return -ENOMEM;
+	}
+
+	for (unsigned int i = 0; i < CONFIG_BLOCK_CACHE_SIZE; i++) {
+		cache[i].bdev = NULL;
+		cache[i].dirty = false;
+		cache[i].data = &data[i * CONFIG_BLOCK_SECTOR_SIZE];
+		list_insert_before(&block_lru, &cache[i].lru);
+	}
+
+	block_cache = cache;
+	return 0;
+}
+
+static struct block_buf *block_cache_find(struct block_device *bdev, uint32_t sector)
+{
+	for (unsigned int i = 0; i < CONFIG_BLOCK_CACHE_SIZE; i++) {
+		struct block_buf *buf = &block_cache[i];
+		if (buf->bdev == bdev && buf->sector == sector)
+			return buf;
+	}
+
+	return NULL;
+}
+
+static void block_cache_touch(struct block_buf *buf)
+{
+	list_delete(&buf->lru);
+	list_insert(&block_lru, &buf->lru);
+}
+
+static void block_buf_assign(struct block_buf *buf, struct block_device *bdev, uint32_t sector)
+{
+	device_get(&bdev->device);
+	buf->bdev = bdev;
+	buf->sector = sector;
+	buf->dirty = false;
+}
+
+static void block_buf_release(struct block_buf *buf)
+{
+	struct block_device *bdev = buf->bdev;
+
+	buf->bdev = NULL;
+	buf->dirty = false;
+	/* unused buffers are the first ones to get recycled */
+	list_delete(&buf->lru);
+	list_insert_before(&block_lru, &buf->lru);
+
+	if (bdev != NULL)
+		device_put(&bdev->device);
+}
+
+/* write back the entire run of adjacent dirty sectors that `buf` is part of */
+static int block_writeback(struct block_buf *buf)
+{
+	struct block_device *bdev = buf->bdev;
+	struct block_buf *run[CONFIG_BLOCK_CACHE_SIZE];
+	const void *bufs[CONFIG_BLOCK_CACHE_SIZE];
+	unsigned int count = 0;
+	uint32_t first = buf->sector;
+
+	while (first > 0) {
+		struct block_buf *prev = block_cache_find(bdev, first - 1);
+		if (prev == NULL || !prev->dirty)
+			break;
+		first--;
+	}
+
+	for (uint32_t sector = first; sector < bdev->sector_count; sector++) {
+		struct block_buf *cur = block_cache_find(bdev, sector);
+		if (cur == NULL || !cur->dirty)
+			break;
+		run[count] = cur;
+		bufs[count] = cur->data;
+		count++;
+	}
+
+	int err = bdev->write(bdev, first, bufs, count);
+	if (err == 0) {
+		for (unsigned int i = 0; i < count; i++)
+			run[i]->dirty = false;
+	}
+
+	return err;
+}
+
+/* get the least recently used buffer, writing it back if necessary */
+static struct block_buf *block_cache_evict(int *err)
+{
+	struct block_buf *buf = list_last_entry(&block_lru, struct block_buf, lru);
+
+	if (buf->dirty) {
+		*err = block_writeback(buf);
+		if (*err != 0)
+			return NULL;
+	}
+
+	block_buf_release(buf);
+	/* move it out of the way so the next call gets a different one */
+	block_cache_touch(buf);
+	return buf;
+}
+
+/*
+ * Get the cache buffer for a sector.  Only reads that continue where the
+ * previous one ended fetch the following sectors as well, partial writes
+ * just read the one sector they modify.
+ */
+static struct block_buf *block_get(struct block_device *bdev, uint32_t sector,
+				   enum block_access access, int *err)
+{
+	struct block_buf *buf = block_cache_find(bdev, sector);
+	if (buf != NULL) {
+		block_cache_touch(buf);
+		return buf;
+	}
+
+	if (access == BLOCK_OVERWRITE) {
+		buf = block_cache_evict(err);
+		if (buf != NULL)
+			block_buf_assign(buf, bdev, sector);
+		return buf;
+	}
+
+	unsigned int count = 1;
+	if (access == BLOCK_READ && sector == bdev->next_sector)
+		count += CONFIG_BLOCK_READAHEAD;
+	if (count > bdev->sector_count - sector)
+		count = bdev->sector_count - sector;
+	if (count > CONFIG_BLOCK_CACHE_SIZE)
+		count = CONFIG_BLOCK_CACHE_SIZE;
+
+	struct block_buf *run[CONFIG_BLOCK_CACHE_SIZE];
+	void *bufs[CONFIG_BLOCK_CACHE_SIZE];
+	for (unsigned int i = 0; i < count; i++) {
+		/* read-ahead stops at the first sector we already have */
+		if (i != 0 && block_cache_find(bdev, sector + i) != NULL) {
+			count = i;
+			break;
+		}
+
+		run[i] = block_cache_evict(err);
+		if (run[i] == NULL) {
+			if (i == 0)
+				return NULL;
+			count = i;
+			break;
+		}
+		bufs[i] = run[i]->data;
+	}
+
+	*err = bdev->read(bdev, sector, bufs, count);
+	if (*err != 0) {
+		/* the buffers are still unused, just put them back at the end */
+		for (unsigned int i = 0; i < count; i++)
+			block_buf_release(run[i]);
+		return NULL;
+	}
+
+	/* read-ahead sectors should be evicted before the one actually requested */
+	for (unsigned int i = count; i > 0; i--) {
+		block_buf_assign(run[i - 1], bdev, sector + i - 1);
+		block_cache_touch(run[i - 1]);
+	}
+
+	return run[0];
+}
+
+static ssize_t block_device_read(void *dest, struct device *dev, size_t len, off_t offset)
+{
+	struct block_device *bdev = device_to_block_device(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret = 0;
+
+	if (offset < 0)
+		return -EINVAL;
+	/* backend I/O may sleep */
+	if (is_atomic())
+		return -EOPNOTSUPP;
+
+	mutex_lock(&block_lock);
+
+	while ((size_t)ret < len) {
+		uint32_t sector = pos / bdev->sector_size;
+		size_t sector_pos = pos % bdev->sector_size;
+		if (sector >= bdev->sector_count)
+			break; /* EOF */
+
+		size_t chunk = bdev->sector_size - sector_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		int err;
+		struct block_buf *buf = block_get(bdev, sector, BLOCK_READ, &err);
+		if (buf == NULL) {
+			if (ret == 0)
+				ret = err;
+			break;
+		}
+
+		memcpy(dest + ret, buf->data + sector_pos, chunk);
+		bdev->next_sector = sector + 1;
+		ret += (ssize_t)chunk;
+		pos += chunk;
+	}
+
+	mutex_unlock(&block_lock);
+	return ret;
+}
+
+static ssize_t block_device_write(struct device *dev, const void *src, size_t len, off_t offset)
+{
+	struct block_device *bdev = device_to_block_device(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret = 0;
+
+	if (offset < 0)
+		return -EINVAL;
+	if (is_atomic())
+		return -EOPNOTSUPP;
+
+	mutex_lock(&block_lock);
+
+	while ((size_t)ret < len) {
+		uint32_t sector = pos / bdev->sector_size;
+		size_t sector_pos = pos % bdev->sector_size;
+		if (sector >= bdev->sector_count) {
+			if (ret == 0)
+				ret = -ENOSPC;
+			break;
+		}
+
+		size_t chunk = bdev->sector_size - sector_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		int err;
+		enum block_access access = BLOCK_WRITE;
+		if (chunk == bdev->sector_size)
+			access = BLOCK_OVERWRITE;
+		struct block_buf *buf = block_get(bdev, sector, access, &err);
+		if (buf == NULL) {
+			if (ret == 0)
+				ret = err;
+			break;
+		}
+
+		memcpy(buf->data + sector_pos, src + ret, chunk);
+		buf->dirty = true;
+		ret += (ssize_t)chunk;
+		pos += chunk;
+	}
+
+	mutex_unlock(&block_lock);
+	return ret;
+}
+
+static ssize_t block_device_size(struct device *dev)
+{
+	struct block_device *bdev = device_to_block_device(dev);
+
+	/* off_t is the signed counterpart of size_t */
+	if (bdev->sector_count > (SIZE_MAX >> 1) / bdev->sector_size)
+		return (ssize_t)(SIZE_MAX >> 1);
+
+	return (ssize_t)(bdev->sector_count * bdev->sector_size);
+}
+
+static void block_device_close(struct device *dev, struct file *file)
+{
+	/* if we can't sleep, the sectors are written back when they get evicted */
+	if (!is_atomic())
+		block_sync(device_to_block_device(dev));
+}
+
+int block_device_init(struct block_device *bdev)
+{
+	if (bdev->sector_size == 0 || bdev->sector_size > CONFIG_BLOCK_SECTOR_SIZE
+	    || (bdev->sector_size & (bdev->sector_size - 1)) != 0)
+		return -EINVAL;
+
+	mutex_lock(&block_lock);
+	int err = block_cache_init();
+	mutex_unlock(&block_lock);
+	if (err != 0)
+		return err;
+
+	bdev->next_sector = 0;
+
+	err = device_init(&bdev->device);
+	if (err != 0)
+		return err;
+
+	bdev->device.read = block_device_read;
+	bdev->device.write = block_device_write;
+	bdev->device.size = block_device_size;
+	bdev->device.close = block_device_close;
+	return 0;
+}
+
+int block_sync(struct block_device *bdev)
+{
+	int ret = 0;
+
+	mutex_lock(&block_lock);
+
+	if (block_cache != NULL) {
+		for (unsigned int i = 0; i < CONFIG_BLOCK_CACHE_SIZE; i++) {
+			struct block_buf *buf = &block_cache[i];
+			if (buf->bdev != bdev || !buf->dirty)
+				continue;
+
+			int err = block_writeback(buf);
+			if (err != 0 && ret == 0)
+				ret = err;
+		}
+	}
+
+	mutex_unlock(&block_lock);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
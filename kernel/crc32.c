@@ -0,0 +1,45 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/crc32.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Half-byte lookup table for the reflected polynomial 0xedb88320.
+ * This is a compromise between a full 1 KiB table and the bitwise algorithm,
+ * we only checksum a couple hundred bytes at a time anyway.
+ */
+static const uint32_t crc32_table[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+uint32_t crc32(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t *pos = buf;
+
+	crc = ~crc;
+	while (len-- != 0) {
+		crc ^= *pos++;
+		crc = (crc >> 4) ^ crc32_table[crc & 0xf];
+		crc = (crc >> 4) ^ crc32_table[crc & 0xf];
+	}
+
+	return ~crc;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -47,6 +47,20 @@ int device_init(struct device *dev)
 		dev->kent.parent = devices_kent;
 
 	mutex_init(&dev->lock);
+	dev->flags = 0;
+	dev->dmapool = NULL;
+	dev->read = NULL;
+	dev->write = NULL;
+	dev->writev = NULL;
+	dev->poll = NULL;
+	dev->size = NULL;
+	dev->close = NULL;
+	dev->write_dma = NULL;
+	dev->map_rx = NULL;
+	dev->tcattr = NULL;
+	dev->tcflush = NULL;
+	dev->tcstats = NULL;
+
 	return kent_init(&dev->kent);
 }
 
@@ -79,6 +93,9 @@ struct device_kevent *device_kevent_create(struct device *device, enum device_ke
 
 void device_kevent_create_and_dispatch(struct device *device, enum device_kevent_flags flags)
 {
+	if (!kevent_has_listeners(KEVENT_DEVICE))
+		return;
+
 	struct device_kevent *event = device_kevent_create(device, flags);
 	if (event != NULL)
 		kevent_dispatch(&event->kevent);
@@ -1,37 +1,92 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
+#include <ardix/atom.h>
+#include <ardix/atomic.h>
 #include <ardix/device.h>
 #include <ardix/dma.h>
 #include <ardix/kent.h>
+#include <ardix/kevent.h>
 #include <ardix/malloc.h>
+#include <ardix/sched.h>
+#include <ardix/task.h>
 #include <ardix/types.h>
 #include <ardix/util.h>
 
+#include <arch-generic/dma.h>
+
+#include <config.h>
+
+#include <errno.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static struct dmabuf *dmapool_get(struct dmapool *pool)
+{
+	int i = atom_claim_bit(&pool->free);
+	if (i < 0)
+		return NULL;
+
+	return (struct dmabuf *)&pool->mem[(size_t)i * pool->stride];
+}
+
+static void dmapool_put(struct dmapool *pool, struct dmabuf *buf)
+{
+	size_t i = ((uint8_t *)buf - pool->mem) / pool->stride;
+	atom_set_bit(&pool->free, (int)i);
+}
+
+static void dmabuf_free(struct dmabuf *buf)
+{
+	if (buf->pool != NULL)
+		dmapool_put(buf->pool, buf);
+	else
+		kfree(buf);
+}
 
 static void dmabuf_destroy(struct kent *kent)
 {
 	struct dmabuf *buf = kent_to_dmabuf(kent);
-	kfree(buf);
+	dmabuf_free(buf);
 }
 
 struct dmabuf *dmabuf_create(struct device *dev, size_t len)
 {
 	int err = 0;
-	/*
-	 * allocation needs to be atomic because the buffer might be
-	 * free()d from within an irq handler which cannot sleep
-	 */
-	struct dmabuf *buf = atomic_kmalloc(sizeof(*buf) + len);
-	if (buf == NULL)
-		return NULL;
+	struct dmabuf *buf = NULL;
+	struct dmapool *pool = dev->dmapool;
+
+	if (pool != NULL) {
+		if (len > pool->bufsz) {
+			pool->stats.oversize++;
+		} else {
+			buf = dmapool_get(pool);
+			if (buf != NULL)
+				pool->stats.allocated++;
+			else
+				pool->stats.exhausted++;
+		}
+	}
+
+	if (buf == NULL) {
+		/*
+		 * allocation needs to be atomic because the buffer might be
+		 * free()d from within an irq handler which cannot sleep
+		 */
+		if (len > SIZE_MAX - sizeof(*buf))
+			return NULL;
+		buf = atomic_kmalloc(sizeof(*buf) + len);
+		if (buf == NULL)
+			return NULL;
+		buf->pool = NULL;
+	}
 
 	buf->kent.parent = &dev->kent;
 	buf->kent.destroy = dmabuf_destroy;
 
 	err = kent_init(&buf->kent);
 	if (err) {
-		kfree(buf);
+		dmabuf_free(buf);
 		return NULL;
 	}
 
@@ -50,6 +105,224 @@ void dmabuf_put(struct dmabuf *buf)
 	kent_put(&buf->kent);
 }
 
+int dmapool_create(struct device *dev, unsigned int count, size_t bufsz)
+{
+	if (count == 0 || count > sizeof(dev->dmapool->free) * 8)
+		return -EINVAL;
+	if (dev->dmapool != NULL)
+		return -EEXIST;
+
+	struct dmapool *pool = kmalloc(sizeof(*pool));
+	if (pool == NULL)
+		return -ENOMEM;
+
+	/* keep every buffer header word aligned */
+	pool->stride = (sizeof(struct dmabuf) + bufsz + sizeof(uintptr_t) - 1)
+		     & ~(sizeof(uintptr_t) - 1);
+	pool->mem = kmalloc(pool->stride * count);
+	if (pool->mem == NULL) {
+		kfree(pool);
+		return -ENOMEM;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct dmabuf *buf = (struct dmabuf *)&pool->mem[i * pool->stride];
+		buf->pool = pool;
+	}
+
+	pool->count = count;
+	pool->bufsz = bufsz;
+	pool->free = count == sizeof(pool->free) * 8 ? ~0u : (1u << count) - 1;
+	memset(&pool->stats, 0, sizeof(pool->stats));
+
+	dev->dmapool = pool;
+	return 0;
+}
+
+void dmapool_destroy(struct device *dev)
+{
+	struct dmapool *pool = dev->dmapool;
+
+	if (pool != NULL) {
+		dev->dmapool = NULL;
+		kfree(pool->mem);
+		kfree(pool);
+	}
+}
+
+int dmapool_stats(struct device *dev, struct dmapool_stats *stats)
+{
+	if (dev->dmapool == NULL)
+		return -ENODEV;
+
+	*stats = dev->dmapool->stats;
+	return 0;
+}
+
+static struct dma_chan dma_chans[DMA_NCHAN];
+/* bit i is set if dma_chans[i] is free, all clear until dma_init() */
+static unsigned int dma_chans_free = 0;
+static struct kent dma_kent;
+
+static void dma_kent_destroy(struct kent *kent)
+{
+	/* should never be executed because the DMA kent is immortal */
+}
+
+int dma_init(void)
+{
+	int err;
+
+	dma_kent.parent = kent_root;
+	dma_kent.destroy = dma_kent_destroy;
+	err = kent_init(&dma_kent);
+	if (err != 0)
+		return err;
+
+	err = arch_dma_init();
+	if (err != 0)
+		return err;
+
+	for (unsigned int i = 0; i < DMA_NCHAN; i++) {
+		dma_chans[i].id = i;
+		dma_chans[i].busy = false;
+		dma_chans[i].status = 0;
+		dma_chans[i].waiter = NULL;
+	}
+	dma_chans_free = (1u << DMA_NCHAN) - 1;
+
+	return 0;
+}
+
+struct dma_chan *dma_chan_request(void)
+{
+	int i = atom_claim_bit(&dma_chans_free);
+	if (i < 0)
+		return NULL;
+
+	return &dma_chans[i];
+}
+
+void dma_chan_release(struct dma_chan *chan)
+{
+	atom_set_bit(&dma_chans_free, (int)chan->id);
+}
+
+size_t dma_desc_init(struct dma_desc *desc, void *dest, const void *src, size_t len)
+{
+	return arch_dma_desc_init(desc, dest, src, len);
+}
+
+void dma_desc_chain(struct dma_desc *desc, struct dma_desc *next)
+{
+	arch_dma_desc_chain(desc, next);
+}
+
+int dma_submit(struct dma_chan *chan, struct dma_desc *desc)
+{
+	if (chan->busy)
+		return -EBUSY;
+
+	chan->busy = true;
+	chan->status = 0;
+
+	int err = arch_dma_start(chan, desc);
+	if (err != 0)
+		chan->busy = false;
+
+	return err;
+}
+
+static void dma_kevent_destroy(struct kent *kent)
+{
+	struct kevent *event = container_of(kent, struct kevent, kent);
+	kfree(kevent_to_dma_kevent(event));
+}
+
+void dma_chan_complete(struct dma_chan *chan, int status)
+{
+	chan->status = status;
+	chan->busy = false;
+	if (chan->waiter != NULL)
+		chan->waiter->state = TASK_QUEUE;
+
+	if (!kevent_has_listeners(KEVENT_DMA))
+		return;
+
+	struct dma_kevent *event = atomic_kmalloc(sizeof(*event));
+	if (event == NULL)
+		return;
+
+	event->kevent.kind = KEVENT_DMA;
+	event->kevent.kent.parent = &dma_kent;
+	event->kevent.kent.destroy = dma_kevent_destroy;
+	if (kent_init(&event->kevent.kent) != 0) {
+		kfree(event);
+		return;
+	}
+
+	event->chan = chan;
+	event->status = status;
+	kevent_dispatch(&event->kevent);
+}
+
+/* number of descriptors per transfer, dma_memcpy() loops for the rest */
+#define DMA_MEMCPY_NDESC 4
+
+void *dma_memcpy(void *dest, const void *src, size_t len)
+{
+	uint8_t *d = dest;
+	const uint8_t *s = src;
+
+	if (len < CONFIG_DMA_MEMCPY_MIN || is_atomic())
+		return memcpy(dest, src, len);
+
+	struct dma_chan *chan = dma_chan_request();
+	if (chan == NULL)
+		return memcpy(dest, src, len);
+
+	while (len != 0) {
+		struct dma_desc desc[DMA_MEMCPY_NDESC];
+		unsigned int ndesc = 0;
+		size_t done = 0;
+
+		while (ndesc < DMA_MEMCPY_NDESC && done < len) {
+			done += dma_desc_init(&desc[ndesc], d + done, s + done, len - done);
+			if (ndesc != 0)
+				dma_desc_chain(&desc[ndesc - 1], &desc[ndesc]);
+			ndesc++;
+		}
+
+		chan->waiter = current;
+		if (dma_submit(chan, &desc[0]) != 0) {
+			chan->waiter = NULL;
+			memcpy(d, s, len);
+			break;
+		}
+
+		/*
+		 * The descriptors are on our stack, so we can't leave before the
+		 * irq.  Syscalls run with irqs disabled, so the irq can't sneak
+		 * in between checking busy and going to sleep.
+		 */
+		while (chan->busy)
+			yield(TASK_IOWAIT);
+		chan->waiter = NULL;
+
+		if (chan->status != 0) {
+			memcpy(d, s, len);
+			break;
+		}
+
+		d += done;
+		s += done;
+		len -= done;
+	}
+
+	dma_chan_release(chan);
+	return dest;
+}
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
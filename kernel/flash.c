@@ -0,0 +1,85 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/flash.h>
+#include <ardix/mutex.h>
+
+#include <arch-generic/flash.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct flash *flash_storage = NULL;
+
+int flash_init(void)
+{
+	if (flash_storage != NULL)
+		return -EEXIST;
+
+	struct flash *flash = arch_flash_init();
+	if (flash == NULL)
+		return -ENODEV;
+
+	flash_storage = flash;
+	return 0;
+}
+
+int flash_read(struct flash *flash, void *dest, unsigned int page, size_t offset, size_t len)
+{
+	int err;
+
+	if (page >= flash->page_count || offset > flash->page_size
+	    || len > flash->page_size - offset)
+		return -EINVAL;
+
+	mutex_lock(&flash->device.lock);
+	err = flash->read(flash, dest, page, offset, len);
+	mutex_unlock(&flash->device.lock);
+
+	return err;
+}
+
+int flash_program(struct flash *flash, unsigned int page, const void *src)
+{
+	int err;
+
+	if (page >= flash->page_count)
+		return -EINVAL;
+
+	mutex_lock(&flash->device.lock);
+	err = flash->program(flash, page, src);
+	mutex_unlock(&flash->device.lock);
+
+	return err;
+}
+
+int flash_write(struct flash *flash, unsigned int page, size_t offset, const void *src,
+		size_t len)
+{
+	int err;
+
+	if (page >= flash->page_count || offset > flash->page_size
+	    || len > flash->page_size - offset)
+		return -EINVAL;
+	if (offset % sizeof(uint32_t) != 0 || len % sizeof(uint32_t) != 0)
+		return -EINVAL;
+
+	mutex_lock(&flash->device.lock);
+	err = flash->write(flash, page, offset, src, len);
+	mutex_unlock(&flash->device.lock);
+
+	return err;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
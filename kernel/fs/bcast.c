@@ -0,0 +1,285 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file bcast.c
+ * @brief Broadcast streams with one writer and multiple readers.
+ *
+ * A broadcast stream is a device backed by a single ring buffer.  Every read
+ * end is its own file of type `FILE_TYPE_BROADCAST`, whose `pos` is the
+ * reader's position in the stream.  Positions are free-running byte counts
+ * that wrap around and are only ever masked with the buffer size or compared
+ * as differences, so the device itself doesn't need to know anything about
+ * its readers, and streams can run indefinitely.  The writer never waits
+ * for anyone and just overwrites the oldest data, and a reader whose
+ * position has fallen out of the buffer gets `-EOVERFLOW`.
+ */
+
+#include <ardix/bcast.h>
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/malloc.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
+#include <ardix/util.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <toolchain.h>
+#include <unistd.h>
+
+#if (CONFIG_BCAST_BUFSZ & (CONFIG_BCAST_BUFSZ - 1)) != 0
+#error "CONFIG_BCAST_BUFSZ must be a power of two"
+#endif
+
+struct bcast {
+	struct device device;
+	/* total amount of bytes ever written, wrapping around */
+	size_t head;
+	/* amount of open write ends */
+	unsigned int writers;
+	uint8_t data[CONFIG_BCAST_BUFSZ];
+};
+
+#define device_to_bcast(ptr) container_of(ptr, struct bcast, device)
+
+/*
+ * Amount of bytes between a reader's position and the head.  This is larger
+ * than the buffer if the reader was overrun, and larger than half the address
+ * space if it has seeked beyond the head (which means it has to wait).
+ */
+static inline size_t bcast_behind(struct bcast *bc, off_t offset)
+{
+	return bc->head - (size_t)offset;
+}
+
+static inline bool bcast_is_ahead(size_t behind)
+{
+	return behind > (SIZE_MAX >> 1);
+}
+
+static ssize_t bcast_read(void *dest, struct device *dev, size_t len, off_t offset)
+{
+	struct bcast *bc = device_to_bcast(dev);
+	ssize_t ret;
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret != 0)
+		return -EBUSY;
+
+	size_t avail = bcast_behind(bc, offset);
+	if (avail == 0 || bcast_is_ahead(avail)) {
+		/* 0 means EOF because nobody is ever going to write again */
+		ret = bc->writers == 0 ? 0 : -EBUSY;
+	} else if (avail > CONFIG_BCAST_BUFSZ) {
+		ret = -EOVERFLOW;
+	} else {
+		if (len > avail)
+			len = avail;
+
+		size_t pos = (size_t)offset & (CONFIG_BCAST_BUFSZ - 1);
+		size_t first = CONFIG_BCAST_BUFSZ - pos;
+		if (first > len)
+			first = len;
+
+		memcpy(dest, &bc->data[pos], first);
+		memcpy(dest + first, &bc->data[0], len - first);
+		ret = (ssize_t)len;
+	}
+
+	mutex_unlock(&dev->lock);
+	return ret;
+}
+
+static ssize_t bcast_write(struct device *dev, const void *src, size_t len, off_t offset)
+{
+	struct bcast *bc = device_to_bcast(dev);
+	ssize_t ret;
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret != 0)
+		return -EBUSY;
+
+	/* anything beyond that would be overwritten right away */
+	if (len > CONFIG_BCAST_BUFSZ)
+		len = CONFIG_BCAST_BUFSZ;
+
+	size_t pos = bc->head & (CONFIG_BCAST_BUFSZ - 1);
+	size_t first = CONFIG_BCAST_BUFSZ - pos;
+	if (first > len)
+		first = len;
+
+	memcpy(&bc->data[pos], src, first);
+	memcpy(&bc->data[0], src + first, len - first);
+	bc->head += len;
+	ret = (ssize_t)len;
+
+	mutex_unlock(&dev->lock);
+
+	if (ret > 0)
+		device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_RX);
+
+	return ret;
+}
+
+static int bcast_poll(struct device *dev, off_t offset)
+{
+	struct bcast *bc = device_to_bcast(dev);
+	size_t behind = bcast_behind(bc, offset);
+	/* the writer never blocks */
+	int ret = POLLOUT;
+
+	if (behind != 0 && !bcast_is_ahead(behind)) {
+		ret |= POLLIN;
+		if (behind > CONFIG_BCAST_BUFSZ)
+			ret |= POLLERR;
+	}
+	if (bc->writers == 0)
+		ret |= POLLHUP;
+
+	return ret;
+}
+
+static void bcast_close(struct device *dev, struct file *file)
+{
+	struct bcast *bc = device_to_bcast(dev);
+
+	if ((file->flags & O_ACCMODE) == O_WRONLY) {
+		bc->writers--;
+		/* wake up all readers waiting for data so they see EOF */
+		device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_RX | DEVICE_KEVENT_ERR);
+	}
+}
+
+static void bcast_destroy(struct kent *kent)
+{
+	struct bcast *bc = device_to_bcast(kent_to_device(kent));
+	kfree(bc);
+}
+
+static struct bcast *bcast_create(int *err)
+{
+	struct bcast *bc = kmalloc(sizeof(*bc));
+	if (bc == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	bc->head = 0;
+	bc->writers = 0;
+
+	bc->device.kent.parent = NULL;
+	bc->device.kent.destroy = bcast_destroy;
+
+	*err = device_init(&bc->device);
+	if (*err != 0) {
+		kfree(bc);
+		return NULL;
+	}
+
+	bc->device.read = bcast_read;
+	bc->device.write = bcast_write;
+	bc->device.poll = bcast_poll;
+	bc->device.close = bcast_close;
+	/* no size callback, the head is not a size (see bcast_lseek() for SEEK_END) */
+
+	return bc;
+}
+
+long bcast_lseek(struct file *file, off_t offset, int whence)
+{
+	struct bcast *bc = device_to_bcast(file->device);
+	size_t base;
+
+	switch (whence) {
+	case SEEK_SET:
+		base = 0;
+		break;
+	case SEEK_CUR:
+		base = (size_t)file->pos;
+		break;
+	case SEEK_END:
+		base = bc->head;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* no range checks, overflowing is just the cursor wrapping around */
+	size_t pos = base + (size_t)offset;
+	file->pos = (off_t)pos;
+
+	/* the cursor would look like an error code once its top bit is set */
+	return (long)(pos & (SIZE_MAX >> 1));
+}
+
+long sys_bcast(__user int fildes[], unsigned int nreaders)
+{
+	int err = 0;
+	int fds[CONFIG_NFILE];
+	unsigned int nfds = nreaders + 1;
+	unsigned int i;
+
+	if (nreaders == 0 || nreaders >= CONFIG_NFILE)
+		return -EINVAL;
+	if (!access_ok(fildes, nfds * sizeof(*fildes), true))
+		return -EFAULT;
+
+	struct bcast *bc = bcast_create(&err);
+	if (bc == NULL)
+		return err;
+
+	for (i = 0; i < nfds; i++) {
+		struct file *f;
+
+		if (i == 0) {
+			/* the write end doesn't have a position */
+			f = file_create(&bc->device, FILE_TYPE_PIPE, &err);
+			if (f == NULL)
+				break;
+			f->flags = O_WRONLY;
+			bc->writers++;
+		} else {
+			f = file_create(&bc->device, FILE_TYPE_BROADCAST, &err);
+			if (f == NULL)
+				break;
+			f->flags = O_RDONLY;
+		}
+
+		fds[i] = fd_install(f);
+		/* the fd table holds the reference from now on */
+		file_put(f);
+		if (fds[i] < 0) {
+			err = fds[i];
+			break;
+		}
+	}
+
+	if (i == nfds) {
+		copy_to_user(fildes, fds, nfds * sizeof(*fds));
+	} else {
+		while (i-- != 0)
+			fd_close(fds[i]);
+	}
+
+	device_put(&bc->device);
+	return err;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,49 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/file.h>
+#include <ardix/syscall.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+
+/* status flags that can be changed with F_SETFL */
+#define FCNTL_SETFL_MASK (O_NONBLOCK | O_APPEND)
+
+long sys_fcntl(int fd, int cmd, int arg)
+{
+	long ret;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	switch (cmd) {
+	case F_GETFL:
+		ret = f->flags;
+		break;
+	case F_SETFL:
+		f->flags = (f->flags & ~FCNTL_SETFL_MASK) | (arg & FCNTL_SETFL_MASK);
+		ret = 0;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	file_put(f);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -1,79 +1,59 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
 #include <ardix/device.h>
+#include <ardix/dma.h>
 #include <ardix/file.h>
 #include <ardix/malloc.h>
 #include <ardix/sched.h>
+#include <ardix/util.h>
 
 #include <config.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stddef.h>
 
-static struct file *fdtab[CONFIG_NFILE];
-static MUTEX(fdtab_lock);
-
 static void file_destroy(struct kent *kent)
 {
 	struct file *file = container_of(kent, struct file, kent);
 
-	mutex_lock(&fdtab_lock);
-	fdtab[file->fd] = NULL;
-	mutex_unlock(&fdtab_lock);
+	if (file->device->close != NULL)
+		file->device->close(file->device, file);
 
 	kfree(file);
 }
 
 struct file *file_create(struct device *device, enum file_type type, int *err)
 {
-	struct file *f;
-	struct file **slot;
-	int fd;
-
-	mutex_lock(&fdtab_lock);
-	for (fd = 0; fd < CONFIG_NFILE; fd++) {
-		slot = &fdtab[fd];
-		if (*slot == NULL)
-			break;
-	}
-	if (*slot != NULL) {
-		*err = -EMFILE;
-		mutex_unlock(&fdtab_lock);
-		return NULL;
-	}
-
-	f = kmalloc(sizeof(*f));
+	struct file *f = kmalloc(sizeof(*f));
 	if (f == NULL) {
 		*err = -ENOMEM;
-		mutex_unlock(&fdtab_lock);
 		return NULL;
 	}
-	*slot = f;
-	mutex_unlock(&fdtab_lock);
 
 	f->kent.parent = &device->kent;
 	f->kent.destroy = file_destroy;
 	kent_init(&f->kent);
 
-	f->fd = fd;
 	f->device = device;
 	f->pos = 0;
 	f->type = type;
+	f->flags = 0;
 	mutex_init(&f->lock);
 
+	*err = 0;
 	return f;
 }
 
 struct file *file_get(int fd)
 {
-	struct file *f = NULL;
+	struct file *f;
 
-	if (fd < CONFIG_NFILE) {
-		mutex_lock(&fdtab_lock);
-		f = fdtab[fd];
-		if (f != NULL)
-			kent_get(&f->kent);
-		mutex_unlock(&fdtab_lock);
-	}
+	if ((unsigned int)fd >= CONFIG_NFILE)
+		return NULL;
+
+	f = current->fdtab.files[fd];
+	if (f == NULL || !kent_tryget(&f->kent))
+		return NULL;
 
 	return f;
 }
@@ -83,6 +63,73 @@ void file_put(struct file *f)
 	kent_put(&f->kent);
 }
 
+int fd_install(struct file *file)
+{
+	struct fdtab *tab = &current->fdtab;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(tab->bitmap); i++) {
+		unsigned long int free = ~tab->bitmap[i];
+		if (free == 0)
+			continue;
+
+		unsigned int fd = i * FDTAB_BITS_PER_WORD + (unsigned int)__builtin_ctzl(free);
+		if (fd >= CONFIG_NFILE)
+			break;
+
+		tab->bitmap[i] |= 1ul << (fd % FDTAB_BITS_PER_WORD);
+		kent_get(&file->kent);
+		tab->files[fd] = file;
+		return (int)fd;
+	}
+
+	return -EMFILE;
+}
+
+int fd_close(int fd)
+{
+	struct fdtab *tab = &current->fdtab;
+	struct file *file;
+
+	if ((unsigned int)fd >= CONFIG_NFILE)
+		return -EBADF;
+
+	file = tab->files[fd];
+	if (file == NULL)
+		return -EBADF;
+
+	tab->files[fd] = NULL;
+	tab->bitmap[fd / FDTAB_BITS_PER_WORD] &= ~(1ul << (fd % FDTAB_BITS_PER_WORD));
+	file_put(file);
+
+	return 0;
+}
+
+void fdtab_clone(struct fdtab *dest, const struct fdtab *src)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(dest->bitmap); i++)
+		dest->bitmap[i] = src->bitmap[i];
+
+	for (unsigned int fd = 0; fd < CONFIG_NFILE; fd++) {
+		dest->files[fd] = src->files[fd];
+		if (dest->files[fd] != NULL)
+			kent_get(&dest->files[fd]->kent);
+	}
+}
+
+void fdtab_release(struct fdtab *tab)
+{
+	for (unsigned int fd = 0; fd < CONFIG_NFILE; fd++) {
+		struct file *file = tab->files[fd];
+		if (file != NULL) {
+			tab->files[fd] = NULL;
+			file_put(file);
+		}
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(tab->bitmap); i++)
+		tab->bitmap[i] = 0;
+}
+
 struct io_device_kevent_extra {
 	struct file *file;
 	struct task *task;
@@ -102,97 +149,252 @@ static int io_device_kevent_listener(struct kevent *event, void *_extra)
 		return KEVENT_CB_NONE;
 
 	extra->task->state = TASK_QUEUE;
-	kfree(extra);
-	file_put(extra->file);
-	kent_put(&extra->task->kent);
-	return KEVENT_CB_LISTENER_DEL | KEVENT_CB_STOP;
+	/*
+	 * don't return KEVENT_CB_STOP here because other tasks might be waiting
+	 * for the same device as well (they will just get -EBUSY again if we
+	 * were faster than them)
+	 */
+	return KEVENT_CB_LISTENER_DEL;
 }
 
+/*
+ * Block until the device reports one of `flags`.  The caller holds a
+ * reference to `file` for the entire time, and the task can't go away while
+ * it is waiting, so `extra` can safely live on our stack (syscalls run with
+ * interrupts disabled, so nothing can happen between registering the listener
+ * and going to sleep).
+ */
 static int iowait_device(struct file *file, enum device_kevent_flags flags)
 {
-	file_get(file->fd);
-	kent_get(&current->kent);
+	struct io_device_kevent_extra extra = {
+		.file = file,
+		.task = current,
+		.flags = flags,
+	};
 
-	/* this must be atomic because event listeners can't sleep but need to call free() */
-	struct io_device_kevent_extra *extra = atomic_kmalloc(sizeof(*extra));
-	if (extra == NULL)
+	if (kevent_listener_add(KEVENT_DEVICE, io_device_kevent_listener, &extra) == NULL)
 		return -ENOMEM;
 
-	extra->file = file;
-	extra->task = current;
-	extra->flags = flags;
-
-	kevent_listener_add(KEVENT_DEVICE, io_device_kevent_listener, extra);
 	yield(TASK_IOWAIT);
 	return 0;
 }
 
-ssize_t file_read(void *buf, struct file *file, size_t len)
+/* consume `len` bytes from the front of an iovec array */
+static void iov_advance(struct iovec **iov, int *iovcnt, size_t len)
+{
+	while (len != 0 && *iovcnt != 0) {
+		struct iovec *cur = *iov;
+		if (len < cur->iov_len) {
+			cur->iov_base += len;
+			cur->iov_len -= len;
+			break;
+		}
+
+		len -= cur->iov_len;
+		(*iov)++;
+		(*iovcnt)--;
+	}
+}
+
+/* skip over empty segments so devices never see zero-length requests */
+static void iov_skip_empty(struct iovec **iov, int *iovcnt)
 {
-	if (len == 0)
-		return 0;
+	while (*iovcnt != 0 && (*iov)->iov_len == 0) {
+		(*iov)++;
+		(*iovcnt)--;
+	}
+}
 
+ssize_t file_readv(struct file *file, struct iovec *iov, int iovcnt)
+{
 	ssize_t ret = 0;
 
+	if ((file->flags & O_ACCMODE) == O_WRONLY)
+		return -EBADF;
+
 	mutex_lock(&file->lock);
 
-	while (ret < (ssize_t)len) {
-		ssize_t tmp = file->device->read(buf, file->device, len, file->pos);
+	iov_skip_empty(&iov, &iovcnt);
+	while (iovcnt != 0) {
+		ssize_t tmp = file->device->read(iov->iov_base, file->device, iov->iov_len, file->pos);
+
+		if (tmp > 0) {
+			/*
+			 * broadcast readers keep their stream position in there as
+			 * well, which is allowed to wrap around (see bcast.c)
+			 */
+			if (file->type == FILE_TYPE_REGULAR || file->type == FILE_TYPE_BROADCAST)
+				file->pos = (off_t)((size_t)file->pos + (size_t)tmp);
+			ret += tmp;
+			iov_advance(&iov, &iovcnt, (size_t)tmp);
+			iov_skip_empty(&iov, &iovcnt);
+			/* terminals in canonical mode return one line per read */
+			if (file->device->flags & DEVICE_READ_RECORDS)
+				break;
+			/*
+			 * streams keep reading until the device runs dry,
+			 * which is caught by the -EBUSY branch below
+			 */
+			continue;
+		}
+
+		/* devices return 0 on EOF and -EBUSY if they would block */
+		if (tmp == 0)
+			break;
+
+		if (tmp == -EBUSY) {
+			/* streams return whatever we got so far */
+			if (ret != 0 && file->type != FILE_TYPE_REGULAR)
+				break;
+			if (file->flags & O_NONBLOCK) {
+				if (ret == 0)
+					ret = -EAGAIN;
+				break;
+			}
+			tmp = iowait_device(file, DEVICE_KEVENT_RX);
+		}
+
 		if (tmp < 0) {
-			if (tmp == -EBUSY) {
-				tmp = iowait_device(file, DEVICE_KEVENT_RX);
-			} else {
+			/* only report errors if we didn't read anything */
+			if (ret == 0)
 				ret = tmp;
+			break;
+		}
+	}
+
+	mutex_unlock(&file->lock);
+	if (ret > 0)
+		file_kevent_create_and_dispatch(file, FILE_KEVENT_READ);
+
+	return ret;
+}
+
+ssize_t file_read(void *buf, struct file *file, size_t len)
+{
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = len,
+	};
+
+	return file_readv(file, &iov, 1);
+}
+
+static ssize_t file_device_writev(struct file *file, const struct iovec *iov, int iovcnt)
+{
+	struct device *device = file->device;
+
+	if (device->writev != NULL)
+		return device->writev(device, iov, iovcnt, file->pos);
+	else
+		return device->write(device, iov->iov_base, iov->iov_len, file->pos);
+}
+
+ssize_t file_writev(struct file *file, struct iovec *iov, int iovcnt)
+{
+	ssize_t ret = 0;
+
+	if ((file->flags & O_ACCMODE) == O_RDONLY)
+		return -EBADF;
+
+	mutex_lock(&file->lock);
+
+	iov_skip_empty(&iov, &iovcnt);
+	while (iovcnt != 0) {
+		if ((file->flags & O_APPEND) && file->device->size != NULL)
+			file->pos = (off_t)file->device->size(file->device);
+
+		ssize_t tmp = file_device_writev(file, iov, iovcnt);
+
+		if (tmp > 0) {
+			if (file->type == FILE_TYPE_REGULAR)
+				file->pos += tmp;
+			ret += tmp;
+			iov_advance(&iov, &iovcnt, (size_t)tmp);
+			iov_skip_empty(&iov, &iovcnt);
+			continue;
+		}
+
+		if (tmp == 0 || tmp == -EBUSY) {
+			if (file->flags & O_NONBLOCK) {
+				if (ret == 0)
+					ret = -EAGAIN;
 				break;
 			}
+			tmp = iowait_device(file, DEVICE_KEVENT_TX);
 		}
 
-		if (file->type == FILE_TYPE_REGULAR)
-			file->pos += tmp;
-
-		ret += tmp;
-		buf += tmp;
+		if (tmp < 0) {
+			if (ret == 0)
+				ret = tmp;
+			break;
+		}
 	}
 
 	mutex_unlock(&file->lock);
-	file_kevent_create_and_dispatch(file, FILE_KEVENT_READ);
+	if (ret > 0)
+		file_kevent_create_and_dispatch(file, FILE_KEVENT_WRITE);
 
 	return ret;
 }
 
 ssize_t file_write(struct file *file, const void *buf, size_t len)
 {
-	if (len == 0)
-		return 0;
+	struct iovec iov = {
+		/* file_writev() doesn't touch the data itself */
+		.iov_base = (void *)buf,
+		.iov_len = len,
+	};
+
+	return file_writev(file, &iov, 1);
+}
 
+ssize_t file_write_dma(struct file *file, struct dmabuf *buf)
+{
+	struct device *device = file->device;
+	size_t done = 0;
 	ssize_t ret = 0;
 
+	if ((file->flags & O_ACCMODE) == O_RDONLY)
+		return -EBADF;
+
 	mutex_lock(&file->lock);
 
-	while (ret < (ssize_t)len) {
-		ssize_t tmp = file->device->write(file->device, buf, len, file->pos);
-		if (tmp < 0) {
-			if (tmp == -EBUSY) {
-				tmp = iowait_device(file, DEVICE_KEVENT_TX);
-				if (tmp < 0) {
-					ret = tmp;
-					break;
-				}
-			} else {
-				ret = tmp;
-				break;
-			}
+	while (done < buf->len) {
+		ssize_t tmp;
+
+		if (device->write_dma != NULL) {
+			tmp = device->write_dma(device, buf);
+			/* the device takes either everything or nothing */
+			if (tmp > 0)
+				tmp = (ssize_t)buf->len;
+		} else {
+			if ((file->flags & O_APPEND) && device->size != NULL)
+				file->pos = (off_t)device->size(device);
+			tmp = device->write(device, buf->data + done, buf->len - done, file->pos);
 		}
 
-		if (file->type == FILE_TYPE_REGULAR)
-			file->pos += tmp;
+		if (tmp > 0) {
+			if (file->type == FILE_TYPE_REGULAR)
+				file->pos += tmp;
+			done += (size_t)tmp;
+			continue;
+		}
+
+		/* the caller can't put the data back, so O_NONBLOCK is ignored */
+		if (tmp == 0 || tmp == -EBUSY)
+			tmp = iowait_device(file, DEVICE_KEVENT_TX);
 
-		ret += tmp;
-		buf += tmp;
+		if (tmp < 0) {
+			ret = tmp;
+			break;
+		}
 	}
 
 	mutex_unlock(&file->lock);
-	file_kevent_create_and_dispatch(file, FILE_KEVENT_WRITE );
+	if (done > 0) {
+		ret = (ssize_t)done;
+		file_kevent_create_and_dispatch(file, FILE_KEVENT_WRITE);
+	}
 
 	return ret;
 }
@@ -226,6 +428,9 @@ struct file_kevent *file_kevent_create(struct file *f, enum file_kevent_flags fl
 
 void file_kevent_create_and_dispatch(struct file *f, enum file_kevent_flags flags)
 {
+	if (!kevent_has_listeners(KEVENT_FILE))
+		return;
+
 	struct file_kevent *event = file_kevent_create(f, flags);
 	if (event != NULL)
 		kevent_dispatch(&event->kevent);
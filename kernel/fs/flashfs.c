@@ -0,0 +1,768 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file flashfs.c
+ * @brief Log-structured filesystem for the flash storage area.
+ *
+ * Every page in the storage area holds exactly one record, which consists of
+ * a header followed by a payload filling the rest of the page.  Records are
+ * never modified in place; instead, a newer version is written to a different
+ * page and the old one becomes stale.  There are two kinds of records:
+ *
+ * - inode records store the name of a file.  A new inode record is written
+ *   whenever a file is created or truncated, and any data records older
+ *   than the inode record are considered stale.
+ * - data records store one block of a file, which is exactly one payload in
+ *   size.  Data beyond the end of a file and in holes is always zero.
+ *
+ * Each record carries a global sequence number and a checksum over the entire
+ * page.  When mounting, all pages are scanned and the record with the highest
+ * sequence number wins.  A page that was only partially programmed because of
+ * a power loss fails the checksum and is ignored, so the previous version of
+ * the record takes effect again.  Pages are only ever overwritten if they don't
+ * contain a live record, which means the metadata is always consistent.
+ *
+ * New records go to the next free page after the one written last, wrapping
+ * around at the end of the storage area.  That way, erase cycles are spread
+ * evenly across all pages that don't hold long-lived data.
+ *
+ * The entire index lives in RAM: a hash table maps file names to inodes, and
+ * every inode has an array that maps block numbers to pages.  To make appends
+ * cheap, the block that was written to last is kept in a RAM buffer and only
+ * programmed when a different block is accessed or the file is closed, so
+ * data written since then is lost if the system crashes before that.
+ *
+ * Programming a page suspends the calling task, so flashfs files can only be
+ * accessed from syscall context and not through the I/O ring.
+ */
+
+#include <ardix/atomic.h>
+#include <ardix/crc32.h>
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/flash.h>
+#include <ardix/flashfs.h>
+#include <ardix/malloc.h>
+#include <ardix/mutex.h>
+#include <ardix/util.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if CONFIG_FLASHFS_MAXFILES > 255
+#error "CONFIG_FLASHFS_MAXFILES must not exceed 255"
+#endif
+
+/** "ARDF" in little endian */
+#define FLASHFS_MAGIC 0x46445241
+
+#define FLASHFS_NO_PAGE UINT16_MAX
+
+/* size of the name hash table, always leaves empty slots for probing */
+#define FLASHFS_HASH_SIZE (2 * CONFIG_FLASHFS_MAXFILES)
+
+enum flashfs_record_type {
+	FLASHFS_RECORD_INODE	= 1,
+	FLASHFS_RECORD_DATA	= 2,
+};
+
+struct flashfs_record {
+	uint32_t magic;
+	/* checksum of the entire page after this field */
+	uint32_t crc;
+	uint32_t seq;
+	/* file size at the time the record was written */
+	uint32_t size;
+	/* block number within the file (data records only) */
+	uint32_t block;
+	uint16_t ino;
+	uint8_t type;
+	uint8_t _reserved;
+};
+
+struct flashfs_inode {
+	struct device device;
+	bool used;
+	char name[CONFIG_FLASHFS_NAMELEN + 1];
+	size_t size;
+	/* sequence number of the current inode record */
+	uint32_t seq;
+	/* sequence number of the record `size` was taken from (only while mounting) */
+	uint32_t size_seq;
+	uint16_t inode_page;
+	unsigned int block_count;
+	/* page number of every block, or FLASHFS_NO_PAGE for holes */
+	uint16_t *blocks;
+};
+
+#define device_to_flashfs_inode(ptr) container_of(ptr, struct flashfs_inode, device)
+
+static struct flash *flashfs_flash = NULL;
+static struct flashfs_inode flashfs_inodes[CONFIG_FLASHFS_MAXFILES];
+/* inode number + 1 for every name, 0 means the slot is empty */
+static uint8_t flashfs_hash[FLASHFS_HASH_SIZE];
+
+/* whether a page holds a live record */
+static bool *flashfs_live;
+static unsigned int flashfs_free;
+/* where to start looking for a free page */
+static unsigned int flashfs_head;
+/* sequence number of the next record */
+static uint32_t flashfs_seq;
+/* payload bytes per page */
+static size_t flashfs_block_size;
+
+/*
+ * One page worth of memory, the record header is followed by the block held
+ * in the write-back buffer (if any).  Everything here is protected by
+ * flashfs_lock, which is also held while a page is being programmed.
+ */
+static uint8_t *flashfs_page;
+static struct {
+	struct flashfs_inode *inode;
+	unsigned int block;
+	bool dirty;
+} flashfs_wb;
+static MUTEX(flashfs_lock);
+
+#define flashfs_record() ((struct flashfs_record *)flashfs_page)
+#define flashfs_payload() (flashfs_page + sizeof(struct flashfs_record))
+
+static uint32_t flashfs_page_crc(void)
+{
+	const size_t offset = offsetof(struct flashfs_record, seq);
+	return crc32(0, flashfs_page + offset, flashfs_flash->page_size - offset);
+}
+
+/* FNV-1a */
+static unsigned int flashfs_hash_name(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name != '\0') {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash % FLASHFS_HASH_SIZE;
+}
+
+static struct flashfs_inode *flashfs_lookup(const char *name)
+{
+	unsigned int i = flashfs_hash_name(name);
+
+	while (flashfs_hash[i] != 0) {
+		struct flashfs_inode *inode = &flashfs_inodes[flashfs_hash[i] - 1];
+		if (strcmp(inode->name, name) == 0)
+			return inode;
+		i = (i + 1) % FLASHFS_HASH_SIZE;
+	}
+
+	return NULL;
+}
+
+static void flashfs_hash_insert(struct flashfs_inode *inode)
+{
+	unsigned int i = flashfs_hash_name(inode->name);
+
+	while (flashfs_hash[i] != 0)
+		i = (i + 1) % FLASHFS_HASH_SIZE;
+
+	flashfs_hash[i] = (uint8_t)(inode - flashfs_inodes + 1);
+}
+
+static void flashfs_page_release(uint16_t page)
+{
+	if (page != FLASHFS_NO_PAGE && flashfs_live[page]) {
+		flashfs_live[page] = false;
+		flashfs_free++;
+	}
+}
+
+/*
+ * Find the next page without a live record.  One page is always kept free
+ * for inode records, so files can still be truncated if the storage is full.
+ */
+static int flashfs_alloc_page(bool reserve)
+{
+	if (flashfs_free <= (reserve ? 1u : 0u))
+		return -ENOSPC;
+
+	while (flashfs_live[flashfs_head])
+		flashfs_head = (flashfs_head + 1) % CONFIG_FLASHFS_PAGES;
+
+	int page = (int)flashfs_head;
+	flashfs_head = (flashfs_head + 1) % CONFIG_FLASHFS_PAGES;
+	return page;
+}
+
+/*
+ * Fill in the record header in flashfs_page and program it to a free page.
+ * The payload must already be in place.  Returns the page number on success.
+ */
+static int flashfs_commit(struct flashfs_inode *inode, enum flashfs_record_type type,
+			  unsigned int block)
+{
+	struct flashfs_record *rec = flashfs_record();
+
+	int page = flashfs_alloc_page(type == FLASHFS_RECORD_DATA);
+	if (page < 0)
+		return page;
+
+	rec->magic = FLASHFS_MAGIC;
+	rec->seq = flashfs_seq++;
+	rec->size = (uint32_t)inode->size;
+	rec->block = block;
+	rec->ino = (uint16_t)(inode - flashfs_inodes);
+	rec->type = (uint8_t)type;
+	rec->_reserved = 0;
+	rec->crc = flashfs_page_crc();
+
+	/* if this fails, the page is still free and gets erased next time */
+	int err = flash_program(flashfs_flash, (unsigned int)page, flashfs_page);
+	if (err != 0)
+		return err;
+
+	flashfs_live[page] = true;
+	flashfs_free--;
+	return page;
+}
+
+/* program the write-back buffer if it is dirty */
+static int flashfs_flush(void)
+{
+	struct flashfs_inode *inode = flashfs_wb.inode;
+
+	if (inode == NULL || !flashfs_wb.dirty)
+		return 0;
+
+	int page = flashfs_commit(inode, FLASHFS_RECORD_DATA, flashfs_wb.block);
+	if (page < 0)
+		return page;
+
+	flashfs_page_release(inode->blocks[flashfs_wb.block]);
+	inode->blocks[flashfs_wb.block] = (uint16_t)page;
+	flashfs_wb.dirty = false;
+
+	return 0;
+}
+
+/* write a new inode record, which supersedes all existing data records */
+static int flashfs_write_inode(struct flashfs_inode *inode)
+{
+	int err = flashfs_flush();
+	if (err != 0)
+		return err;
+	/* we are about to overwrite the payload */
+	flashfs_wb.inode = NULL;
+
+	memset(flashfs_payload(), 0, flashfs_block_size);
+	strcpy((char *)flashfs_payload(), inode->name);
+
+	int page = flashfs_commit(inode, FLASHFS_RECORD_INODE, 0);
+	if (page < 0)
+		return page;
+
+	flashfs_page_release(inode->inode_page);
+	inode->inode_page = (uint16_t)page;
+	inode->seq = flashfs_seq - 1;
+
+	return 0;
+}
+
+/* make sure the block map can hold `count` entries */
+static int flashfs_reserve(struct flashfs_inode *inode, unsigned int count)
+{
+	if (count <= inode->block_count)
+		return 0;
+
+	/* round up so appending doesn't reallocate for every single block */
+	count = (count + 7) & ~7u;
+
+	uint16_t *blocks = kmalloc(count * sizeof(*blocks));
+	if (blocks == NULL)
+		return -ENOMEM;
+
+	for (unsigned int i = 0; i < count; i++)
+		blocks[i] = i < inode->block_count ? inode->blocks[i] : FLASHFS_NO_PAGE;
+
+	kfree(inode->blocks);
+	inode->blocks = blocks;
+	inode->block_count = count;
+
+	return 0;
+}
+
+static void flashfs_free_blocks(struct flashfs_inode *inode)
+{
+	for (unsigned int i = 0; i < inode->block_count; i++)
+		flashfs_page_release(inode->blocks[i]);
+	kfree(inode->blocks);
+
+	inode->blocks = NULL;
+	inode->block_count = 0;
+}
+
+static int flashfs_truncate(struct flashfs_inode *inode)
+{
+	size_t size = inode->size;
+
+	/* anything we still had buffered is gone anyway */
+	if (flashfs_wb.inode == inode)
+		flashfs_wb.inode = NULL;
+
+	inode->size = 0;
+	int err = flashfs_write_inode(inode);
+	if (err != 0) {
+		inode->size = size;
+		return err;
+	}
+
+	flashfs_free_blocks(inode);
+	return 0;
+}
+
+/*
+ * Move a block into the write-back buffer.  If `overwrite` is true, the
+ * caller is going to replace the entire block, so we don't need to read it.
+ */
+static int flashfs_load(struct flashfs_inode *inode, unsigned int block, bool overwrite)
+{
+	if (flashfs_wb.inode == inode && flashfs_wb.block == block)
+		return 0;
+
+	int err = flashfs_flush();
+	if (err != 0)
+		return err;
+	flashfs_wb.inode = NULL;
+
+	err = flashfs_reserve(inode, block + 1);
+	if (err != 0)
+		return err;
+
+	uint16_t page = inode->blocks[block];
+	if (page == FLASHFS_NO_PAGE || overwrite) {
+		memset(flashfs_payload(), 0, flashfs_block_size);
+	} else {
+		err = flash_read(flashfs_flash, flashfs_payload(), page,
+				 sizeof(struct flashfs_record), flashfs_block_size);
+		if (err != 0)
+			return err;
+	}
+
+	flashfs_wb.inode = inode;
+	flashfs_wb.block = block;
+	flashfs_wb.dirty = false;
+
+	return 0;
+}
+
+static ssize_t flashfs_read(void *dest, struct device *dev, size_t len, off_t offset)
+{
+	struct flashfs_inode *inode = device_to_flashfs_inode(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret = 0;
+
+	if (offset < 0)
+		return -EINVAL;
+	/* reading the flash may sleep while somebody else is programming it */
+	if (is_atomic())
+		return -EOPNOTSUPP;
+
+	mutex_lock(&flashfs_lock);
+
+	if (pos >= inode->size) {
+		mutex_unlock(&flashfs_lock);
+		return 0; /* EOF */
+	}
+	if (len > inode->size - pos)
+		len = inode->size - pos;
+
+	while ((size_t)ret < len) {
+		unsigned int block = pos / flashfs_block_size;
+		size_t block_pos = pos % flashfs_block_size;
+		size_t chunk = flashfs_block_size - block_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		if (flashfs_wb.inode == inode && flashfs_wb.block == block) {
+			memcpy(dest + ret, flashfs_payload() + block_pos, chunk);
+		} else if (block >= inode->block_count || inode->blocks[block] == FLASHFS_NO_PAGE) {
+			memset(dest + ret, 0, chunk);
+		} else {
+			int err = flash_read(flashfs_flash, dest + ret, inode->blocks[block],
+					     sizeof(struct flashfs_record) + block_pos, chunk);
+			if (err != 0) {
+				if (ret == 0)
+					ret = err;
+				break;
+			}
+		}
+
+		ret += (ssize_t)chunk;
+		pos += chunk;
+	}
+
+	mutex_unlock(&flashfs_lock);
+	return ret;
+}
+
+static ssize_t flashfs_write(struct device *dev, const void *src, size_t len, off_t offset)
+{
+	struct flashfs_inode *inode = device_to_flashfs_inode(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret = 0;
+
+	if (offset < 0)
+		return -EINVAL;
+	if (len > SIZE_MAX - pos)
+		return -EFBIG;
+	/* programming suspends the task, which we can't do in scheduler context */
+	if (is_atomic())
+		return -EOPNOTSUPP;
+
+	mutex_lock(&flashfs_lock);
+
+	while ((size_t)ret < len) {
+		unsigned int block = pos / flashfs_block_size;
+		size_t block_pos = pos % flashfs_block_size;
+		size_t chunk = flashfs_block_size - block_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		/* a file can't possibly have more blocks than there are pages */
+		int err = block < CONFIG_FLASHFS_PAGES
+			? flashfs_load(inode, block, chunk == flashfs_block_size)
+			: -EFBIG;
+		if (err != 0) {
+			if (ret == 0)
+				ret = err;
+			break;
+		}
+
+		memcpy(flashfs_payload() + block_pos, src + ret, chunk);
+		flashfs_wb.dirty = true;
+		ret += (ssize_t)chunk;
+		pos += chunk;
+
+		if (pos > inode->size)
+			inode->size = pos;
+	}
+
+	mutex_unlock(&flashfs_lock);
+	return ret;
+}
+
+static ssize_t flashfs_size(struct device *dev)
+{
+	struct flashfs_inode *inode = device_to_flashfs_inode(dev);
+	return (ssize_t)inode->size;
+}
+
+static void flashfs_close(struct device *dev, struct file *file)
+{
+	struct flashfs_inode *inode = device_to_flashfs_inode(dev);
+
+	/* if we can't sleep, the block stays buffered until the next flush */
+	if (is_atomic())
+		return;
+
+	mutex_lock(&flashfs_lock);
+	if (flashfs_wb.inode == inode)
+		flashfs_flush();
+	mutex_unlock(&flashfs_lock);
+}
+
+static void flashfs_inode_destroy(struct kent *kent)
+{
+	/* inodes are statically allocated and never released */
+}
+
+static int flashfs_inode_init(struct flashfs_inode *inode)
+{
+	inode->device.kent.parent = NULL;
+	inode->device.kent.destroy = flashfs_inode_destroy;
+
+	inode->used = false;
+	inode->name[0] = '\0';
+	inode->size = 0;
+	inode->seq = 0;
+	inode->size_seq = 0;
+	inode->inode_page = FLASHFS_NO_PAGE;
+	inode->block_count = 0;
+	inode->blocks = NULL;
+
+	int err = device_init(&inode->device);
+	if (err != 0)
+		return err;
+
+	inode->device.read = flashfs_read;
+	inode->device.write = flashfs_write;
+	inode->device.size = flashfs_size;
+	inode->device.close = flashfs_close;
+	return 0;
+}
+
+/* apply the record in `page` to the index while mounting */
+static int flashfs_scan_page(unsigned int page, uint32_t *page_seq)
+{
+	struct flashfs_record *rec = flashfs_record();
+
+	int err = flash_read(flashfs_flash, flashfs_page, page, 0, flashfs_flash->page_size);
+	if (err != 0)
+		return err;
+
+	/* erased or torn pages are simply free */
+	if (rec->magic != FLASHFS_MAGIC || rec->ino >= CONFIG_FLASHFS_MAXFILES)
+		return 0;
+	if (rec->crc != flashfs_page_crc())
+		return 0;
+
+	page_seq[page] = rec->seq;
+	if (rec->seq >= flashfs_seq) {
+		flashfs_seq = rec->seq + 1;
+		flashfs_head = (page + 1) % CONFIG_FLASHFS_PAGES;
+	}
+
+	struct flashfs_inode *inode = &flashfs_inodes[rec->ino];
+	if (rec->seq > inode->size_seq) {
+		inode->size = rec->size;
+		inode->size_seq = rec->seq;
+	}
+
+	switch (rec->type) {
+	case FLASHFS_RECORD_INODE:
+		if (rec->seq > inode->seq) {
+			inode->used = true;
+			inode->seq = rec->seq;
+			inode->inode_page = (uint16_t)page;
+			memcpy(inode->name, flashfs_payload(), CONFIG_FLASHFS_NAMELEN);
+			inode->name[CONFIG_FLASHFS_NAMELEN] = '\0';
+		}
+		break;
+	case FLASHFS_RECORD_DATA:
+		if (rec->block >= CONFIG_FLASHFS_PAGES)
+			break;
+		err = flashfs_reserve(inode, rec->block + 1);
+		if (err != 0)
+			return err;
+		uint16_t *cur = &inode->blocks[rec->block];
+		if (*cur == FLASHFS_NO_PAGE || page_seq[*cur] < rec->seq)
+			*cur = (uint16_t)page;
+		break;
+	}
+
+	return 0;
+}
+
+/* drop stale blocks and rebuild the live page map after scanning */
+static void flashfs_finish_mount(uint32_t *page_seq)
+{
+	flashfs_free = CONFIG_FLASHFS_PAGES;
+
+	for (unsigned int i = 0; i < CONFIG_FLASHFS_MAXFILES; i++) {
+		struct flashfs_inode *inode = &flashfs_inodes[i];
+
+		if (!inode->used) {
+			/* data records without an inode record, can't do anything with them */
+			kfree(inode->blocks);
+			inode->blocks = NULL;
+			inode->block_count = 0;
+			inode->size = 0;
+			continue;
+		}
+
+		flashfs_live[inode->inode_page] = true;
+		flashfs_free--;
+
+		for (unsigned int block = 0; block < inode->block_count; block++) {
+			uint16_t page = inode->blocks[block];
+			if (page == FLASHFS_NO_PAGE)
+				continue;
+
+			/* written before the file was truncated */
+			if (page_seq[page] < inode->seq) {
+				inode->blocks[block] = FLASHFS_NO_PAGE;
+			} else {
+				flashfs_live[page] = true;
+				flashfs_free--;
+			}
+		}
+
+		flashfs_hash_insert(inode);
+	}
+}
+
+int flashfs_init(void)
+{
+	struct flash *flash = flash_storage;
+	int err;
+
+	if (flash == NULL)
+		return -ENODEV;
+	if (flash->page_count < CONFIG_FLASHFS_PAGES
+	    || flash->page_size <= sizeof(struct flashfs_record) + CONFIG_FLASHFS_NAMELEN + 1
+	    || flash->page_size % sizeof(uint32_t) != 0)
+		return -EINVAL;
+
+	for (unsigned int i = 0; i < CONFIG_FLASHFS_MAXFILES; i++) {
+		err = flashfs_inode_init(&flashfs_inodes[i]);
+		if (err != 0)
+			return err;
+	}
+	memset(flashfs_hash, 0, sizeof(flashfs_hash));
+
+	flashfs_flash = flash;
+	flashfs_block_size = flash->page_size - sizeof(struct flashfs_record);
+	flashfs_seq = 1;
+	flashfs_head = 0;
+	flashfs_wb.inode = NULL;
+
+	err = -ENOMEM;
+	flashfs_page = kmalloc(flash->page_size);
+	if (flashfs_page == NULL)
+		goto err_alloc_page;
+	flashfs_live = kmalloc(CONFIG_FLASHFS_PAGES * sizeof(*flashfs_live));
+	if (flashfs_live == NULL)
+		goto err_alloc_live;
+	uint32_t *page_seq = kmalloc(CONFIG_FLASHFS_PAGES * sizeof(*page_seq));
+	if (page_seq == NULL)
+		goto err_alloc_page_seq;
+
+	for (unsigned int page = 0; page < CONFIG_FLASHFS_PAGES; page++) {
+		flashfs_live[page] = false;
+		page_seq[page] = 0;
+	}
+
+	for (unsigned int page = 0; page < CONFIG_FLASHFS_PAGES; page++) {
+		err = flashfs_scan_page(page, page_seq);
+		if (err != 0)
+			goto err_scan;
+	}
+
+	flashfs_finish_mount(page_seq);
+	kfree(page_seq);
+	return 0;
+
+err_scan:
+	for (unsigned int i = 0; i < CONFIG_FLASHFS_MAXFILES; i++)
+		kfree(flashfs_inodes[i].blocks);
+	kfree(page_seq);
+err_alloc_page_seq:
+	kfree(flashfs_live);
+err_alloc_live:
+	kfree(flashfs_page);
+err_alloc_page:
+	flashfs_flash = NULL;
+	return err;
+}
+
+static int flashfs_check_name(const char *name)
+{
+	size_t len = 0;
+
+	while (name[len] != '\0') {
+		/* there are no directories */
+		if (name[len] == '/')
+			return -ENOENT;
+		len++;
+	}
+
+	if (len == 0)
+		return -ENOENT;
+	if (len > CONFIG_FLASHFS_NAMELEN)
+		return -ENAMETOOLONG;
+
+	return 0;
+}
+
+/* allocate an inode for a new file (flashfs_lock is held) */
+static struct flashfs_inode *flashfs_create(const char *name, int *err)
+{
+	struct flashfs_inode *inode = NULL;
+
+	for (unsigned int i = 0; i < CONFIG_FLASHFS_MAXFILES; i++) {
+		if (!flashfs_inodes[i].used) {
+			inode = &flashfs_inodes[i];
+			break;
+		}
+	}
+	if (inode == NULL) {
+		*err = -ENOSPC;
+		return NULL;
+	}
+
+	strcpy(inode->name, name);
+	inode->size = 0;
+	*err = flashfs_write_inode(inode);
+	if (*err != 0)
+		return NULL;
+
+	inode->used = true;
+	flashfs_hash_insert(inode);
+	return inode;
+}
+
+struct file *flashfs_open(const char *name, int flags, int *err)
+{
+	struct file *file = NULL;
+	struct flashfs_inode *inode;
+
+	if (flashfs_flash == NULL) {
+		*err = -ENODEV;
+		return NULL;
+	}
+
+	*err = flashfs_check_name(name);
+	if (*err != 0)
+		return NULL;
+
+	mutex_lock(&flashfs_lock);
+
+	inode = flashfs_lookup(name);
+	if (inode != NULL) {
+		if ((flags & O_CREAT) && (flags & O_EXCL)) {
+			*err = -EEXIST;
+			goto out;
+		}
+		if ((flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY && inode->size != 0) {
+			*err = flashfs_truncate(inode);
+			if (*err != 0)
+				goto out;
+		}
+	} else {
+		if (!(flags & O_CREAT)) {
+			*err = -ENOENT;
+			goto out;
+		}
+		inode = flashfs_create(name, err);
+		if (inode == NULL)
+			goto out;
+	}
+
+	file = file_create(&inode->device, FILE_TYPE_REGULAR, err);
+	if (file != NULL)
+		file->flags = flags & (O_ACCMODE | O_NONBLOCK | O_APPEND);
+
+out:
+	mutex_unlock(&flashfs_lock);
+	return file;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,429 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file ioring.c
+ * @brief Asynchronous I/O through shared submission and completion rings.
+ *
+ * Every submission queue entry is converted to a `struct ioring_req` and
+ * stored in a small per-task array of requests in flight.  Requests are first
+ * attempted right away from `ioring_enter()`; whatever can't complete
+ * immediately is retried from a device kevent listener whenever any device
+ * involved signals that it became ready.  That listener runs in scheduler
+ * context, so requests are only ever attempted with the non-blocking device
+ * callbacks and `mutex_trylock()`.
+ *
+ * Dropping the file references of completed requests may end up in
+ * `file_destroy()`, which can sleep, so that is deferred to the next
+ * `ioring_enter()` call (see `ioring_reap()`).
+ */
+
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/ioring.h>
+#include <ardix/kevent.h>
+#include <ardix/malloc.h>
+#include <ardix/sched.h>
+#include <ardix/syscall.h>
+#include <ardix/task.h>
+#include <ardix/userspace.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ioring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <toolchain.h>
+
+enum ioring_req_state {
+	IORING_REQ_FREE = 0,
+	IORING_REQ_PENDING,
+	/* completion has been posted, but the file reference is still held */
+	IORING_REQ_DONE,
+};
+
+struct ioring_req {
+	enum ioring_req_state state;
+	enum ioring_op opcode;
+	struct file *file;
+	void *buf;
+	size_t len;
+	uintptr_t user_data;
+	long res;
+};
+
+struct ioring_ctx {
+	struct task *task;
+	__user struct ioring *ring;
+	/* copied from the ring on setup so the task can't change them later */
+	__user struct ioring_sqe *sqes;
+	__user struct ioring_cqe *cqes;
+	unsigned int sq_mask;
+	unsigned int cq_mask;
+
+	struct kevent_listener *listener;
+	/* set while the task is blocked in ioring_enter() */
+	bool waiting;
+
+	/* requests in flight, in submission order */
+	unsigned int req_head;
+	unsigned int req_count;
+	struct ioring_req reqs[CONFIG_IORING_MAXPENDING];
+};
+
+static inline struct ioring_req *ioring_req_at(struct ioring_ctx *ctx, unsigned int i)
+{
+	return &ctx->reqs[(ctx->req_head + i) % CONFIG_IORING_MAXPENDING];
+}
+
+static inline unsigned int ioring_cq_count(struct ioring_ctx *ctx)
+{
+	return ctx->ring->cq_tail - ctx->ring->cq_head;
+}
+
+static void ioring_post(struct ioring_ctx *ctx, struct ioring_req *req)
+{
+	unsigned int tail = ctx->ring->cq_tail;
+	struct ioring_cqe cqe = {
+		.user_data = req->user_data,
+		.res = req->res,
+	};
+
+	copy_to_user(&ctx->cqes[tail & ctx->cq_mask], &cqe, sizeof(cqe));
+	/* only publish the entry after it has been written */
+	ctx->ring->cq_tail = tail + 1;
+}
+
+/* attempt a request without blocking, returns true if it completed */
+static bool ioring_req_try(struct ioring_req *req)
+{
+	struct file *file = req->file;
+	struct device *device;
+	ssize_t ret;
+
+	if (req->opcode == IORING_OP_NOP)
+		return true;
+
+	if (mutex_trylock(&file->lock) != 0)
+		return false;
+
+	device = file->device;
+	if (req->opcode == IORING_OP_READ)
+		ret = device->read(req->buf, device, req->len, file->pos);
+	else
+		ret = device->write(device, req->buf, req->len, file->pos);
+
+	/* broadcast positions may wrap around, see bcast.c */
+	if (ret > 0 && file->type != FILE_TYPE_PIPE)
+		file->pos = (off_t)((size_t)file->pos + (size_t)ret);
+
+	mutex_unlock(&file->lock);
+
+	/* same rules as in file_readv() and file_writev() */
+	if (ret == -EBUSY)
+		return false;
+	if (ret == 0 && req->opcode == IORING_OP_WRITE)
+		return false;
+
+	if (ret > 0) {
+		file_kevent_create_and_dispatch(file, req->opcode == IORING_OP_READ
+						      ? FILE_KEVENT_READ
+						      : FILE_KEVENT_WRITE);
+	}
+
+	req->res = ret;
+	return true;
+}
+
+/* returns true if a request before index `i` operates on the same file */
+static bool ioring_req_is_blocked(struct ioring_ctx *ctx, unsigned int i)
+{
+	struct ioring_req *req = ioring_req_at(ctx, i);
+
+	if (req->file == NULL)
+		return false;
+
+	for (unsigned int j = 0; j < i; j++) {
+		struct ioring_req *prev = ioring_req_at(ctx, j);
+		if (prev->state == IORING_REQ_PENDING && prev->file == req->file)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Attempt all pending requests and post their completions.
+ * May be called from scheduler context.  Returns the amount of completions.
+ */
+static unsigned int ioring_process(struct ioring_ctx *ctx)
+{
+	unsigned int completed = 0;
+
+	for (unsigned int i = 0; i < ctx->req_count; i++) {
+		struct ioring_req *req = ioring_req_at(ctx, i);
+
+		if (req->state != IORING_REQ_PENDING)
+			continue;
+		/* the task has to make room in the completion ring first */
+		if (ioring_cq_count(ctx) > ctx->cq_mask)
+			break;
+		/* requests on the same file complete in submission order */
+		if (ioring_req_is_blocked(ctx, i))
+			continue;
+
+		if (ioring_req_try(req)) {
+			ioring_post(ctx, req);
+			req->state = IORING_REQ_DONE;
+			completed++;
+		}
+	}
+
+	return completed;
+}
+
+/* release completed requests at the head of the queue (may sleep) */
+static void ioring_reap(struct ioring_ctx *ctx)
+{
+	while (ctx->req_count != 0) {
+		struct ioring_req *req = ioring_req_at(ctx, 0);
+		if (req->state != IORING_REQ_DONE)
+			break;
+
+		if (req->file != NULL)
+			file_put(req->file);
+		req->state = IORING_REQ_FREE;
+
+		ctx->req_head = (ctx->req_head + 1) % CONFIG_IORING_MAXPENDING;
+		ctx->req_count--;
+	}
+}
+
+static bool ioring_has_pending(struct ioring_ctx *ctx)
+{
+	for (unsigned int i = 0; i < ctx->req_count; i++) {
+		if (ioring_req_at(ctx, i)->state == IORING_REQ_PENDING)
+			return true;
+	}
+
+	return false;
+}
+
+static int ioring_kevent_listener(struct kevent *event, void *_extra)
+{
+	struct ioring_ctx *ctx = _extra;
+	struct device *device = kevent_to_device(event);
+	bool relevant = false;
+
+	for (unsigned int i = 0; i < ctx->req_count; i++) {
+		struct ioring_req *req = ioring_req_at(ctx, i);
+		if (req->state == IORING_REQ_PENDING && req->file != NULL
+		    && req->file->device == device) {
+			relevant = true;
+			break;
+		}
+	}
+
+	if (relevant && ioring_process(ctx) != 0 && ctx->waiting)
+		ctx->task->state = TASK_QUEUE;
+
+	/* we stay registered for as long as the ring exists */
+	return KEVENT_CB_NONE;
+}
+
+/* convert a submission queue entry to a request (syscall context only) */
+static void ioring_submit(struct ioring_req *req, const struct ioring_sqe *sqe)
+{
+	req->opcode = IORING_OP_NOP;
+	req->file = NULL;
+	req->user_data = sqe->user_data;
+	req->res = 0;
+
+	switch (sqe->opcode) {
+	case IORING_OP_NOP:
+		break;
+	case IORING_OP_READ:
+	case IORING_OP_WRITE:
+		if (!access_ok(sqe->buf, sqe->len, sqe->opcode == IORING_OP_READ)) {
+			req->res = -EFAULT;
+			break;
+		}
+		if (sqe->len == 0)
+			break;
+
+		req->file = file_get(sqe->fd);
+		if (req->file == NULL) {
+			req->res = -EBADF;
+			break;
+		}
+		if ((req->file->flags & O_ACCMODE) == (sqe->opcode == IORING_OP_READ ? O_WRONLY : O_RDONLY)) {
+			file_put(req->file);
+			req->file = NULL;
+			req->res = -EBADF;
+			break;
+		}
+		/* we can't bounce from scheduler context */
+		if (req->file->device->flags & DEVICE_BOUNCE_IO) {
+			file_put(req->file);
+			req->file = NULL;
+			req->res = -EOPNOTSUPP;
+			break;
+		}
+
+		req->opcode = sqe->opcode;
+		req->buf = sqe->buf;
+		req->len = sqe->len;
+		break;
+	default:
+		req->res = -EINVAL;
+		break;
+	}
+
+	/* errors are reported as a completion of a NOP request */
+	req->state = IORING_REQ_PENDING;
+}
+
+static inline bool is_power_of_two(unsigned int n)
+{
+	return n != 0 && (n & (n - 1)) == 0;
+}
+
+long sys_ioring_setup(__user struct ioring *ring)
+{
+	struct ioring copy;
+	struct ioring_ctx *ctx;
+
+	if (ring == NULL) {
+		ioring_release(current);
+		return 0;
+	}
+
+	if (current->ioring != NULL)
+		return -EBUSY;
+
+	if (!access_ok(ring, sizeof(*ring), true))
+		return -EFAULT;
+	copy_from_user(&copy, ring, sizeof(copy));
+
+	if (!is_power_of_two(copy.sq_entries) || !is_power_of_two(copy.cq_entries))
+		return -EINVAL;
+	/* a wrapped around size would make access_ok() check the wrong range */
+	if (copy.sq_entries > SIZE_MAX / sizeof(*copy.sqes)
+	    || copy.cq_entries > SIZE_MAX / sizeof(*copy.cqes))
+		return -EINVAL;
+	if (!access_ok(copy.sqes, copy.sq_entries * sizeof(*copy.sqes), false))
+		return -EFAULT;
+	if (!access_ok(copy.cqes, copy.cq_entries * sizeof(*copy.cqes), true))
+		return -EFAULT;
+
+	ctx = kmalloc(sizeof(*ctx));
+	if (ctx == NULL)
+		return -ENOMEM;
+
+	ctx->task = current;
+	ctx->ring = ring;
+	ctx->sqes = copy.sqes;
+	ctx->cqes = copy.cqes;
+	ctx->sq_mask = copy.sq_entries - 1;
+	ctx->cq_mask = copy.cq_entries - 1;
+	ctx->waiting = false;
+	ctx->req_head = 0;
+	ctx->req_count = 0;
+	for (unsigned int i = 0; i < CONFIG_IORING_MAXPENDING; i++)
+		ctx->reqs[i].state = IORING_REQ_FREE;
+
+	ring->sq_head = 0;
+	ring->sq_tail = 0;
+	ring->cq_head = 0;
+	ring->cq_tail = 0;
+
+	ctx->listener = kevent_listener_add(KEVENT_DEVICE, ioring_kevent_listener, ctx);
+	if (ctx->listener == NULL) {
+		kfree(ctx);
+		return -ENOMEM;
+	}
+
+	current->ioring = ctx;
+	return 0;
+}
+
+long sys_ioring_enter(unsigned int to_submit, unsigned int min_complete)
+{
+	struct ioring_ctx *ctx = current->ioring;
+	long submitted = 0;
+
+	if (ctx == NULL)
+		return -EINVAL;
+
+	/* we could never satisfy this, so don't wait forever */
+	if (min_complete > ctx->cq_mask + 1)
+		min_complete = ctx->cq_mask + 1;
+
+	ioring_reap(ctx);
+
+	while ((unsigned long)submitted < to_submit) {
+		unsigned int head = ctx->ring->sq_head;
+		if (head == ctx->ring->sq_tail)
+			break;
+		if (ctx->req_count == CONFIG_IORING_MAXPENDING)
+			break;
+
+		struct ioring_sqe sqe;
+		copy_from_user(&sqe, &ctx->sqes[head & ctx->sq_mask], sizeof(sqe));
+
+		/* file_get() may sleep, so the slot is only claimed afterwards */
+		struct ioring_req req;
+		ioring_submit(&req, &sqe);
+		*ioring_req_at(ctx, ctx->req_count) = req;
+		ctx->req_count++;
+
+		ctx->ring->sq_head = head + 1;
+		submitted++;
+	}
+
+	ioring_process(ctx);
+	ioring_reap(ctx);
+
+	while (ioring_cq_count(ctx) < min_complete && ioring_has_pending(ctx)) {
+		/* the kevent listener wakes us up when it completed anything */
+		ctx->waiting = true;
+		yield(TASK_IOWAIT);
+		ctx->waiting = false;
+		ioring_reap(ctx);
+	}
+
+	return submitted;
+}
+
+void ioring_release(struct task *task)
+{
+	struct ioring_ctx *ctx = task->ioring;
+
+	if (ctx == NULL)
+		return;
+
+	kevent_listener_del(ctx->listener);
+	task->ioring = NULL;
+
+	for (unsigned int i = 0; i < ctx->req_count; i++) {
+		struct ioring_req *req = ioring_req_at(ctx, i);
+		if (req->file != NULL)
+			file_put(req->file);
+	}
+
+	kfree(ctx);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,82 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/bcast.h>
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/syscall.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* off_t is the signed counterpart of size_t */
+#define OFF_MAX ((off_t)(SIZE_MAX >> 1))
+
+long sys_lseek(int fd, off_t offset, int whence)
+{
+	long ret;
+	off_t base;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if (f->type == FILE_TYPE_PIPE) {
+		file_put(f);
+		return -ESPIPE;
+	}
+
+	mutex_lock(&f->lock);
+
+	if (f->type == FILE_TYPE_BROADCAST) {
+		ret = bcast_lseek(f, offset, whence);
+		goto out;
+	}
+
+	switch (whence) {
+	case SEEK_SET:
+		base = 0;
+		break;
+	case SEEK_CUR:
+		base = f->pos;
+		break;
+	case SEEK_END:
+		if (f->device->size == NULL) {
+			ret = -EINVAL;
+			goto out;
+		}
+		base = (off_t)f->device->size(f->device);
+		break;
+	default:
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* the resulting offset must neither be negative nor overflow */
+	if ((offset < 0 && offset < -base) || (offset > 0 && base > OFF_MAX - offset)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	f->pos = base + offset;
+	ret = f->pos;
+
+out:
+	mutex_unlock(&f->lock);
+	file_put(f);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
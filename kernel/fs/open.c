@@ -0,0 +1,79 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/file.h>
+#include <ardix/flashfs.h>
+#include <ardix/serial.h>
+#include <ardix/syscall.h>
+#include <ardix/tmpfs.h>
+#include <ardix/userspace.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <toolchain.h>
+
+static const char flashfs_prefix[] = FLASHFS_MOUNTPOINT "/";
+static const char serial_prefix[] = SERIAL_DEVDIR "/";
+
+long sys_open(__user const char *path, int flags)
+{
+	char kpath[CONFIG_PATH_MAX];
+	long ret;
+	int err;
+
+	if ((flags & O_ACCMODE) == O_ACCMODE)
+		return -EINVAL;
+
+	ret = strncpy_from_user(kpath, path, sizeof(kpath));
+	if (ret < 0)
+		return ret;
+
+	struct file *f;
+	/* kpath is always at least as long as the prefixes */
+	if (memcmp(kpath, flashfs_prefix, sizeof(flashfs_prefix) - 1) == 0)
+		f = flashfs_open(&kpath[sizeof(flashfs_prefix) - 1], flags, &err);
+	else if (memcmp(kpath, serial_prefix, sizeof(serial_prefix) - 1) == 0)
+		f = serial_open(&kpath[sizeof(serial_prefix) - 1], flags, &err);
+	else
+		f = tmpfs_open(kpath, flags, &err);
+	if (f == NULL)
+		return err;
+
+	/* the fd table holds its own reference */
+	ret = fd_install(f);
+	file_put(f);
+
+	return ret;
+}
+
+long sys_close(int fd)
+{
+	return fd_close(fd);
+}
+
+long sys_mkdir(__user const char *path)
+{
+	char kpath[CONFIG_PATH_MAX];
+	long ret;
+
+	ret = strncpy_from_user(kpath, path, sizeof(kpath));
+	if (ret < 0)
+		return ret;
+
+	return tmpfs_mkdir(kpath);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
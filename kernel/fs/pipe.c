@@ -0,0 +1,234 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file pipe.c
+ * @brief Unidirectional inter-task pipes.
+ *
+ * A pipe is a device backed by a ring buffer, and both ends are files
+ * referring to that device.  The read end is opened `O_RDONLY` and the write
+ * end `O_WRONLY`, which is how the close callback tells them apart.  Blocking
+ * is handled entirely by the file layer: the device returns `-EBUSY` if the
+ * buffer is empty (or full), and every transfer dispatches a device kevent
+ * so the other end's waiters are woken up.
+ */
+
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/malloc.h>
+#include <ardix/rxring.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
+#include <ardix/util.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <toolchain.h>
+
+#if CONFIG_PIPE_BUFSZ == 0 || (CONFIG_PIPE_BUFSZ & (CONFIG_PIPE_BUFSZ - 1)) != 0
+#error "CONFIG_PIPE_BUFSZ must be a power of two"
+#endif
+
+struct pipe {
+	struct device device;
+	struct rxring *buf;
+	/* amount of open read and write ends */
+	unsigned int readers;
+	unsigned int writers;
+};
+
+#define device_to_pipe(ptr) container_of(ptr, struct pipe, device)
+
+static ssize_t pipe_read(void *dest, struct device *dev, size_t len, off_t offset)
+{
+	struct pipe *pipe = device_to_pipe(dev);
+	ssize_t ret;
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret != 0)
+		return -EBUSY;
+
+	ret = (ssize_t)rxring_read(dest, pipe->buf, len);
+	if (ret == 0 && pipe->writers != 0)
+		ret = -EBUSY;
+
+	mutex_unlock(&dev->lock);
+
+	if (ret > 0)
+		device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_TX);
+
+	/* 0 means EOF here because nobody is ever going to write again */
+	return ret;
+}
+
+static ssize_t pipe_write(struct device *dev, const void *src, size_t len, off_t offset)
+{
+	struct pipe *pipe = device_to_pipe(dev);
+	ssize_t ret;
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret != 0)
+		return -EBUSY;
+
+	if (pipe->readers == 0) {
+		ret = -EPIPE;
+	} else {
+		ret = (ssize_t)rxring_write(pipe->buf, src, len);
+		if (ret == 0)
+			ret = -EBUSY;
+	}
+
+	mutex_unlock(&dev->lock);
+
+	if (ret > 0)
+		device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_RX);
+
+	return ret;
+}
+
+static int pipe_poll(struct device *dev, off_t offset)
+{
+	struct pipe *pipe = device_to_pipe(dev);
+	int ret = 0;
+
+	if (rxring_len(pipe->buf) != 0)
+		ret |= POLLIN;
+	if (rxring_space(pipe->buf) != 0)
+		ret |= POLLOUT;
+	if (pipe->writers == 0)
+		ret |= POLLHUP;
+	if (pipe->readers == 0)
+		ret |= POLLERR;
+
+	return ret;
+}
+
+static void pipe_close(struct device *dev, struct file *file)
+{
+	struct pipe *pipe = device_to_pipe(dev);
+
+	if ((file->flags & O_ACCMODE) == O_RDONLY)
+		pipe->readers--;
+	else
+		pipe->writers--;
+
+	/* wake up everyone waiting for the other end so they see EOF or EPIPE */
+	device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_RX | DEVICE_KEVENT_TX
+					       | DEVICE_KEVENT_ERR);
+}
+
+static void pipe_destroy(struct kent *kent)
+{
+	struct pipe *pipe = device_to_pipe(kent_to_device(kent));
+
+	rxring_destroy(pipe->buf);
+	kfree(pipe);
+}
+
+static struct pipe *pipe_create(int *err)
+{
+	struct pipe *pipe = kmalloc(sizeof(*pipe));
+	if (pipe == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	pipe->buf = rxring_create(CONFIG_PIPE_BUFSZ);
+	if (pipe->buf == NULL) {
+		*err = -ENOMEM;
+		goto err_rxring_create;
+	}
+
+	pipe->readers = 0;
+	pipe->writers = 0;
+
+	pipe->device.kent.parent = NULL;
+	pipe->device.kent.destroy = pipe_destroy;
+
+	*err = device_init(&pipe->device);
+	if (*err != 0)
+		goto err_device_init;
+
+	pipe->device.read = pipe_read;
+	pipe->device.write = pipe_write;
+	pipe->device.poll = pipe_poll;
+	pipe->device.close = pipe_close;
+
+	return pipe;
+
+err_device_init:
+	rxring_destroy(pipe->buf);
+err_rxring_create:
+	kfree(pipe);
+	return NULL;
+}
+
+long sys_pipe(__user int fildes[2])
+{
+	int err;
+	int fds[2];
+
+	if (!access_ok(fildes, sizeof(fds), true))
+		return -EFAULT;
+
+	struct pipe *pipe = pipe_create(&err);
+	if (pipe == NULL)
+		return err;
+
+	struct file *rd = file_create(&pipe->device, FILE_TYPE_PIPE, &err);
+	if (rd == NULL)
+		goto err_rd_create;
+	rd->flags = O_RDONLY;
+	pipe->readers++;
+
+	struct file *wr = file_create(&pipe->device, FILE_TYPE_PIPE, &err);
+	if (wr == NULL)
+		goto err_wr_create;
+	wr->flags = O_WRONLY;
+	pipe->writers++;
+
+	fds[0] = fd_install(rd);
+	if (fds[0] < 0) {
+		err = fds[0];
+		goto err_fd_install_rd;
+	}
+
+	fds[1] = fd_install(wr);
+	if (fds[1] < 0) {
+		err = fds[1];
+		goto err_fd_install_wr;
+	}
+
+	copy_to_user(fildes, fds, sizeof(fds));
+
+	/* the fd table holds the references from now on */
+	file_put(wr);
+	file_put(rd);
+	device_put(&pipe->device);
+	return 0;
+
+err_fd_install_wr:
+	fd_close(fds[0]);
+err_fd_install_rd:
+	file_put(wr);
+err_wr_create:
+	file_put(rd);
+err_rd_create:
+	device_put(&pipe->device);
+	return err;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
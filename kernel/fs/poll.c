@@ -0,0 +1,187 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/kevent.h>
+#include <ardix/malloc.h>
+#include <ardix/sched.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
+
+#include <config.h>
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <toolchain.h>
+
+struct poll_slot {
+	struct file *file;
+	struct pollfd pfd;
+};
+
+struct poll_kevent_extra {
+	struct task *task;
+	struct poll_slot *slots;
+	nfds_t nfds;
+	/* set by the listener if it woke up the task */
+	bool woken;
+};
+
+static enum device_kevent_flags poll_events_to_kevent_flags(short events)
+{
+	enum device_kevent_flags flags = DEVICE_KEVENT_ERR;
+
+	if (events & POLLIN)
+		flags |= DEVICE_KEVENT_RX;
+	if (events & POLLOUT)
+		flags |= DEVICE_KEVENT_TX;
+
+	return flags;
+}
+
+static int poll_kevent_listener(struct kevent *event, void *_extra)
+{
+	struct poll_kevent_extra *extra = _extra;
+	struct device *device = kevent_to_device(event);
+	struct device_kevent *device_kevent = kevent_to_device_kevent(event);
+
+	for (nfds_t i = 0; i < extra->nfds; i++) {
+		struct poll_slot *slot = &extra->slots[i];
+		if (slot->file == NULL || slot->file->device != device)
+			continue;
+
+		if (device_kevent->flags & poll_events_to_kevent_flags(slot->pfd.events)) {
+			extra->woken = true;
+			extra->task->state = TASK_QUEUE;
+			/*
+			 * don't return KEVENT_CB_STOP here because other tasks
+			 * might be waiting for the same device as well
+			 */
+			return KEVENT_CB_LISTENER_DEL;
+		}
+	}
+
+	return KEVENT_CB_NONE;
+}
+
+/* returns the amount of slots with nonzero revents */
+static int poll_scan(struct poll_slot *slots, nfds_t nfds)
+{
+	int count = 0;
+
+	for (nfds_t i = 0; i < nfds; i++) {
+		struct poll_slot *slot = &slots[i];
+
+		if (slot->pfd.fd < 0) {
+			slot->pfd.revents = 0;
+		} else if (slot->file == NULL) {
+			slot->pfd.revents = POLLNVAL;
+		} else {
+			struct device *device = slot->file->device;
+			/* devices w/out poll callback never block */
+			int state = POLLIN | POLLOUT;
+
+			if (device->poll != NULL)
+				state = device->poll(device, slot->file->pos);
+			/* POLLERR and POLLHUP are always reported, as per POSIX */
+			slot->pfd.revents = (short)(state & (slot->pfd.events | POLLERR | POLLHUP));
+		}
+
+		if (slot->pfd.revents != 0)
+			count++;
+	}
+
+	return count;
+}
+
+long sys_poll(__user struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	long ret;
+	unsigned long int timeout_ticks = 0;
+	unsigned long int start = tick;
+
+	if (nfds > CONFIG_NFILE)
+		return -EINVAL;
+	if (nfds == 0 && timeout < 0)
+		return -EINVAL;
+
+	struct poll_slot *slots = NULL;
+	if (nfds != 0) {
+		slots = kmalloc(nfds * sizeof(*slots));
+		if (slots == NULL)
+			return -ENOMEM;
+	}
+
+	for (nfds_t i = 0; i < nfds; i++) {
+		copy_from_user(&slots[i].pfd, &fds[i], sizeof(slots[i].pfd));
+		if (slots[i].pfd.fd >= 0)
+			slots[i].file = file_get(slots[i].pfd.fd);
+		else
+			slots[i].file = NULL;
+	}
+
+	if (timeout > 0) {
+		timeout_ticks = ms_to_ticks((unsigned long int)timeout);
+		/* ms_to_ticks() rounds towards zero, but we must not return early */
+		if (timeout_ticks == 0)
+			timeout_ticks = 1;
+	}
+
+	while (1) {
+		ret = poll_scan(slots, nfds);
+		if (ret != 0 || timeout == 0)
+			break;
+
+		unsigned long int elapsed = tick - start;
+		if (timeout > 0 && elapsed >= timeout_ticks)
+			break;
+
+		struct poll_kevent_extra extra = {
+			.task = current,
+			.slots = slots,
+			.nfds = nfds,
+			.woken = false,
+		};
+		struct kevent_listener *listener = kevent_listener_add(KEVENT_DEVICE,
+								       poll_kevent_listener,
+								       &extra);
+		if (listener == NULL) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		if (timeout > 0) {
+			current->sleep = timeout_ticks - elapsed;
+			yield(TASK_SLEEP);
+		} else {
+			yield(TASK_IOWAIT);
+		}
+
+		/* the listener removes itself if it woke us up */
+		if (!extra.woken)
+			kevent_listener_del(listener);
+	}
+
+	for (nfds_t i = 0; i < nfds; i++) {
+		if (ret >= 0)
+			copy_to_user(&fds[i].revents, &slots[i].pfd.revents, sizeof(fds[i].revents));
+		if (slots[i].file != NULL)
+			file_put(slots[i].file);
+	}
+
+	kfree(slots);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -1,32 +1,96 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
+#include <ardix/device.h>
 #include <ardix/file.h>
-#include <ardix/malloc.h>
 #include <ardix/syscall.h>
 #include <ardix/userspace.h>
 
+#include <config.h>
 #include <errno.h>
+#include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <toolchain.h>
 
+/* for devices that can't write to user memory directly (DEVICE_BOUNCE_IO) */
+static long read_bounce(__user void *buf, struct file *f, size_t len)
+{
+	uint8_t bounce[CONFIG_IO_BOUNCE_BUFSZ];
+	long ret = 0;
+
+	while ((size_t)ret < len) {
+		size_t chunk = len - (size_t)ret;
+		if (chunk > sizeof(bounce))
+			chunk = sizeof(bounce);
+
+		ssize_t tmp = file_read(bounce, f, chunk);
+		if (tmp < 0) {
+			/* report the error only if nothing was read before */
+			if (ret == 0)
+				ret = tmp;
+			break;
+		}
+
+		copy_to_user(buf + ret, bounce, (size_t)tmp);
+		ret += tmp;
+
+		if ((size_t)tmp != chunk)
+			break;
+	}
+
+	return ret;
+}
+
 long sys_read(int fd, __user void *buf, size_t len)
 {
 	long ret;
-	void *copy;
+
+	if (!access_ok(buf, len, true))
+		return -EFAULT;
 
 	struct file *f = file_get(fd);
 	if (f == NULL)
 		return -EBADF;
 
-	copy = kmalloc(len);
-	if (copy == NULL)
-		return -ENOMEM;
+	if (f->device->flags & DEVICE_BOUNCE_IO)
+		ret = read_bounce(buf, f, len);
+	else
+		ret = file_read(buf, f, len);
+
+	file_put(f);
+	return ret;
+}
+
+long sys_readv(int fd, __user const struct iovec *iov, int iovcnt)
+{
+	long ret;
+	struct iovec kiov[IOV_MAX];
+
+	ret = copy_iov_from_user(kiov, iov, iovcnt, true);
+	if (ret < 0)
+		return ret;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
 
-	ret = file_read(copy, f, len);
-	if (ret >= 0)
-		ret = copy_to_user(buf, copy, ret);
+	if (f->device->flags & DEVICE_BOUNCE_IO) {
+		ret = 0;
+		for (int i = 0; i < iovcnt; i++) {
+			long tmp = read_bounce(kiov[i].iov_base, f, kiov[i].iov_len);
+			if (tmp < 0) {
+				if (ret == 0)
+					ret = tmp;
+				break;
+			}
+			ret += tmp;
+			if ((size_t)tmp != kiov[i].iov_len)
+				break;
+		}
+	} else {
+		ret = file_readv(f, kiov, iovcnt);
+	}
 
-	kfree(copy);
 	file_put(f);
 	return ret;
 }
@@ -0,0 +1,51 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <rxring.h>
+#include <stddef.h>
+#include <toolchain.h>
+
+long sys_rxring_map(int fd, __user struct rxring **ring)
+{
+	long ret;
+	struct rxring *kring;
+
+	if (!access_ok(ring, sizeof(*ring), true))
+		return -EFAULT;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if ((f->flags & O_ACCMODE) == O_WRONLY)
+		ret = -EBADF;
+	else if (f->device->map_rx == NULL)
+		ret = -ENODEV;
+	else
+		ret = f->device->map_rx(f->device, f, &kring);
+
+	if (ret == 0)
+		copy_to_user(ring, &kring, sizeof(kring));
+
+	file_put(f);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
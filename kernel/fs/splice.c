@@ -0,0 +1,143 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/dma.h>
+#include <ardix/file.h>
+#include <ardix/malloc.h>
+#include <ardix/syscall.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * If the output device can transmit from DMA buffers, like the serial console
+ * does, the data is read into one of its buffers and handed over as it is.
+ * Everything else gets a regular write from a bounce buffer, which is
+ * allocated once per call rather than taking a DMA buffer from the atomic
+ * heap for every chunk.
+ *
+ * Once a chunk was read from the input, there is no way to put it back.  If
+ * writing it fails, it is lost, and the return value only counts the bytes
+ * that made it to the output.
+ */
+
+/* file_write_dma() always blocks, so O_NONBLOCK has to be checked up front */
+static bool splice_would_block(struct file *out)
+{
+	struct device *device = out->device;
+
+	if (!(out->flags & O_NONBLOCK) || device->poll == NULL)
+		return false;
+
+	return (device->poll(device, out->pos) & POLLOUT) == 0;
+}
+
+static ssize_t splice_chunk_dma(struct file *in, struct file *out, size_t len)
+{
+	struct dmabuf *buf = dmabuf_create(out->device, len);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	ssize_t ret = file_read(buf->data, in, len);
+	if (ret > 0) {
+		buf->len = (size_t)ret;
+		ret = file_write_dma(out, buf);
+	}
+
+	dmabuf_put(buf);
+	return ret;
+}
+
+static ssize_t splice_chunk(struct file *in, struct file *out, void *bounce, size_t len)
+{
+	ssize_t ret = file_read(bounce, in, len);
+	if (ret > 0)
+		ret = file_write(out, bounce, (size_t)ret);
+
+	return ret;
+}
+
+long sys_splice(int fd_in, int fd_out, size_t len)
+{
+	long ret = 0;
+	uint8_t *bounce = NULL;
+
+	struct file *in = file_get(fd_in);
+	if (in == NULL)
+		return -EBADF;
+
+	struct file *out = file_get(fd_out);
+	if (out == NULL) {
+		ret = -EBADF;
+		goto out_put_in;
+	}
+
+	if ((in->flags & O_ACCMODE) == O_WRONLY || (out->flags & O_ACCMODE) == O_RDONLY) {
+		ret = -EBADF;
+		goto out_put_out;
+	}
+
+	if (out->device->write_dma == NULL) {
+		bounce = kmalloc(CONFIG_SPLICE_BUFSZ);
+		if (bounce == NULL) {
+			ret = -ENOMEM;
+			goto out_put_out;
+		}
+	}
+
+	while ((size_t)ret < len) {
+		size_t chunk = len - (size_t)ret;
+		if (chunk > CONFIG_SPLICE_BUFSZ)
+			chunk = CONFIG_SPLICE_BUFSZ;
+
+		if (splice_would_block(out)) {
+			if (ret == 0)
+				ret = -EAGAIN;
+			break;
+		}
+
+		ssize_t tmp;
+		if (bounce == NULL)
+			tmp = splice_chunk_dma(in, out, chunk);
+		else
+			tmp = splice_chunk(in, out, bounce, chunk);
+
+		if (tmp < 0) {
+			/* report the error only if nothing was moved before */
+			if (ret == 0)
+				ret = tmp;
+			break;
+		}
+
+		ret += tmp;
+
+		/* EOF, empty pipe, or short write */
+		if ((size_t)tmp != chunk)
+			break;
+	}
+
+	kfree(bounce);
+out_put_out:
+	file_put(out);
+out_put_in:
+	file_put(in);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,105 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <termios.h>
+#include <toolchain.h>
+
+long sys_tcgetattr(int fd, __user struct termios *termios)
+{
+	long ret;
+	struct termios copy;
+
+	if (!access_ok(termios, sizeof(*termios), true))
+		return -EFAULT;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if (f->device->tcattr == NULL)
+		ret = -ENOTTY;
+	else
+		ret = f->device->tcattr(f->device, &copy, false);
+
+	if (ret == 0)
+		copy_to_user(termios, &copy, sizeof(copy));
+
+	file_put(f);
+	return ret;
+}
+
+long sys_tcsetattr(int fd, int optional_actions, __user const struct termios *termios)
+{
+	long ret;
+	struct termios copy;
+
+	if (optional_actions != TCSANOW && optional_actions != TCSADRAIN
+	    && optional_actions != TCSAFLUSH)
+		return -EINVAL;
+	if (!access_ok(termios, sizeof(*termios), false))
+		return -EFAULT;
+
+	copy_from_user(&copy, termios, sizeof(copy));
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if (f->device->tcattr == NULL) {
+		ret = -ENOTTY;
+	} else if (optional_actions == TCSAFLUSH && f->device->tcflush == NULL) {
+		/* don't claim to have discarded anything if we can't */
+		ret = -EINVAL;
+	} else {
+		ret = f->device->tcattr(f->device, &copy, true);
+		if (ret == 0 && optional_actions == TCSAFLUSH)
+			ret = f->device->tcflush(f->device);
+	}
+
+	file_put(f);
+	return ret;
+}
+
+long sys_tcgetstats(int fd, __user struct tcstats *stats)
+{
+	long ret;
+	struct tcstats copy;
+
+	if (!access_ok(stats, sizeof(*stats), true))
+		return -EFAULT;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if (f->device->tcstats == NULL)
+		ret = -ENOTTY;
+	else
+		ret = f->device->tcstats(f->device, &copy);
+
+	if (ret == 0)
+		copy_to_user(stats, &copy, sizeof(copy));
+
+	file_put(f);
+	return ret;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,449 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file tmpfs.c
+ * @brief Simple in-memory filesystem.
+ *
+ * Every node (file or directory) embeds a `struct device`, so opened files
+ * go through the regular file layer and get position handling for free.
+ * The refcount of each node's device kent holds a reference to its parent
+ * directory, and the tree itself holds the initial reference of every node.
+ *
+ * File contents are stored in fixed-size extents of `CONFIG_TMPFS_EXTENT_SIZE`
+ * bytes, which are allocated on demand and zeroed.  Files can only shrink by
+ * being truncated to zero length (`O_TRUNC`), which releases all extents, so
+ * anything past the end of a file is always zero and extending a file with a
+ * write beyond its end never exposes stale data.
+ */
+
+#include <ardix/atomic.h>
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/list.h>
+#include <ardix/malloc.h>
+#include <ardix/mutex.h>
+#include <ardix/tmpfs.h>
+#include <ardix/util.h>
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum tmpfs_node_type {
+	TMPFS_NODE_DIR,
+	TMPFS_NODE_FILE,
+};
+
+struct tmpfs_node {
+	struct device device;
+	enum tmpfs_node_type type;
+	struct list_head link; /* -> tmpfs_node::children of the parent */
+	/* set if somebody got -EBUSY and needs a kevent on unlock */
+	bool contended;
+	char name[CONFIG_TMPFS_NAMELEN + 1];
+
+	/* directories */
+	struct list_head children;
+
+	/* regular files */
+	size_t size;
+	unsigned int extent_count;
+	uint8_t **extents;
+};
+
+#define device_to_tmpfs_node(ptr) container_of(ptr, struct tmpfs_node, device)
+
+static struct tmpfs_node tmpfs_root;
+/* protects the tree structure (not the file contents) */
+static MUTEX(tmpfs_lock);
+
+static void tmpfs_free_extents(struct tmpfs_node *node)
+{
+	for (unsigned int i = 0; i < node->extent_count; i++)
+		kfree(node->extents[i]);
+	kfree(node->extents);
+
+	node->extents = NULL;
+	node->extent_count = 0;
+	node->size = 0;
+}
+
+static void tmpfs_node_destroy(struct kent *kent)
+{
+	struct tmpfs_node *node = device_to_tmpfs_node(kent_to_device(kent));
+
+	if (node->type == TMPFS_NODE_FILE)
+		tmpfs_free_extents(node);
+	if (node != &tmpfs_root)
+		kfree(node);
+}
+
+/*
+ * Device callbacks may be invoked from scheduler context (through the I/O
+ * ring), so they must not sleep on the node lock.  Instead, they return
+ * -EBUSY like any other device, and the current lock holder dispatches a
+ * kevent when it is done so the waiters retry.
+ */
+static int tmpfs_node_trylock(struct tmpfs_node *node)
+{
+	if (mutex_trylock(&node->device.lock) != 0) {
+		node->contended = true;
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static void tmpfs_node_unlock(struct tmpfs_node *node)
+{
+	bool contended = node->contended;
+
+	node->contended = false;
+	mutex_unlock(&node->device.lock);
+
+	if (contended) {
+		device_kevent_create_and_dispatch(&node->device,
+						  DEVICE_KEVENT_RX | DEVICE_KEVENT_TX);
+	}
+}
+
+/* make sure the file has enough extents to hold `size` bytes (node is locked) */
+static int tmpfs_reserve(struct tmpfs_node *node, size_t size)
+{
+	unsigned int needed = (size + CONFIG_TMPFS_EXTENT_SIZE - 1) / CONFIG_TMPFS_EXTENT_SIZE;
+
+	if (needed <= node->extent_count)
+		return 0;
+
+	/* the generic heap can sleep, which we must not do in scheduler context */
+	if (is_atomic())
+		return -EBUSY;
+
+	uint8_t **extents = kmalloc(needed * sizeof(*extents));
+	if (extents == NULL)
+		return -ENOSPC;
+
+	unsigned int count = node->extent_count;
+	if (count != 0)
+		memcpy(extents, node->extents, count * sizeof(*extents));
+
+	while (count < needed) {
+		extents[count] = kmalloc(CONFIG_TMPFS_EXTENT_SIZE);
+		if (extents[count] == NULL)
+			break;
+		memset(extents[count], 0, CONFIG_TMPFS_EXTENT_SIZE);
+		count++;
+	}
+
+	kfree(node->extents);
+	node->extents = extents;
+	node->extent_count = count;
+
+	/* partial success is still success, the caller will write less */
+	return count > 0 ? 0 : -ENOSPC;
+}
+
+static ssize_t tmpfs_read(void *dest, struct device *dev, size_t len, off_t offset)
+{
+	struct tmpfs_node *node = device_to_tmpfs_node(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret = 0;
+
+	if (offset < 0)
+		return -EINVAL;
+
+	ret = tmpfs_node_trylock(node);
+	if (ret != 0)
+		return ret;
+
+	if (pos >= node->size) {
+		tmpfs_node_unlock(node);
+		return 0; /* EOF */
+	}
+	if (len > node->size - pos)
+		len = node->size - pos;
+
+	while ((size_t)ret < len) {
+		size_t extent_pos = pos % CONFIG_TMPFS_EXTENT_SIZE;
+		size_t chunk = CONFIG_TMPFS_EXTENT_SIZE - extent_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		memcpy(dest + ret, &node->extents[pos / CONFIG_TMPFS_EXTENT_SIZE][extent_pos], chunk);
+		ret += (ssize_t)chunk;
+		pos += chunk;
+	}
+
+	tmpfs_node_unlock(node);
+	return ret;
+}
+
+static ssize_t tmpfs_write(struct device *dev, const void *src, size_t len, off_t offset)
+{
+	struct tmpfs_node *node = device_to_tmpfs_node(dev);
+	size_t pos = (size_t)offset;
+	ssize_t ret;
+
+	if (offset < 0)
+		return -EINVAL;
+	if (len > SIZE_MAX - pos)
+		return -EFBIG;
+
+	ret = tmpfs_node_trylock(node);
+	if (ret != 0)
+		return ret;
+
+	ret = tmpfs_reserve(node, pos + len);
+	if (ret != 0) {
+		tmpfs_node_unlock(node);
+		return ret;
+	}
+
+	/* tmpfs_reserve() might have been unable to allocate everything */
+	size_t capacity = node->extent_count * CONFIG_TMPFS_EXTENT_SIZE;
+	if (pos >= capacity) {
+		tmpfs_node_unlock(node);
+		return -ENOSPC;
+	}
+	if (len > capacity - pos)
+		len = capacity - pos;
+
+	while ((size_t)ret < len) {
+		size_t extent_pos = pos % CONFIG_TMPFS_EXTENT_SIZE;
+		size_t chunk = CONFIG_TMPFS_EXTENT_SIZE - extent_pos;
+		if (chunk > len - (size_t)ret)
+			chunk = len - (size_t)ret;
+
+		memcpy(&node->extents[pos / CONFIG_TMPFS_EXTENT_SIZE][extent_pos], src + ret, chunk);
+		ret += (ssize_t)chunk;
+		pos += chunk;
+	}
+
+	if (pos > node->size)
+		node->size = pos;
+
+	tmpfs_node_unlock(node);
+	return ret;
+}
+
+static ssize_t tmpfs_size(struct device *dev)
+{
+	struct tmpfs_node *node = device_to_tmpfs_node(dev);
+	return (ssize_t)node->size;
+}
+
+static int tmpfs_node_init(struct tmpfs_node *node, struct tmpfs_node *parent,
+			   const char *name, enum tmpfs_node_type type)
+{
+	node->device.kent.parent = parent == NULL ? NULL : &parent->device.kent;
+	node->device.kent.destroy = tmpfs_node_destroy;
+
+	node->type = type;
+	node->contended = false;
+	strcpy(node->name, name);
+
+	list_init(&node->children);
+	node->size = 0;
+	node->extent_count = 0;
+	node->extents = NULL;
+
+	/* device_init() uses the devices kent as the parent if it is NULL */
+	int err = device_init(&node->device);
+	if (err != 0)
+		return err;
+
+	/* directories have no data, so they don't get any callbacks */
+	if (type == TMPFS_NODE_FILE) {
+		node->device.read = tmpfs_read;
+		node->device.write = tmpfs_write;
+		node->device.size = tmpfs_size;
+	}
+
+	if (parent != NULL)
+		list_insert(&parent->children, &node->link);
+
+	return 0;
+}
+
+/* create a new node (tmpfs_lock is held) */
+static struct tmpfs_node *tmpfs_node_create(struct tmpfs_node *parent, const char *name,
+					    enum tmpfs_node_type type, int *err)
+{
+	struct tmpfs_node *node = kmalloc(sizeof(*node));
+	if (node == NULL) {
+		*err = -ENOSPC;
+		return NULL;
+	}
+
+	*err = tmpfs_node_init(node, parent, name, type);
+	if (*err != 0) {
+		kfree(node);
+		return NULL;
+	}
+
+	return node;
+}
+
+/* look up a direct child of a directory (tmpfs_lock is held) */
+static struct tmpfs_node *tmpfs_find(struct tmpfs_node *dir, const char *name)
+{
+	struct tmpfs_node *cursor;
+
+	list_for_each_entry(&dir->children, cursor, link) {
+		if (strcmp(cursor->name, name) == 0)
+			return cursor;
+	}
+
+	return NULL;
+}
+
+/*
+ * Walk `path` up to its last component and return the directory containing
+ * it.  `*name` is set to the last component, which is NUL terminated in place,
+ * or to NULL if the path refers to the root directory.  tmpfs_lock is held.
+ */
+static struct tmpfs_node *tmpfs_walk(char *path, char **name, int *err)
+{
+	struct tmpfs_node *dir = &tmpfs_root;
+	char *pos = path;
+
+	if (*pos != '/') {
+		/* there is no working directory yet */
+		*err = -ENOENT;
+		return NULL;
+	}
+
+	while (*pos == '/')
+		pos++;
+	if (*pos == '\0') {
+		*name = NULL;
+		return dir;
+	}
+
+	while (1) {
+		char *component = pos;
+		while (*pos != '/' && *pos != '\0')
+			pos++;
+		char *end = pos;
+		while (*pos == '/')
+			pos++;
+		*end = '\0';
+
+		if (end - component > CONFIG_TMPFS_NAMELEN) {
+			*err = -ENAMETOOLONG;
+			return NULL;
+		}
+
+		if (*pos == '\0') {
+			*name = component;
+			return dir;
+		}
+
+		dir = tmpfs_find(dir, component);
+		if (dir == NULL) {
+			*err = -ENOENT;
+			return NULL;
+		}
+		if (dir->type != TMPFS_NODE_DIR) {
+			*err = -ENOTDIR;
+			return NULL;
+		}
+	}
+}
+
+int tmpfs_init(void)
+{
+	return tmpfs_node_init(&tmpfs_root, NULL, "", TMPFS_NODE_DIR);
+}
+
+struct file *tmpfs_open(char *path, int flags, int *err)
+{
+	struct file *file = NULL;
+	struct tmpfs_node *node;
+	char *name;
+
+	mutex_lock(&tmpfs_lock);
+
+	struct tmpfs_node *dir = tmpfs_walk(path, &name, err);
+	if (dir == NULL)
+		goto out;
+	if (name == NULL) {
+		*err = -EISDIR;
+		goto out;
+	}
+
+	node = tmpfs_find(dir, name);
+	if (node != NULL) {
+		if ((flags & O_CREAT) && (flags & O_EXCL)) {
+			*err = -EEXIST;
+			goto out;
+		}
+		if (node->type == TMPFS_NODE_DIR) {
+			*err = -EISDIR;
+			goto out;
+		}
+	} else {
+		if (!(flags & O_CREAT)) {
+			*err = -ENOENT;
+			goto out;
+		}
+		node = tmpfs_node_create(dir, name, TMPFS_NODE_FILE, err);
+		if (node == NULL)
+			goto out;
+	}
+
+	if ((flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY) {
+		/* we are in syscall context, so we can just wait for the lock */
+		mutex_lock(&node->device.lock);
+		tmpfs_free_extents(node);
+		tmpfs_node_unlock(node);
+	}
+
+	file = file_create(&node->device, FILE_TYPE_REGULAR, err);
+	if (file != NULL)
+		file->flags = flags & (O_ACCMODE | O_NONBLOCK | O_APPEND);
+
+out:
+	mutex_unlock(&tmpfs_lock);
+	return file;
+}
+
+int tmpfs_mkdir(char *path)
+{
+	int err = 0;
+	char *name;
+
+	mutex_lock(&tmpfs_lock);
+
+	struct tmpfs_node *dir = tmpfs_walk(path, &name, &err);
+	if (dir == NULL)
+		goto out;
+
+	if (name == NULL || tmpfs_find(dir, name) != NULL) {
+		err = -EEXIST;
+		goto out;
+	}
+
+	tmpfs_node_create(dir, name, TMPFS_NODE_DIR, &err);
+
+out:
+	mutex_unlock(&tmpfs_lock);
+	return err;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
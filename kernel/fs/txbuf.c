@@ -0,0 +1,118 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/dma.h>
+#include <ardix/file.h>
+#include <ardix/sched.h>
+#include <ardix/syscall.h>
+#include <ardix/task.h>
+#include <ardix/txbuf.h>
+#include <ardix/userspace.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <toolchain.h>
+
+/* US_TCR is 16 bits wide, so no device can send more than that at once */
+#define TXBUF_MAX_LEN 0xffff
+
+long sys_txbuf_reserve(int fd, size_t len, __user void **data)
+{
+	long ret;
+	struct dmabuf *buf;
+
+	if (!access_ok(data, sizeof(*data), true))
+		return -EFAULT;
+	if (len == 0)
+		return -EINVAL;
+	if (current->txbuf != NULL)
+		return -EBUSY;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if ((f->flags & O_ACCMODE) == O_RDONLY) {
+		ret = -EBADF;
+		goto err_put_file;
+	}
+	/* without write_dma, the commit would have to copy the data anyway */
+	if (f->device->write_dma == NULL) {
+		ret = -EOPNOTSUPP;
+		goto err_put_file;
+	}
+	/* anything larger than the pool's buffers would drain the atomic heap */
+	size_t max_len = TXBUF_MAX_LEN;
+	if (f->device->dmapool != NULL)
+		max_len = f->device->dmapool->bufsz;
+	if (len > max_len) {
+		ret = -E2BIG;
+		goto err_put_file;
+	}
+
+	buf = dmabuf_create(f->device, len);
+	if (buf == NULL) {
+		ret = -ENOMEM;
+		goto err_put_file;
+	}
+
+	/* the reservation keeps the file reference until txbuf_commit() */
+	current->txbuf = buf;
+	current->txbuf_file = f;
+
+	void *kdata = &buf->data[0];
+	copy_to_user(data, &kdata, sizeof(kdata));
+	return 0;
+
+err_put_file:
+	file_put(f);
+	return ret;
+}
+
+long sys_txbuf_commit(size_t len)
+{
+	long ret = 0;
+	struct dmabuf *buf = current->txbuf;
+	struct file *f = current->txbuf_file;
+
+	if (buf == NULL)
+		return -EINVAL;
+	if (len > buf->len)
+		return -EINVAL;
+
+	current->txbuf = NULL;
+	current->txbuf_file = NULL;
+
+	if (len != 0) {
+		buf->len = len;
+		ret = file_write_dma(f, buf);
+	}
+
+	dmabuf_put(buf);
+	file_put(f);
+	return ret;
+}
+
+void txbuf_release(struct task *task)
+{
+	if (task->txbuf != NULL) {
+		dmabuf_put(task->txbuf);
+		file_put(task->txbuf_file);
+		task->txbuf = NULL;
+		task->txbuf_file = NULL;
+	}
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -1,33 +1,96 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
+#include <ardix/device.h>
 #include <ardix/file.h>
-#include <ardix/malloc.h>
 #include <ardix/syscall.h>
 #include <ardix/userspace.h>
 
+#include <config.h>
 #include <errno.h>
+#include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <toolchain.h>
 
-long sys_write(int fd, __user const void *buf, size_t len)
+/* for devices that can't read from user memory directly (DEVICE_BOUNCE_IO) */
+static long write_bounce(struct file *f, __user const void *buf, size_t len)
 {
+	uint8_t bounce[CONFIG_IO_BOUNCE_BUFSZ];
 	long ret = 0;
-	void *copy;
+
+	while ((size_t)ret < len) {
+		size_t chunk = len - (size_t)ret;
+		if (chunk > sizeof(bounce))
+			chunk = sizeof(bounce);
+
+		copy_from_user(bounce, buf + ret, chunk);
+		ssize_t tmp = file_write(f, bounce, chunk);
+		if (tmp < 0) {
+			/* report the error only if nothing was written before */
+			if (ret == 0)
+				ret = tmp;
+			break;
+		}
+
+		ret += tmp;
+
+		if ((size_t)tmp != chunk)
+			break;
+	}
+
+	return ret;
+}
+
+long sys_write(int fd, __user const void *buf, size_t len)
+{
+	long ret;
+
+	if (!access_ok(buf, len, false))
+		return -EFAULT;
 
 	struct file *f = file_get(fd);
 	if (f == NULL)
 		return -EBADF;
 
-	copy = kmalloc(len);
-	if (copy == NULL) {
-		file_put(f);
-		return -ENOMEM;
-	}
+	if (f->device->flags & DEVICE_BOUNCE_IO)
+		ret = write_bounce(f, buf, len);
+	else
+		ret = file_write(f, buf, len);
+
+	file_put(f);
+	return ret;
+}
+
+long sys_writev(int fd, __user const struct iovec *iov, int iovcnt)
+{
+	long ret;
+	struct iovec kiov[IOV_MAX];
 
-	len = copy_from_user(copy, buf, len);
-	ret = file_write(f, copy, len);
+	ret = copy_iov_from_user(kiov, iov, iovcnt, false);
+	if (ret < 0)
+		return ret;
+
+	struct file *f = file_get(fd);
+	if (f == NULL)
+		return -EBADF;
+
+	if (f->device->flags & DEVICE_BOUNCE_IO) {
+		ret = 0;
+		for (int i = 0; i < iovcnt; i++) {
+			long tmp = write_bounce(f, kiov[i].iov_base, kiov[i].iov_len);
+			if (tmp < 0) {
+				if (ret == 0)
+					ret = tmp;
+				break;
+			}
+			ret += tmp;
+			if ((size_t)tmp != kiov[i].iov_len)
+				break;
+		}
+	} else {
+		ret = file_writev(f, kiov, iovcnt);
+	}
 
-	kfree(copy);
 	file_put(f);
 	return ret;
 }
@@ -2,9 +2,11 @@
 
 #include <ardix/file.h>
 #include <ardix/io.h>
+#include <ardix/sched.h>
 #include <ardix/serial.h>
 
 #include <config.h>
+#include <fcntl.h>
 
 struct file *kstdout;
 struct file *kstdin;
@@ -24,9 +26,25 @@ int io_init(void)
 	kstdout = file_create(&serial_default_device->device, FILE_TYPE_PIPE, &ret);
 	if (ret != 0)
 		goto err_kstdout_create;
+	kstdout->flags = O_WRONLY;
 
+	/*
+	 * These become fd 0 and 1 of the kernel task, which are inherited by
+	 * every task created through exec().
+	 */
+	ret = fd_install(kstdin);
+	if (ret < 0)
+		goto err_fd_install;
+	ret = fd_install(kstdout);
+	if (ret < 0)
+		goto err_fd_install;
+
+	ret = 0;
 	goto out;
 
+err_fd_install:
+	fdtab_release(&current->fdtab);
+	file_put(kstdout);
 err_kstdout_create:
 	file_put(kstdin);
 err_kstdin_create:
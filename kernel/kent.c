@@ -42,6 +42,11 @@ void kent_get(struct kent *kent)
 	atom_get(&kent->refcount);
 }
 
+bool kent_tryget(struct kent *kent)
+{
+	return atom_get_unless_zero(&kent->refcount) != 0;
+}
+
 void kent_put(struct kent *kent)
 {
 	struct kent *parent = kent->parent;
@@ -7,23 +7,47 @@
  * ticks
  */
 
+#include <arch-generic/sched.h>
+
 #include <ardix/atom.h>
 #include <ardix/malloc.h>
 #include <ardix/mutex.h>
 #include <ardix/kent.h>
 #include <ardix/kevent.h>
 #include <ardix/list.h>
+#include <ardix/syscall.h>
+#include <ardix/userspace.h>
 
 #include <errno.h>
 #include <stddef.h>
+#include <string.h>
 
 /* event listeners indexed by event type */
 static struct list_head kev_listeners[KEVENT_KIND_COUNT];
 static MUTEX(kev_listeners_lock);
+/* amount of entries in each of the kev_listeners lists */
+static unsigned int kev_listener_count[KEVENT_KIND_COUNT];
+
+/*
+ * Statistics counters.  These are only ever modified from irq, syscall or
+ * scheduler context, all of which run with irqs disabled, so we don't need
+ * any locking here.
+ */
+struct kevent_queue_stats {
+	unsigned long int dispatched;
+	unsigned long int processed;
+	unsigned long int dropped;
+	unsigned long int listener_calls;
+	unsigned long int latency_max;
+	/* sum of latencies in microseconds, and how many values it contains */
+	unsigned long int latency_total;
+	unsigned long int latency_samples;
+};
 
 struct kevent_queue {
 	struct list_head list;	/* -> kevent::link */
 	struct mutex lock;
+	struct kevent_queue_stats stats;
 };
 
 /* event queues indexed by event type */
@@ -44,6 +68,7 @@ void kevents_init(void)
 		list_init(&kev_listeners[i]);
 		list_init(&kev_queues[i].list);
 		mutex_init(&kev_queues[i].lock);
+		memset(&kev_queues[i].stats, 0, sizeof(kev_queues[i].stats));
 	}
 }
 
@@ -60,12 +85,31 @@ static inline void process_single_queue(struct kevent_queue *queue, struct list_
 	if (mutex_trylock(&queue->lock) == 0) {
 		list_for_each_entry_safe(&queue->list, event, tmp_event, link) {
 			struct kevent_listener *listener, *tmp_listener;
+			unsigned long int latency = arch_timestamp_us() - event->timestamp;
+
+			queue->stats.processed++;
+			if (queue->stats.latency_total + latency < queue->stats.latency_total) {
+				/*
+				 * This would overflow, so we halve both the total and
+				 * the sample count which preserves the average value.
+				 * We can't use 64-bit integers because that would
+				 * require libgcc for the division.
+				 */
+				queue->stats.latency_total /= 2;
+				queue->stats.latency_samples /= 2;
+			}
+			queue->stats.latency_total += latency;
+			queue->stats.latency_samples++;
+			if (latency > queue->stats.latency_max)
+				queue->stats.latency_max = latency;
 
 			list_for_each_entry_safe(listeners, listener, tmp_listener, link) {
 				int cb_ret = listener->cb(event, listener->extra);
+				queue->stats.listener_calls++;
 
 				if (cb_ret & KEVENT_CB_LISTENER_DEL) {
 					list_delete(&listener->link);
+					kev_listener_count[event->kind]--;
 					kfree(listener);
 				}
 
@@ -106,6 +150,9 @@ void kevent_dispatch(struct kevent *event)
 {
 	struct kevent_queue *queue = &kev_queues[event->kind];
 
+	event->timestamp = arch_timestamp_us();
+	queue->stats.dispatched++;
+
 	if (mutex_trylock(&queue->lock) == 0) {
 		list_insert(&queue->list, &event->link);
 		mutex_unlock(&queue->lock);
@@ -127,8 +174,18 @@ void kevent_dispatch(struct kevent *event)
 			 * have either the main queue or the temporary cache available to us, and
 			 * if not, we forgot to release a lock during yet another sleep deprived
 			 * episode of late night coding.  Time to make us pay for what we did then.
+			 * At least keep track of how often we screwed up so it shows up in the
+			 * statistics, and don't leak the event.
+			 *
+			 * Dropping it here is fine in irq context.  Events dispatched
+			 * from irqs come from atomic_kmalloc(), whose kfree() path
+			 * never sleeps.  The event holds a reference to its parent,
+			 * on top of the one the dispatcher holds while the parent is
+			 * emitting events, so it can't be the last reference, and
+			 * the parent's destroy callback isn't called from here.
 			 */
-
+			queue->stats.dropped++;
+			kevent_put(event);
 		}
 	}
 }
@@ -142,9 +199,11 @@ struct kevent_listener *kevent_listener_add(enum kevent_kind kind,
 	if (listener != NULL) {
 		listener->cb = cb;
 		listener->extra = extra;
+		listener->kind = kind;
 
 		mutex_lock(&kev_listeners_lock);
 		list_insert(&kev_listeners[kind], &listener->link);
+		kev_listener_count[kind]++;
 		mutex_unlock(&kev_listeners_lock);
 	}
 
@@ -155,11 +214,41 @@ void kevent_listener_del(struct kevent_listener *listener)
 {
 	mutex_lock(&kev_listeners_lock);
 	list_delete(&listener->link);
+	kev_listener_count[listener->kind]--;
 	mutex_unlock(&kev_listeners_lock);
 
 	kfree(listener);
 }
 
+bool kevent_has_listeners(enum kevent_kind kind)
+{
+	return kev_listener_count[kind] != 0;
+}
+
+long sys_kevent_stats(enum kevent_kind kind, __user struct kevent_stats *stats)
+{
+	if ((unsigned int)kind >= KEVENT_KIND_COUNT)
+		return -EINVAL;
+	if (!access_ok(stats, sizeof(*stats), true))
+		return -EFAULT;
+
+	struct kevent_queue_stats *queue_stats = &kev_queues[kind].stats;
+	struct kevent_stats copy = {
+		.dispatched = queue_stats->dispatched,
+		.processed = queue_stats->processed,
+		.dropped = queue_stats->dropped,
+		.listener_calls = queue_stats->listener_calls,
+		.latency_max = queue_stats->latency_max,
+		.latency_avg = 0,
+	};
+	copy.in_flight = copy.dispatched - copy.processed - copy.dropped;
+	if (queue_stats->latency_samples != 0)
+		copy.latency_avg = queue_stats->latency_total / queue_stats->latency_samples;
+
+	copy_to_user(stats, &copy, sizeof(copy));
+	return 0;
+}
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
@@ -0,0 +1,638 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/**
+ * @file kvstore.c
+ * @brief Persistent key-value store in the flash storage area.
+ *
+ * The region is split into two halves, only one of which is active at a time.
+ * The first page of each half starts with a header containing a generation
+ * number, and the half with the highest valid generation is the active one.
+ * Records are appended to the active half without erasing, each one carrying
+ * a checksum and never crossing a page boundary.  A later record for the same
+ * key supersedes all earlier ones, and a record without a value (a tombstone)
+ * deletes the key.
+ *
+ * When the active half is full, all live records are copied to the other half
+ * (which is erased in the process), and the header of the new half is written
+ * last.  If anything goes wrong before that, the old half stays active.
+ *
+ * At boot, the active half is scanned once to build a hash index in RAM that
+ * maps every key to the location of its current record, so lookups never
+ * have to scan the flash.
+ */
+
+#include <ardix/crc32.h>
+#include <ardix/flash.h>
+#include <ardix/kvstore.h>
+#include <ardix/malloc.h>
+#include <ardix/mutex.h>
+
+#include <config.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if CONFIG_KVSTORE_PAGES < 2 || CONFIG_KVSTORE_PAGES % 2 != 0
+#error "CONFIG_KVSTORE_PAGES must be an even number of at least 2"
+#endif
+#if CONFIG_KVSTORE_KEYLEN > 255
+#error "CONFIG_KVSTORE_KEYLEN must not exceed 255"
+#endif
+
+#define KVSTORE_HALF_PAGES (CONFIG_KVSTORE_PAGES / 2)
+#define KVSTORE_INDEX_SIZE (2 * CONFIG_KVSTORE_MAXKEYS)
+
+/** "ARDK" in little endian */
+#define KVSTORE_HEADER_MAGIC 0x4b445241
+#define KVSTORE_RECORD_MAGIC 0x4b56
+/* erased flash */
+#define KVSTORE_RECORD_FREE 0xffff
+/* value length of a deleted key */
+#define KVSTORE_TOMBSTONE 0xffff
+
+struct kvstore_header {
+	uint32_t magic;
+	uint32_t generation;
+	/* checksum of the fields above */
+	uint32_t crc;
+};
+
+struct kvstore_record {
+	uint16_t magic;
+	uint8_t key_len;
+	uint8_t _reserved;
+	uint16_t value_len;
+	uint16_t _reserved2;
+	/* checksum of the fields above, the key and the value */
+	uint32_t crc;
+	/* followed by the key, the value and padding to a word boundary */
+};
+
+#define KVSTORE_SLOT_EMPTY	0xffff
+#define KVSTORE_SLOT_DELETED	0xfffe
+
+struct kvstore_slot {
+	uint32_t hash;
+	/* page within the active half, or one of KVSTORE_SLOT_* */
+	uint16_t page;
+	uint16_t offset;
+};
+
+static struct flash *kvstore_flash = NULL;
+static struct kvstore_slot kvstore_index[KVSTORE_INDEX_SIZE];
+static unsigned int kvstore_count;
+static unsigned int kvstore_active;
+static uint32_t kvstore_generation;
+/* where the next record goes */
+static unsigned int kvstore_tail_page;
+static size_t kvstore_tail_offset;
+/* two pages worth of scratch memory (the second one is only used for compaction) */
+static uint8_t *kvstore_buf;
+static MUTEX(kvstore_lock);
+
+static unsigned int kvstore_page(unsigned int half, unsigned int page)
+{
+	return CONFIG_FLASHFS_PAGES + half * KVSTORE_HALF_PAGES + page;
+}
+
+static size_t kvstore_record_size(size_t key_len, uint16_t value_len)
+{
+	size_t size = sizeof(struct kvstore_record) + key_len;
+	if (value_len != KVSTORE_TOMBSTONE)
+		size += value_len;
+	return (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+}
+
+/* the record must be in `buf` already, the crc field is ignored */
+static uint32_t kvstore_record_crc(const struct kvstore_record *rec)
+{
+	const size_t head = offsetof(struct kvstore_record, crc);
+	uint32_t crc = crc32(0, rec, head);
+	return crc32(crc, (const void *)rec + sizeof(*rec),
+		     kvstore_record_size(rec->key_len, rec->value_len) - sizeof(*rec));
+}
+
+/* FNV-1a */
+static uint32_t kvstore_hash(const char *key, size_t key_len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < key_len; i++) {
+		hash ^= (uint8_t)key[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void kvstore_index_clear(void)
+{
+	for (unsigned int i = 0; i < KVSTORE_INDEX_SIZE; i++)
+		kvstore_index[i].page = KVSTORE_SLOT_EMPTY;
+	kvstore_count = 0;
+}
+
+/*
+ * Find the index slot for a key.  Returns the slot holding the key, or if it
+ * isn't in the index, the slot it should be inserted at and sets `*found` to
+ * false.  Returns NULL if the key isn't there and the index is full.
+ */
+static struct kvstore_slot *kvstore_lookup(const char *key, size_t key_len, uint32_t hash,
+					   bool *found)
+{
+	struct kvstore_slot *insert = NULL;
+	unsigned int pos = hash % KVSTORE_INDEX_SIZE;
+
+	*found = false;
+
+	for (unsigned int i = 0; i < KVSTORE_INDEX_SIZE; i++) {
+		struct kvstore_slot *slot = &kvstore_index[pos];
+		pos = (pos + 1) % KVSTORE_INDEX_SIZE;
+
+		if (slot->page == KVSTORE_SLOT_EMPTY) {
+			if (insert == NULL)
+				insert = slot;
+			break;
+		}
+		if (slot->page == KVSTORE_SLOT_DELETED) {
+			if (insert == NULL)
+				insert = slot;
+			continue;
+		}
+		if (slot->hash != hash)
+			continue;
+
+		/* the flash is memory mapped, so comparing the key is cheap */
+		struct {
+			struct kvstore_record rec;
+			char key[CONFIG_KVSTORE_KEYLEN];
+		} tmp;
+		if (flash_read(kvstore_flash, &tmp, kvstore_page(kvstore_active, slot->page),
+			       slot->offset, sizeof(tmp.rec) + key_len) != 0)
+			continue;
+		if (tmp.rec.key_len == key_len && memcmp(tmp.key, key, key_len) == 0) {
+			*found = true;
+			return slot;
+		}
+	}
+
+	if (insert == NULL || kvstore_count >= CONFIG_KVSTORE_MAXKEYS)
+		return NULL;
+	return insert;
+}
+
+/* update the index with a record that was read or written at the given location */
+static void kvstore_index_update(const struct kvstore_record *rec, unsigned int page,
+				 size_t offset)
+{
+	const char *key = (const char *)rec + sizeof(*rec);
+	uint32_t hash = kvstore_hash(key, rec->key_len);
+	bool found;
+
+	struct kvstore_slot *slot = kvstore_lookup(key, rec->key_len, hash, &found);
+	if (slot == NULL)
+		return;
+
+	if (rec->value_len == KVSTORE_TOMBSTONE) {
+		if (found) {
+			slot->page = KVSTORE_SLOT_DELETED;
+			kvstore_count--;
+		}
+	} else {
+		if (!found)
+			kvstore_count++;
+		slot->hash = hash;
+		slot->page = (uint16_t)page;
+		slot->offset = (uint16_t)offset;
+	}
+}
+
+static bool kvstore_is_erased(unsigned int page, size_t offset)
+{
+	size_t page_size = kvstore_flash->page_size;
+
+	if (flash_read(kvstore_flash, kvstore_buf, page, offset, page_size - offset) != 0)
+		return false;
+
+	for (size_t i = 0; i < page_size - offset; i++) {
+		if (kvstore_buf[i] != 0xff)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read the record at the given location into `buf` and validate it.
+ * Returns the record size, 0 if the rest of the page is erased, or a
+ * negative error code if there is garbage (i.e. a torn write).
+ */
+static int kvstore_read_record(unsigned int page, size_t offset)
+{
+	struct kvstore_record *rec = (struct kvstore_record *)kvstore_buf;
+	size_t page_size = kvstore_flash->page_size;
+
+	if (offset + sizeof(*rec) > page_size)
+		return 0;
+
+	int err = flash_read(kvstore_flash, rec, page, offset, sizeof(*rec));
+	if (err != 0)
+		return err;
+
+	if (rec->magic == KVSTORE_RECORD_FREE)
+		return kvstore_is_erased(page, offset) ? 0 : -EIO;
+	if (rec->magic != KVSTORE_RECORD_MAGIC || rec->key_len == 0
+	    || rec->key_len > CONFIG_KVSTORE_KEYLEN)
+		return -EIO;
+
+	size_t size = kvstore_record_size(rec->key_len, rec->value_len);
+	if (size > page_size - offset)
+		return -EIO;
+
+	err = flash_read(kvstore_flash, rec, page, offset, size);
+	if (err != 0)
+		return err;
+	if (rec->crc != kvstore_record_crc(rec))
+		return -EIO;
+
+	return (int)size;
+}
+
+static bool kvstore_read_header(unsigned int half, uint32_t *generation)
+{
+	struct kvstore_header hdr;
+
+	if (flash_read(kvstore_flash, &hdr, kvstore_page(half, 0), 0, sizeof(hdr)) != 0)
+		return false;
+	if (hdr.magic != KVSTORE_HEADER_MAGIC
+	    || hdr.crc != crc32(0, &hdr, offsetof(struct kvstore_header, crc)))
+		return false;
+
+	*generation = hdr.generation;
+	return true;
+}
+
+/*
+ * Copy all live records to the inactive half and make it the active one.
+ * If this fails, the index may point to the wrong half and must be rebuilt.
+ */
+static int kvstore_compact(void)
+{
+	const size_t page_size = kvstore_flash->page_size;
+	unsigned int spare = !kvstore_active;
+	uint8_t *first = &kvstore_buf[page_size];
+	uint8_t *cur = first;
+	unsigned int page = 0;
+	size_t offset = sizeof(struct kvstore_header);
+	int err;
+
+	memset(first, 0xff, page_size);
+
+	for (unsigned int i = 0; i < KVSTORE_INDEX_SIZE; i++) {
+		struct kvstore_slot *slot = &kvstore_index[i];
+		if (slot->page == KVSTORE_SLOT_EMPTY || slot->page == KVSTORE_SLOT_DELETED)
+			continue;
+
+		unsigned int old_page = kvstore_page(kvstore_active, slot->page);
+		struct kvstore_record rec;
+		err = flash_read(kvstore_flash, &rec, old_page, slot->offset, sizeof(rec));
+		if (err != 0)
+			return err;
+		size_t size = kvstore_record_size(rec.key_len, rec.value_len);
+
+		if (offset + size > page_size) {
+			/* the first page is written last because of the header */
+			if (page != 0) {
+				err = flash_program(kvstore_flash, kvstore_page(spare, page), cur);
+				if (err != 0)
+					return err;
+			}
+			if (++page == KVSTORE_HALF_PAGES)
+				return -ENOSPC;
+			cur = kvstore_buf;
+			memset(cur, 0xff, page_size);
+			offset = 0;
+		}
+
+		err = flash_read(kvstore_flash, &cur[offset], old_page, slot->offset, size);
+		if (err != 0)
+			return err;
+		slot->page = (uint16_t)page;
+		slot->offset = (uint16_t)offset;
+		offset += size;
+	}
+
+	if (page != 0) {
+		err = flash_program(kvstore_flash, kvstore_page(spare, page), cur);
+		if (err != 0)
+			return err;
+	}
+
+	/* new records are appended without erasing, so erase the rest */
+	memset(kvstore_buf, 0xff, page_size);
+	for (unsigned int i = page + 1; i < KVSTORE_HALF_PAGES; i++) {
+		err = flash_program(kvstore_flash, kvstore_page(spare, i), kvstore_buf);
+		if (err != 0)
+			return err;
+	}
+
+	/*
+	 * The header is programmed separately, so a torn write can't result in
+	 * a valid header on an incomplete first page.
+	 */
+	err = flash_program(kvstore_flash, kvstore_page(spare, 0), first);
+	if (err != 0)
+		return err;
+
+	struct kvstore_header hdr = {
+		.magic = KVSTORE_HEADER_MAGIC,
+		.generation = kvstore_generation + 1,
+	};
+	hdr.crc = crc32(0, &hdr, offsetof(struct kvstore_header, crc));
+	err = flash_write(kvstore_flash, kvstore_page(spare, 0), 0, &hdr, sizeof(hdr));
+	if (err != 0)
+		return err;
+
+	kvstore_active = spare;
+	kvstore_generation++;
+	kvstore_tail_page = page;
+	kvstore_tail_offset = offset;
+
+	return 0;
+}
+
+/* find the active half and build the index */
+static int kvstore_mount(void)
+{
+	uint32_t generation[2];
+	bool valid[2];
+
+	kvstore_index_clear();
+
+	valid[0] = kvstore_read_header(0, &generation[0]);
+	valid[1] = kvstore_read_header(1, &generation[1]);
+	if (!valid[0] && !valid[1]) {
+		/* format by compacting an empty store into the first half */
+		kvstore_active = 1;
+		kvstore_generation = 0;
+		return kvstore_compact();
+	}
+
+	if (valid[0] && valid[1])
+		kvstore_active = generation[1] > generation[0];
+	else
+		kvstore_active = valid[1];
+	kvstore_generation = generation[kvstore_active];
+
+	kvstore_tail_page = 0;
+	kvstore_tail_offset = sizeof(struct kvstore_header);
+
+	for (unsigned int page = 0; page < KVSTORE_HALF_PAGES; page++) {
+		size_t offset = page == 0 ? sizeof(struct kvstore_header) : 0;
+		unsigned int flash_page = kvstore_page(kvstore_active, page);
+
+		while (1) {
+			int size = kvstore_read_record(flash_page, offset);
+			if (size < 0) {
+				/* torn write, don't append anything else to this page */
+				kvstore_tail_page = page + 1;
+				kvstore_tail_offset = 0;
+				break;
+			}
+			if (size == 0)
+				break;
+
+			kvstore_index_update((struct kvstore_record *)kvstore_buf, page, offset);
+			offset += (size_t)size;
+			kvstore_tail_page = page;
+			kvstore_tail_offset = offset;
+		}
+	}
+
+	return 0;
+}
+
+/* append a record for `key`, compacting first if there is no space left */
+static int kvstore_append(const char *key, size_t key_len, const void *value, uint16_t value_len,
+			  unsigned int *page, size_t *offset)
+{
+	const size_t page_size = kvstore_flash->page_size;
+	size_t size = kvstore_record_size(key_len, value_len);
+	bool compacted = false;
+	int err;
+
+	if (size > page_size - sizeof(struct kvstore_header))
+		return -E2BIG;
+
+	while (1) {
+		if (kvstore_tail_offset + size > page_size) {
+			kvstore_tail_page++;
+			kvstore_tail_offset = 0;
+		}
+		if (kvstore_tail_page >= KVSTORE_HALF_PAGES) {
+			if (compacted)
+				return -ENOSPC;
+			err = kvstore_compact();
+			if (err != 0) {
+				kvstore_mount();
+				return err;
+			}
+			compacted = true;
+			continue;
+		}
+
+		/* compaction uses the buffer too, so we build the record only now */
+		struct kvstore_record *rec = (struct kvstore_record *)kvstore_buf;
+		memset(kvstore_buf, 0, size);
+		rec->magic = KVSTORE_RECORD_MAGIC;
+		rec->key_len = (uint8_t)key_len;
+		rec->_reserved = 0;
+		rec->value_len = value_len;
+		rec->_reserved2 = 0;
+		memcpy(&kvstore_buf[sizeof(*rec)], key, key_len);
+		if (value_len != KVSTORE_TOMBSTONE)
+			memcpy(&kvstore_buf[sizeof(*rec) + key_len], value, value_len);
+		rec->crc = kvstore_record_crc(rec);
+
+		unsigned int flash_page = kvstore_page(kvstore_active, kvstore_tail_page);
+		err = flash_write(kvstore_flash, flash_page, kvstore_tail_offset, kvstore_buf, size);
+		if (err == 0) {
+			/* read it back, the area might not have been properly erased */
+			if (kvstore_read_record(flash_page, kvstore_tail_offset) == (int)size) {
+				*page = kvstore_tail_page;
+				*offset = kvstore_tail_offset;
+				kvstore_tail_offset += size;
+				return 0;
+			}
+		} else if (err != -EIO) {
+			return err;
+		}
+
+		/* skip the rest of the page and try again on the next one */
+		kvstore_tail_page++;
+		kvstore_tail_offset = 0;
+	}
+}
+
+int kvstore_init(void)
+{
+	struct flash *flash = flash_storage;
+
+	if (flash == NULL)
+		return -ENODEV;
+	if (flash->page_count < CONFIG_FLASHFS_PAGES + CONFIG_KVSTORE_PAGES
+	    || flash->page_size > KVSTORE_SLOT_DELETED
+	    || flash->page_size % sizeof(uint32_t) != 0)
+		return -EINVAL;
+
+	kvstore_buf = kmalloc(2 * flash->page_size);
+	if (kvstore_buf == NULL)
+		return -ENOMEM;
+
+	kvstore_flash = flash;
+	mutex_lock(&kvstore_lock);
+	int err = kvstore_mount();
+	mutex_unlock(&kvstore_lock);
+
+	if (err != 0) {
+		kvstore_flash = NULL;
+		kfree(kvstore_buf);
+	}
+
+	return err;
+}
+
+static int kvstore_check_key(const char *key, size_t *key_len)
+{
+	if (kvstore_flash == NULL)
+		return -ENODEV;
+
+	*key_len = strlen(key);
+	if (*key_len == 0)
+		return -EINVAL;
+	if (*key_len > CONFIG_KVSTORE_KEYLEN)
+		return -ENAMETOOLONG;
+
+	return 0;
+}
+
+ssize_t kvstore_get(const char *key, void *buf, size_t len)
+{
+	size_t key_len;
+	bool found;
+	ssize_t ret;
+
+	ret = kvstore_check_key(key, &key_len);
+	if (ret != 0)
+		return ret;
+
+	mutex_lock(&kvstore_lock);
+
+	struct kvstore_slot *slot = kvstore_lookup(key, key_len, kvstore_hash(key, key_len), &found);
+	if (!found) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	unsigned int page = kvstore_page(kvstore_active, slot->page);
+	struct kvstore_record rec;
+	ret = flash_read(kvstore_flash, &rec, page, slot->offset, sizeof(rec));
+	if (ret != 0)
+		goto out;
+
+	if (len > rec.value_len)
+		len = rec.value_len;
+	ret = flash_read(kvstore_flash, buf, page, slot->offset + sizeof(rec) + key_len, len);
+	if (ret == 0)
+		ret = rec.value_len;
+
+out:
+	mutex_unlock(&kvstore_lock);
+	return ret;
+}
+
+/* check whether the current value of a key is the same as `value` */
+static bool kvstore_value_equals(struct kvstore_slot *slot, size_t key_len, const void *value,
+				 uint16_t value_len)
+{
+	unsigned int page = kvstore_page(kvstore_active, slot->page);
+	struct kvstore_record rec;
+
+	if (flash_read(kvstore_flash, &rec, page, slot->offset, sizeof(rec)) != 0)
+		return false;
+	if (rec.value_len != value_len)
+		return false;
+	if (flash_read(kvstore_flash, kvstore_buf, page, slot->offset + sizeof(rec) + key_len,
+		       value_len) != 0)
+		return false;
+
+	return memcmp(kvstore_buf, value, value_len) == 0;
+}
+
+/* common part of kvstore_set() and kvstore_delete() */
+static int kvstore_put(const char *key, const void *value, uint16_t value_len)
+{
+	size_t key_len;
+	unsigned int page;
+	size_t offset;
+	bool found;
+
+	int err = kvstore_check_key(key, &key_len);
+	if (err != 0)
+		return err;
+
+	mutex_lock(&kvstore_lock);
+
+	uint32_t hash = kvstore_hash(key, key_len);
+	struct kvstore_slot *slot = kvstore_lookup(key, key_len, hash, &found);
+	if (value_len == KVSTORE_TOMBSTONE && !found) {
+		err = -ENOENT;
+		goto out;
+	}
+	if (slot == NULL) {
+		err = -ENOSPC;
+		goto out;
+	}
+	/* counters and such often get set to the value they already have */
+	if (found && value_len != KVSTORE_TOMBSTONE
+	    && kvstore_value_equals(slot, key_len, value, value_len))
+		goto out;
+
+	err = kvstore_append(key, key_len, value, value_len, &page, &offset);
+	if (err == 0) {
+		/* compaction may have moved the slots around, look it up again */
+		kvstore_index_update((struct kvstore_record *)kvstore_buf, page, offset);
+	}
+
+out:
+	mutex_unlock(&kvstore_lock);
+	return err;
+}
+
+int kvstore_set(const char *key, const void *value, size_t len)
+{
+	if (len >= KVSTORE_TOMBSTONE)
+		return -E2BIG;
+
+	return kvstore_put(key, value, (uint16_t)len);
+}
+
+int kvstore_delete(const char *key)
+{
+	return kvstore_put(key, NULL, KVSTORE_TOMBSTONE);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
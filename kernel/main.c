@@ -1,9 +1,14 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
+#include <ardix/dma.h>
+#include <ardix/flash.h>
+#include <ardix/flashfs.h>
 #include <ardix/io.h>
 #include <ardix/kent.h>
+#include <ardix/kvstore.h>
 #include <ardix/kevent.h>
 #include <ardix/sched.h>
+#include <ardix/tmpfs.h>
 
 #include <config.h>
 #include <stdbool.h>
@@ -36,6 +41,14 @@ int main(void)
 	if (err != 0)
 		return err;
 
+	err = dma_init();
+	if (err != 0)
+		return err;
+
+	err = tmpfs_init();
+	if (err != 0)
+		return err;
+
 	err = io_init();
 	if (err != 0)
 		return err;
@@ -46,6 +59,16 @@ int main(void)
 	printf("This is non-violent software, and there is NO WARRANTY.\n");
 	printf("See <https://git.fef.moe/fef/ardix> for details.\n\n");
 
+	/* not having persistent storage isn't fatal */
+	err = flash_init();
+	if (err == 0)
+		err = flashfs_init();
+	if (err != 0)
+		printf("Unable to mount " FLASHFS_MOUNTPOINT " (error %d)\n", err);
+	err = kvstore_init();
+	if (err != 0)
+		printf("Unable to initialize key-value store (error %d)\n", err);
+
 	pid_t pid = exec(init_main);
 	waitpid(pid, &err, 0);
 	printf("initd exited with status %d, system halted\n", err);
@@ -0,0 +1,101 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/block.h>
+#include <ardix/device.h>
+#include <ardix/malloc.h>
+#include <ardix/ramdisk.h>
+#include <ardix/util.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct ramdisk {
+	struct block_device bdev;
+	uint8_t *data;
+};
+
+#define block_device_to_ramdisk(ptr) container_of(ptr, struct ramdisk, bdev)
+
+static int ramdisk_read(struct block_device *bdev, uint32_t sector, void *const bufs[],
+			unsigned int count)
+{
+	struct ramdisk *ramdisk = block_device_to_ramdisk(bdev);
+
+	for (unsigned int i = 0; i < count; i++)
+		memcpy(bufs[i], &ramdisk->data[(sector + i) * bdev->sector_size], bdev->sector_size);
+
+	return 0;
+}
+
+static int ramdisk_write(struct block_device *bdev, uint32_t sector, const void *const bufs[],
+			 unsigned int count)
+{
+	struct ramdisk *ramdisk = block_device_to_ramdisk(bdev);
+
+	for (unsigned int i = 0; i < count; i++)
+		memcpy(&ramdisk->data[(sector + i) * bdev->sector_size], bufs[i], bdev->sector_size);
+
+	return 0;
+}
+
+static void ramdisk_destroy(struct kent *kent)
+{
+	struct block_device *bdev = device_to_block_device(kent_to_device(kent));
+	struct ramdisk *ramdisk = block_device_to_ramdisk(bdev);
+
+	kfree(ramdisk->data);
+	kfree(ramdisk);
+}
+
+struct block_device *ramdisk_create(size_t sector_size, uint32_t sector_count, int *err)
+{
+	if (sector_count == 0 || sector_count > SIZE_MAX / sector_size) {
+		*err = -EINVAL;
+		return NULL;
+	}
+
+	struct ramdisk *ramdisk = kmalloc(sizeof(*ramdisk));
+	if (ramdisk == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	ramdisk->data = kmalloc(sector_count * sector_size);
+	if (ramdisk->data == NULL) {
+		kfree(ramdisk);
+		*err = -ENOMEM;
+		return NULL;
+	}
+	memset(ramdisk->data, 0, sector_count * sector_size);
+
+	ramdisk->bdev.sector_size = sector_size;
+	ramdisk->bdev.sector_count = sector_count;
+	ramdisk->bdev.read = ramdisk_read;
+	ramdisk->bdev.write = ramdisk_write;
+	ramdisk->bdev.device.kent.parent = NULL;
+	ramdisk->bdev.device.kent.destroy = ramdisk_destroy;
+
+	*err = block_device_init(&ramdisk->bdev);
+	if (*err != 0) {
+		kfree(ramdisk->data);
+		kfree(ramdisk);
+		return NULL;
+	}
+
+	return &ramdisk->bdev;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
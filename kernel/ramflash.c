@@ -0,0 +1,114 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/device.h>
+#include <ardix/flash.h>
+#include <ardix/malloc.h>
+#include <ardix/ramflash.h>
+#include <ardix/util.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct ramflash {
+	struct flash flash;
+	uint8_t *data;
+};
+
+#define flash_to_ramflash(ptr) container_of(ptr, struct ramflash, flash)
+
+static int ramflash_read(struct flash *flash, void *dest, unsigned int page, size_t offset,
+			 size_t len)
+{
+	struct ramflash *ramflash = flash_to_ramflash(flash);
+
+	memcpy(dest, &ramflash->data[page * flash->page_size + offset], len);
+	return 0;
+}
+
+static int ramflash_write(struct flash *flash, unsigned int page, size_t offset, const void *src,
+			  size_t len)
+{
+	struct ramflash *ramflash = flash_to_ramflash(flash);
+	uint8_t *dest = &ramflash->data[page * flash->page_size + offset];
+	const uint8_t *tmp = src;
+
+	/* programming can only clear bits, setting them again requires an erase */
+	for (size_t i = 0; i < len; i++)
+		dest[i] &= tmp[i];
+
+	return 0;
+}
+
+static int ramflash_program(struct flash *flash, unsigned int page, const void *src)
+{
+	struct ramflash *ramflash = flash_to_ramflash(flash);
+
+	memset(&ramflash->data[page * flash->page_size], 0xff, flash->page_size);
+	return ramflash_write(flash, page, 0, src, flash->page_size);
+}
+
+static void ramflash_destroy(struct kent *kent)
+{
+	struct flash *flash = container_of(kent_to_device(kent), struct flash, device);
+	struct ramflash *ramflash = flash_to_ramflash(flash);
+
+	kfree(ramflash->data);
+	kfree(ramflash);
+}
+
+struct flash *ramflash_create(size_t page_size, unsigned int page_count, int *err)
+{
+	if (page_size == 0 || page_size % sizeof(uint32_t) != 0
+	    || page_count == 0 || page_count > SIZE_MAX / page_size) {
+		*err = -EINVAL;
+		return NULL;
+	}
+
+	struct ramflash *ramflash = kmalloc(sizeof(*ramflash));
+	if (ramflash == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	ramflash->data = kmalloc(page_count * page_size);
+	if (ramflash->data == NULL) {
+		kfree(ramflash);
+		*err = -ENOMEM;
+		return NULL;
+	}
+	/* erased flash reads as all ones */
+	memset(ramflash->data, 0xff, page_count * page_size);
+
+	ramflash->flash.page_size = page_size;
+	ramflash->flash.page_count = page_count;
+	ramflash->flash.read = ramflash_read;
+	ramflash->flash.program = ramflash_program;
+	ramflash->flash.write = ramflash_write;
+
+	ramflash->flash.device.kent.parent = NULL;
+	ramflash->flash.device.kent.destroy = ramflash_destroy;
+
+	*err = device_init(&ramflash->flash.device);
+	if (*err != 0) {
+		kfree(ramflash->data);
+		kfree(ramflash);
+		return NULL;
+	}
+
+	return &ramflash->flash;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,90 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/malloc.h>
+#include <ardix/rxring.h>
+#include <ardix/types.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <toolchain.h>
+
+struct rxring *rxring_create(unsigned int size)
+{
+	if (size == 0 || (size & (size - 1)) != 0)
+		return NULL;
+
+	struct rxring *ring = kmalloc(sizeof(*ring) + size);
+	if (ring == NULL)
+		return NULL;
+
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return ring;
+}
+
+void rxring_destroy(struct rxring *ring)
+{
+	kfree(ring);
+}
+
+size_t rxring_write(struct rxring *ring, const void *src, size_t len)
+{
+	unsigned int head = ring->head;
+	size_t space = ring->size - (head - ring->tail);
+	if (len > space)
+		len = space;
+
+	size_t pos = head & (ring->size - 1);
+	size_t first = ring->size - pos;
+	if (first > len)
+		first = len;
+
+	memcpy(&ring->data[pos], src, first);
+	memcpy(&ring->data[0], src + first, len - first);
+
+	/* publish the data only after it has been written */
+	barrier();
+	ring->head = head + (unsigned int)len;
+
+	return len;
+}
+
+size_t rxring_read(void *dest, struct rxring *ring, size_t len)
+{
+	unsigned int tail = ring->tail;
+	size_t avail = ring->head - tail;
+	if (len > avail)
+		len = avail;
+
+	/* don't read the data before we know it is there */
+	barrier();
+
+	size_t pos = tail & (ring->size - 1);
+	size_t first = ring->size - pos;
+	if (first > len)
+		first = len;
+
+	memcpy(dest, &ring->data[pos], first);
+	memcpy(dest + first, &ring->data[0], len - first);
+
+	/* the producer may overwrite the data as soon as we release it */
+	barrier();
+	ring->tail = tail + (unsigned int)len;
+
+	return len;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
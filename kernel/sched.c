@@ -245,6 +245,11 @@ long sys_exec(int (*entry)(void))
 	list_init(&child->pending_sigchld);
 	mutex_init(&child->pending_sigchld_lock);
 
+	fdtab_clone(&child->fdtab, &current->fdtab);
+	child->ioring = NULL;
+	child->txbuf = NULL;
+	child->txbuf_file = NULL;
+
 	child->state = TASK_QUEUE;
 	tasks[pid] = child;
 	goto out;
@@ -2,24 +2,122 @@
 
 #include <ardix/atomic.h>
 #include <ardix/device.h>
+#include <ardix/dma.h>
+#include <ardix/file.h>
 #include <ardix/mutex.h>
-#include <ardix/ringbuf.h>
+#include <ardix/rxring.h>
 #include <ardix/sched.h>
 #include <ardix/serial.h>
 
 #include <arch/serial.h>
 
 #include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
+#include <termios.h>
+
+/*
+ * Line discipline: in canonical mode, reads are satisfied by one complete
+ * line, otherwise by VMIN bytes or whatever arrived before the VTIME timeout.
+ * Readers are only woken up once that is the case, rather than for every
+ * chunk of data the irq handler moves to the ring.
+ */
+
+static unsigned int serial_ldisc_vmin(struct serial_device *dev)
+{
+	unsigned int vmin = dev->termios.c_cc[VMIN];
+
+	if (vmin == 0)
+		vmin = 1;
+	if (vmin > dev->rx->size)
+		vmin = dev->rx->size;
+
+	return vmin;
+}
+
+/* length of the first line in the ring including the newline, or 0 if incomplete */
+static size_t serial_ldisc_line_len(struct serial_device *dev)
+{
+	struct rxring *rx = dev->rx;
+	unsigned int tail = rx->tail;
+	unsigned int head = rx->head;
+
+	for (unsigned int i = tail; i != head; i++) {
+		if (rx->data[i & (rx->size - 1)] == '\n')
+			return i - tail + 1;
+	}
+
+	return 0;
+}
+
+/* amount of bytes a read may consume right now, 0 if it has to wait */
+static size_t serial_ldisc_avail(struct serial_device *dev)
+{
+	unsigned int len = rxring_len(dev->rx);
+
+	if (len == 0)
+		return 0;
+
+	if (dev->termios.c_lflag & ICANON) {
+		size_t line = serial_ldisc_line_len(dev);
+		if (line != 0)
+			return line;
+		/* a line that doesn't fit is returned in pieces */
+		return len == dev->rx->size ? len : 0;
+	}
+
+	if (len >= serial_ldisc_vmin(dev) || dev->rx_expired)
+		return len;
+
+	return 0;
+}
+
+/* pause or resume the sender depending on the fill level of the ring */
+static void serial_flow_update(struct serial_device *dev)
+{
+	unsigned int len = rxring_len(dev->rx);
+
+	if (!(dev->termios.c_iflag & IXOFF))
+		return;
+
+	if (!dev->rx_stopped && len >= dev->rx_hiwat) {
+		dev->rx_stopped = true;
+		dev->stats.xoff++;
+		arch_serial_send_xchar(dev, dev->termios.c_cc[VSTOP]);
+	} else if (dev->rx_stopped && len <= dev->rx_lowat) {
+		dev->rx_stopped = false;
+		arch_serial_send_xchar(dev, dev->termios.c_cc[VSTART]);
+	}
+}
 
 static ssize_t serial_device_read(void *dest, struct device *dev, size_t len, off_t offset)
 {
 	ssize_t ret;
 	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
 
+	/* a task that has the ring mapped is the only consumer */
+	if (serial_dev->rx_owner != NULL)
+		return -EACCES;
+
 	ret = mutex_trylock(&dev->lock);
 	if (ret == 0) {
-		ret = serial_read(dest, serial_dev, len);
+		size_t avail = serial_ldisc_avail(serial_dev);
+		if (len > avail)
+			len = avail;
+
+		/* the console never reaches EOF, it just has no data yet */
+		if (len == 0) {
+			ret = -EBUSY;
+		} else {
+			ret = serial_read(dest, serial_dev, len);
+			serial_dev->rx_expired = false;
+			serial_flow_update(serial_dev);
+			arch_serial_rx_drained(serial_dev);
+		}
 		mutex_unlock(&dev->lock);
 	}
 
@@ -40,24 +138,209 @@ static ssize_t serial_device_write(struct device *dev, const void *src, size_t l
 	return ret;
 }
 
+static ssize_t serial_device_writev(struct device *dev, const struct iovec *iov, int iovcnt,
+				    off_t offset)
+{
+	ssize_t ret;
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret == 0) {
+		ret = serial_writev(serial_dev, iov, iovcnt);
+		mutex_unlock(&dev->lock);
+	}
+
+	return ret;
+}
+
+static ssize_t serial_device_write_dma(struct device *dev, struct dmabuf *buf)
+{
+	ssize_t ret;
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	ret = mutex_trylock(&dev->lock);
+	if (ret == 0) {
+		ret = serial_write_dma(serial_dev, buf);
+		if (ret > 0)
+			serial_dev->stats.tx_bytes += (unsigned long int)ret;
+		mutex_unlock(&dev->lock);
+	}
+
+	return ret;
+}
+
+static int serial_device_poll(struct device *dev, off_t offset)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+	return serial_poll(serial_dev);
+}
+
+static int serial_device_map_rx(struct device *dev, struct file *file, struct rxring **ring)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	if (serial_dev->rx_owner != NULL && serial_dev->rx_owner != file)
+		return -EBUSY;
+
+	/* no reference, serial_device_close() releases the mapping */
+	serial_dev->rx_owner = file;
+	*ring = serial_dev->rx;
+	return 0;
+}
+
+static int serial_device_tcattr(struct device *dev, struct termios *termios, bool set)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	if (!set) {
+		*termios = serial_dev->termios;
+		return 0;
+	}
+
+	/* an output rate of 0 (B0) leaves the baud rate as it is */
+	speed_t speed = termios->c_ospeed != 0 ? termios->c_ospeed : (speed_t)serial_dev->baud;
+
+	/* there is only one baud rate generator for both directions */
+	if (termios->c_ispeed != 0 && termios->c_ispeed != speed)
+		return -EINVAL;
+	if ((termios->c_cflag & CRTSCTS) && !arch_serial_has_hwflow(serial_dev))
+		return -EINVAL;
+
+	/*
+	 * This is the only thing that can still fail, so it has to come after
+	 * all other checks and before anything else is changed.
+	 */
+	if (speed != (speed_t)serial_dev->baud) {
+		int err = arch_serial_set_baud(serial_dev, (long int)speed);
+		if (err)
+			return err;
+		serial_dev->baud = (long int)speed;
+	}
+	termios->c_ispeed = speed;
+	termios->c_ospeed = speed;
+	arch_serial_set_hwflow(serial_dev, termios->c_cflag & CRTSCTS);
+
+	/* don't leave the sender hanging if flow control is turned off */
+	if (serial_dev->rx_stopped && !(termios->c_iflag & IXOFF)) {
+		serial_dev->rx_stopped = false;
+		arch_serial_send_xchar(serial_dev, serial_dev->termios.c_cc[VSTART]);
+	}
+
+	serial_dev->termios = *termios;
+	if (termios->c_lflag & ICANON)
+		dev->flags |= DEVICE_READ_RECORDS;
+	else
+		dev->flags &= ~DEVICE_READ_RECORDS;
+	serial_dev->rx_scan = serial_dev->rx->tail;
+	serial_dev->rx_expired = false;
+	if (termios->c_lflag & ICANON)
+		arch_serial_set_rx_timeout(serial_dev, 0);
+	else
+		arch_serial_set_rx_timeout(serial_dev, termios->c_cc[VTIME] * 100u);
+
+	serial_flow_update(serial_dev);
+
+	/* data that is already there may satisfy a read with the new settings */
+	if (serial_ldisc_avail(serial_dev) != 0)
+		device_kevent_create_and_dispatch(dev, DEVICE_KEVENT_RX);
+
+	return 0;
+}
+
+static int serial_device_tcflush(struct device *dev)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+	struct rxring *rx = serial_dev->rx;
+
+	/* the tail belongs to whoever has the ring mapped */
+	if (serial_dev->rx_owner != NULL)
+		return -EBUSY;
+
+	/*
+	 * Syscalls run with irqs disabled, so the irq handler can't interfere.
+	 * Data held back by hardware flow control is discarded as well, as far
+	 * as it fits into the ring.
+	 */
+	rx->tail = rx->head;
+	arch_serial_rx_drained(serial_dev);
+	rx->tail = rx->head;
+	serial_dev->rx_scan = rx->head;
+	serial_dev->rx_expired = false;
+	serial_flow_update(serial_dev);
+
+	return 0;
+}
+
+static int serial_device_tcstats(struct device *dev, struct tcstats *stats)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	*stats = serial_dev->stats;
+	return 0;
+}
+
+static void serial_device_close(struct device *dev, struct file *file)
+{
+	struct serial_device *serial_dev = container_of(dev, struct serial_device, device);
+
+	if (serial_dev->rx_owner == file)
+		serial_dev->rx_owner = NULL;
+}
+
 int serial_init(struct serial_device *dev, long int baud)
 {
 	int err = -1;
 
 	if (dev->id < 0)
-		return -1; /* invalid dev */
+		return -ENODEV; /* invalid dev */
 
-	dev->device.read = serial_device_read;
-	dev->device.write = serial_device_write;
 	err = device_init(&dev->device);
 	if (err)
 		goto err_device_init;
 
+	dev->device.read = serial_device_read;
+	dev->device.write = serial_device_write;
+	dev->device.writev = serial_device_writev;
+	dev->device.poll = serial_device_poll;
+	dev->device.close = serial_device_close;
+	dev->device.write_dma = serial_device_write_dma;
+	dev->device.map_rx = serial_device_map_rx;
+	dev->device.tcattr = serial_device_tcattr;
+	dev->device.tcflush = serial_device_tcflush;
+	dev->device.tcstats = serial_device_tcstats;
+
 	dev->baud = baud;
 
-	dev->rx = ringbuf_create(CONFIG_SERIAL_BUFSZ);
-	if (dev->rx == NULL)
-		goto err_ringbuf_create;
+	dev->rx = rxring_create(dev->rx_bufsz);
+	if (dev->rx == NULL) {
+		err = -ENOMEM;
+		goto err_rxring_create;
+	}
+	dev->rx_owner = NULL;
+
+	/* raw mode, every byte satisfies a read */
+	memset(&dev->termios, 0, sizeof(dev->termios));
+	dev->termios.c_cc[VMIN] = 1;
+	dev->termios.c_cc[VTIME] = 0;
+	dev->termios.c_cc[VSTART] = 0x11; /* DC1 */
+	dev->termios.c_cc[VSTOP] = 0x13; /* DC3 */
+	dev->termios.c_ispeed = (speed_t)baud;
+	dev->termios.c_ospeed = (speed_t)baud;
+	dev->device.flags &= ~DEVICE_READ_RECORDS;
+	dev->rx_scan = 0;
+	dev->rx_expired = false;
+
+	/* pause the sender at 3/4 full, resume once it's down to 1/4 */
+	dev->rx_hiwat = dev->rx->size - dev->rx->size / 4;
+	dev->rx_lowat = dev->rx->size / 4;
+	dev->rx_stopped = false;
+	memset(&dev->stats, 0, sizeof(dev->stats));
+
+	/* TX buffers are created with irqs disabled, so keep them off the heap */
+	err = dmapool_create(&dev->device, CONFIG_SERIAL_DMAPOOL_COUNT,
+			     CONFIG_SERIAL_DMAPOOL_BUFSZ);
+	if (err)
+		goto err_dmapool_create;
 
 	err = arch_serial_init(dev);
 	if (err)
@@ -66,8 +349,11 @@ int serial_init(struct serial_device *dev, long int baud)
 	goto out;
 
 err_arch_serial_init:
-	ringbuf_destroy(dev->rx);
-err_ringbuf_create:
+	dmapool_destroy(&dev->device);
+err_dmapool_create:
+	rxring_destroy(dev->rx);
+	dev->rx = NULL;
+err_rxring_create:
 	device_put(&dev->device);
 err_device_init:
 out:
@@ -77,15 +363,64 @@ out:
 void serial_exit(struct serial_device *dev)
 {
 	arch_serial_exit(dev);
-	ringbuf_destroy(dev->rx);
+	dmapool_destroy(&dev->device);
+	rxring_destroy(dev->rx);
+	dev->rx = NULL;
 	dev->id = -1;
 }
 
+struct file *serial_open(const char *name, int flags, int *err)
+{
+	static const char prefix[] = "ttyS";
+	unsigned int index = 0;
+	const char *pos;
+
+	if (memcmp(name, prefix, sizeof(prefix) - 1) != 0)
+		goto err_noent;
+	pos = &name[sizeof(prefix) - 1];
+	if (*pos < '0' || *pos > '9')
+		goto err_noent;
+	while (*pos >= '0' && *pos <= '9') {
+		index = index * 10 + (unsigned int)(*pos - '0');
+		/* there aren't nearly as many ports, this just prevents overflows */
+		if (index >= 100)
+			goto err_noent;
+		pos++;
+	}
+	if (*pos != '\0')
+		goto err_noent;
+
+	struct serial_device *dev = arch_serial_get(index);
+	if (dev == NULL)
+		goto err_noent;
+
+	if ((flags & O_CREAT) && (flags & O_EXCL)) {
+		*err = -EEXIST;
+		return NULL;
+	}
+
+	/* ports other than the console are only brought up when they are needed */
+	if (dev->rx == NULL) {
+		*err = serial_init(dev, dev->baud);
+		if (*err != 0)
+			return NULL;
+	}
+
+	struct file *file = file_create(&dev->device, FILE_TYPE_PIPE, err);
+	if (file != NULL)
+		file->flags = flags & (O_ACCMODE | O_NONBLOCK);
+	return file;
+
+err_noent:
+	*err = -ENOENT;
+	return NULL;
+}
+
 ssize_t serial_read(void *dest, struct serial_device *dev, size_t len)
 {
 	ssize_t ret;
 
-	ret = (ssize_t)ringbuf_read(dest, dev->rx, len);
+	ret = (ssize_t)rxring_read(dest, dev->rx, len);
 
 	return ret;
 }
@@ -95,6 +430,68 @@ ssize_t serial_write(struct serial_device *dev, const void *data, size_t len)
 	ssize_t ret;
 
 	ret = arch_serial_write(dev, data, len);
+	if (ret > 0)
+		dev->stats.tx_bytes += (unsigned long int)ret;
+
+	return ret;
+}
+
+ssize_t serial_writev(struct serial_device *dev, const struct iovec *iov, int iovcnt)
+{
+	ssize_t ret = arch_serial_writev(dev, iov, iovcnt);
+
+	if (ret > 0)
+		dev->stats.tx_bytes += (unsigned long int)ret;
+
+	return ret;
+}
+
+void serial_rx_notify(struct serial_device *dev, enum serial_rx_event event)
+{
+	struct rxring *rx = dev->rx;
+	unsigned int head = rx->head;
+	bool wake;
+
+	if (dev->rx_owner != NULL) {
+		/* tasks that have the ring mapped do their own line discipline */
+		wake = head != rx->tail;
+	} else if (dev->termios.c_lflag & ICANON) {
+		unsigned int scan = dev->rx_scan;
+		wake = head - rx->tail == rx->size;
+
+		/* only look at what is new since the last call */
+		if ((int)(rx->tail - scan) > 0)
+			scan = rx->tail;
+		for (; scan != head && !wake; scan++)
+			wake = rx->data[scan & (rx->size - 1)] == '\n';
+		dev->rx_scan = head;
+	} else if (event == SERIAL_RX_TIMEOUT) {
+		wake = head != rx->tail;
+		dev->rx_expired = wake;
+	} else {
+		wake = head - rx->tail >= serial_ldisc_vmin(dev);
+	}
+
+	serial_flow_update(dev);
+
+	if (wake)
+		device_kevent_create_and_dispatch(&dev->device, DEVICE_KEVENT_RX);
+}
+
+int serial_poll(struct serial_device *dev)
+{
+	int ret = 0;
+
+	/* tasks with the ring mapped consume it without telling us */
+	if (dev->rx_owner != NULL) {
+		serial_flow_update(dev);
+		arch_serial_rx_drained(dev);
+	}
+
+	if (dev->rx_owner != NULL ? rxring_len(dev->rx) != 0 : serial_ldisc_avail(dev) != 0)
+		ret |= POLLIN;
+	if (arch_serial_tx_ready(dev))
+		ret |= POLLOUT;
 
 	return ret;
 }
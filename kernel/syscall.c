@@ -18,6 +18,26 @@ long (*const sys_table[NSYSCALLS])(sysarg_t arg1, sysarg_t arg2, sysarg_t arg3,
 	sys_table_entry(SYS_exec,		sys_exec),
 	sys_table_entry(SYS_exit,		sys_exit),
 	sys_table_entry(SYS_waitpid,		sys_waitpid),
+	sys_table_entry(SYS_poll,		sys_poll),
+	sys_table_entry(SYS_kevent_stats,	sys_kevent_stats),
+	sys_table_entry(SYS_fcntl,		sys_fcntl),
+	sys_table_entry(SYS_readv,		sys_readv),
+	sys_table_entry(SYS_writev,		sys_writev),
+	sys_table_entry(SYS_ioring_setup,	sys_ioring_setup),
+	sys_table_entry(SYS_ioring_enter,	sys_ioring_enter),
+	sys_table_entry(SYS_open,		sys_open),
+	sys_table_entry(SYS_close,		sys_close),
+	sys_table_entry(SYS_lseek,		sys_lseek),
+	sys_table_entry(SYS_mkdir,		sys_mkdir),
+	sys_table_entry(SYS_pipe,		sys_pipe),
+	sys_table_entry(SYS_splice,		sys_splice),
+	sys_table_entry(SYS_rxring_map,	sys_rxring_map),
+	sys_table_entry(SYS_bcast,		sys_bcast),
+	sys_table_entry(SYS_txbuf_reserve,	sys_txbuf_reserve),
+	sys_table_entry(SYS_txbuf_commit,	sys_txbuf_commit),
+	sys_table_entry(SYS_tcgetattr,		sys_tcgetattr),
+	sys_table_entry(SYS_tcsetattr,		sys_tcsetattr),
+	sys_table_entry(SYS_tcgetstats,		sys_tcgetstats),
 };
 
 long sys_stub(void)
@@ -2,6 +2,7 @@
 
 #include <arch-generic/do_switch.h>
 
+#include <ardix/ioring.h>
 #include <ardix/kent.h>
 #include <ardix/kevent.h>
 #include <ardix/malloc.h>
@@ -9,6 +10,7 @@
 #include <ardix/sched.h>
 #include <ardix/syscall.h>
 #include <ardix/task.h>
+#include <ardix/txbuf.h>
 #include <ardix/userspace.h>
 #include <ardix/util.h>
 
@@ -26,6 +28,9 @@ static void task_kevent_destroy(struct kent *kent)
 
 void task_kevent_create_and_dispatch(struct task *task, int status)
 {
+	if (!kevent_has_listeners(KEVENT_TASK))
+		return;
+
 	struct task_kevent *event = kmalloc(sizeof(*event));
 	if (event == NULL)
 		return; /* TODO: we're fucked here */
@@ -50,6 +55,10 @@ __noreturn void sys_exit(int status)
 	struct task *task = current;
 
 	struct task *parent = task_parent(task);
+
+	ioring_release(task);
+	txbuf_release(task);
+	fdtab_release(&task->fdtab);
 	task_kevent_create_and_dispatch(task, status);
 
 	if (parent->state != TASK_WAITPID) {
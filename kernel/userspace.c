@@ -1,29 +1,97 @@
 /* See the end of this file for copyright, license, and warranty information. */
 
+#include <arch/linker.h>
+
+#include <ardix/dma.h>
 #include <ardix/types.h>
 #include <ardix/userspace.h>
 
-#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <toolchain.h>
 
+static inline bool is_in_range(uintptr_t start, uintptr_t end, void *lower, void *upper)
+{
+	return start >= (uintptr_t)lower && end <= (uintptr_t)upper;
+}
+
+bool access_ok(__user const void *ptr, size_t len, bool write)
+{
+	uintptr_t start = (uintptr_t)ptr;
+	uintptr_t end = start + len;
+
+	if (end < start)
+		return false; /* overflow */
+
+	/* .data, .bss, the main stack and the heap (incl. task stacks) */
+	if (is_in_range(start, end, &_srelocate, &_eheap))
+		return true;
+
+	/* read-only data can also be in flash (like string literals) */
+	if (!write && is_in_range(start, end, &_sfixed, &_etext))
+		return true;
+
+	return false;
+}
+
 /*
  * These don't do anything special because there is no MPU or other protection
  * yet, but having them as a wrapper this early is probably a good idea because
- * it make life easier when the MPU is active.
+ * it make life easier when the MPU is active.  Large copies are offloaded to
+ * the DMA controller so other tasks can run in the meantime.
  */
 
 size_t copy_from_user(void *dest, __user const void *src, size_t len)
 {
-	memcpy(dest, src, len);
+	dma_memcpy(dest, src, len);
 	return len;
 }
 
 size_t copy_to_user(__user void *dest, const void *src, size_t len)
 {
-	memcpy(dest, src, len);
+	dma_memcpy(dest, src, len);
 	return len;
 }
 
+long strncpy_from_user(char *dest, __user const char *src, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (!access_ok(&src[i], 1, false))
+			return -EFAULT;
+
+		dest[i] = src[i];
+		if (dest[i] == '\0')
+			return (long)i;
+	}
+
+	return -ENAMETOOLONG;
+}
+
+long copy_iov_from_user(struct iovec *dest, __user const struct iovec *src, int iovcnt, bool write)
+{
+	long total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return -EINVAL;
+	if (!access_ok(src, (size_t)iovcnt * sizeof(*src), false))
+		return -EFAULT;
+
+	copy_from_user(dest, src, (size_t)iovcnt * sizeof(*dest));
+
+	for (int i = 0; i < iovcnt; i++) {
+		/* the total length must be representable as the return value */
+		if (dest[i].iov_len > (size_t)(LONG_MAX - total))
+			return -EINVAL;
+		if (!access_ok(dest[i].iov_base, dest[i].iov_len, write))
+			return -EFAULT;
+		total += (long)dest[i].iov_len;
+	}
+
+	return total;
+}
+
 /*
  * This file is part of Ardix.
  * Copyright (c) 2020, 2021 Felix Kopp <owo@fef.moe>.
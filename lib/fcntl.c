@@ -0,0 +1,38 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/syscall.h>
+
+#include <fcntl.h>
+#include <stdarg.h>
+
+int open(const char *path, int flags, ...)
+{
+	/* there are no file permissions, so the mode argument is ignored */
+	return (int)syscall(SYS_open, (sysarg_t)path, (sysarg_t)flags);
+}
+
+int fcntl(int fildes, int cmd, ...)
+{
+	va_list args;
+	int arg;
+
+	/* all commands we support take exactly one int argument */
+	va_start(args, cmd);
+	arg = va_arg(args, int);
+	va_end(args);
+
+	return (int)syscall(SYS_fcntl, (sysarg_t)fildes, (sysarg_t)cmd, (sysarg_t)arg);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,28 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/syscall.h>
+
+#include <ioring.h>
+
+int ioring_setup(struct ioring *ring)
+{
+	return (int)syscall(SYS_ioring_setup, (sysarg_t)ring);
+}
+
+int ioring_enter(unsigned int to_submit, unsigned int min_complete)
+{
+	return (int)syscall(SYS_ioring_enter, (sysarg_t)to_submit, (sysarg_t)min_complete);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -3,11 +3,13 @@
 #include <errno.h>
 /* Using GCC's stdarg.h is recommended even with -nodefaultlibs and -fno-builtin */
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <txbuf.h>
 #include <unistd.h>
 
 #include <config.h>
@@ -24,32 +26,92 @@
 #	define PRINTF_UINT_BUFSZ 20
 #endif
 
+/*
+ * Buffers that are at least this full are committed as they are, anything
+ * smaller goes through write() so the device can merge it with other output.
+ */
+#define PRINTF_DMA_THRESHOLD (CONFIG_PRINTF_BUFSZ - CONFIG_PRINTF_BUFSZ / 4)
+
 struct printf_buf {
 	size_t len;
 	int fd;
-	uint8_t data[0];
+	/* whether data is a DMA buffer reserved with txbuf_reserve() */
+	bool dma;
+	/* cleared once we know the device doesn't support DMA buffers */
+	bool dma_ok;
+	uint8_t *data;
 };
 
-static struct printf_buf *printf_buf_create(int fd)
+/*
+ * Only reserve a DMA buffer if try_dma is true, which is the case after a
+ * previous buffer ran full.  Most calls print less than CONFIG_PRINTF_BUFSZ
+ * bytes, and those are better off being merged into the device's pending
+ * transfer by write() than being sent as a separate DMA buffer each.
+ */
+static int printf_buf_init(struct printf_buf *buf, int fd, bool try_dma)
 {
-	struct printf_buf *buf = malloc(sizeof(*buf) + CONFIG_PRINTF_BUFSZ);
+	buf->len = 0;
+	buf->fd = fd;
+
+	/* format straight into the device's buffer if it supports that */
+	buf->dma = try_dma && buf->dma_ok
+		&& txbuf_reserve(fd, CONFIG_PRINTF_BUFSZ, (void **)&buf->data) == 0;
+	if (try_dma && !buf->dma)
+		buf->dma_ok = false;
+	if (!buf->dma) {
+		buf->data = malloc(CONFIG_PRINTF_BUFSZ);
+		if (buf->data == NULL)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
 
-	if (buf != NULL) {
-		buf->len = 0;
-		buf->fd = fd;
+static ssize_t printf_buf_flush(struct printf_buf *buf)
+{
+	size_t done = 0;
+
+	/*
+	 * TODO: We don't need to take the syscall detour
+	 *       if we are already in kernel context
+	 */
+	while (done < buf->len) {
+		ssize_t write_ret = write(buf->fd, &buf->data[done], buf->len - done);
+		if (write_ret <= 0) {
+			/*
+			 * assume something has failed spectacularly
+			 * if write() didn't even write a single byte
+			 */
+			return write_ret == 0 ? -EIO : write_ret;
+		}
+		done += (size_t)write_ret;
 	}
 
-	return buf;
+	return (ssize_t)done;
 }
 
-static ssize_t printf_buf_destroy(struct printf_buf *buf)
+/* write out everything in the buffer and release it */
+static ssize_t printf_buf_release(struct printf_buf *buf)
 {
 	ssize_t ret = 0;
 
-	if (buf->len != 0)
-		ret = write(buf->fd, &buf->data[0], buf->len);
+	if (buf->data == NULL)
+		return 0;
+
+	if (buf->dma) {
+		if (buf->len >= PRINTF_DMA_THRESHOLD) {
+			ret = txbuf_commit(buf->len);
+		} else {
+			/* the tail of a long output, copy it so it can be merged */
+			ret = printf_buf_flush(buf);
+			txbuf_commit(0);
+		}
+	} else {
+		ret = printf_buf_flush(buf);
+		free(buf->data);
+	}
 
-	free(buf);
+	buf->data = NULL;
 	return ret;
 }
 
@@ -61,28 +123,16 @@ static ssize_t printf_buf_write(struct printf_buf *buf, const void *data, size_t
 	while (ret != (ssize_t)len) {
 		if (buf->len == CONFIG_PRINTF_BUFSZ) {
 			/*
-			 * TODO: We don't need to take the syscall detour
-			 *       if we are already in kernel context
+			 * a committed DMA buffer is gone, so always start a new one;
+			 * this output is long enough to be worth the zero-copy path
 			 */
-			ssize_t write_ret = write(buf->fd, buf->data, buf->len);
-			if (write_ret < 0) {
-				ret = write_ret;
+			ssize_t flush_ret = printf_buf_release(buf);
+			if (flush_ret >= 0)
+				flush_ret = printf_buf_init(buf, buf->fd, true);
+			if (flush_ret < 0) {
+				ret = flush_ret;
 				break;
 			}
-
-			if (write_ret == 0) {
-				/*
-				 * assume something has failed spectacularly
-				 * if write() didn't even write a single byte
-				 */
-				ret = -EIO;
-				break;
-			}
-
-			if (write_ret != (ssize_t)buf->len)
-				memmove(buf->data, &buf->data[write_ret], buf->len - write_ret);
-
-			buf->len -= write_ret;
 		}
 
 		buf->data[buf->len++] = *tmp++;
@@ -212,9 +262,11 @@ int vfprintf(FILE *f, const char *fmt, va_list args)
 {
 	ssize_t ret = 0;
 	const char *tmp = fmt;
-	struct printf_buf *buf = printf_buf_create(_file_to_fd(f));
+	struct printf_buf _buf;
+	struct printf_buf *buf = &_buf;
 
-	if (buf == NULL)
+	buf->dma_ok = true;
+	if (printf_buf_init(buf, _file_to_fd(f), false) != 0)
 		return -ENOMEM;
 
 	while (*tmp != '\0') {
@@ -243,7 +295,7 @@ int vfprintf(FILE *f, const char *fmt, va_list args)
 	if (tmp != fmt && ret >= 0)
 		ret += printf_buf_write(buf, fmt, (size_t)tmp - (size_t)fmt);
 
-	ssize_t tmpret = printf_buf_destroy(buf);
+	ssize_t tmpret = printf_buf_release(buf);
 	if (tmpret < 0)
 		ret = tmpret;
 
@@ -0,0 +1,56 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/syscall.h>
+
+#include <termios.h>
+
+int tcgetattr(int fildes, struct termios *termios_p)
+{
+	return (int)syscall(SYS_tcgetattr, (sysarg_t)fildes, (sysarg_t)termios_p);
+}
+
+int tcsetattr(int fildes, int optional_actions, const struct termios *termios_p)
+{
+	return (int)syscall(SYS_tcsetattr, (sysarg_t)fildes, (sysarg_t)optional_actions,
+			    (sysarg_t)termios_p);
+}
+
+int tcgetstats(int fildes, struct tcstats *stats)
+{
+	return (int)syscall(SYS_tcgetstats, (sysarg_t)fildes, (sysarg_t)stats);
+}
+
+speed_t cfgetispeed(const struct termios *termios_p)
+{
+	return termios_p->c_ispeed;
+}
+
+speed_t cfgetospeed(const struct termios *termios_p)
+{
+	return termios_p->c_ospeed;
+}
+
+int cfsetispeed(struct termios *termios_p, speed_t speed)
+{
+	termios_p->c_ispeed = speed;
+	return 0;
+}
+
+int cfsetospeed(struct termios *termios_p, speed_t speed)
+{
+	termios_p->c_ospeed = speed;
+	return 0;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
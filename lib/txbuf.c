@@ -0,0 +1,28 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/syscall.h>
+
+#include <txbuf.h>
+
+int txbuf_reserve(int fildes, size_t len, void **data)
+{
+	return (int)syscall(SYS_txbuf_reserve, (sysarg_t)fildes, (sysarg_t)len, (sysarg_t)data);
+}
+
+ssize_t txbuf_commit(size_t len)
+{
+	return (ssize_t)syscall(SYS_txbuf_commit, (sysarg_t)len);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
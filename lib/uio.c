@@ -0,0 +1,28 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/syscall.h>
+
+#include <sys/uio.h>
+
+ssize_t readv(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return syscall(SYS_readv, (sysarg_t)fildes, (sysarg_t)iov, (sysarg_t)iovcnt);
+}
+
+ssize_t writev(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return syscall(SYS_writev, (sysarg_t)fildes, (sysarg_t)iov, (sysarg_t)iovcnt);
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
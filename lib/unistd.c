@@ -14,6 +14,31 @@ ssize_t write(int fildes, const void *buf, size_t nbyte)
 	return syscall(SYS_write, (sysarg_t)fildes, (sysarg_t)buf, (sysarg_t)nbyte);
 }
 
+int close(int fildes)
+{
+	return (int)syscall(SYS_close, (sysarg_t)fildes);
+}
+
+int pipe(int fildes[2])
+{
+	return (int)syscall(SYS_pipe, (sysarg_t)fildes);
+}
+
+ssize_t splice(int fd_in, int fd_out, size_t len)
+{
+	return syscall(SYS_splice, (sysarg_t)fd_in, (sysarg_t)fd_out, (sysarg_t)len);
+}
+
+int bcast(int fildes[], unsigned int nreaders)
+{
+	return (int)syscall(SYS_bcast, (sysarg_t)fildes, (sysarg_t)nreaders);
+}
+
+off_t lseek(int fildes, off_t offset, int whence)
+{
+	return (off_t)syscall(SYS_lseek, (sysarg_t)fildes, (sysarg_t)offset, (sysarg_t)whence);
+}
+
 ssize_t sleep(unsigned long int millis)
 {
 	return syscall(SYS_sleep, (sysarg_t)millis);
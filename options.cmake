@@ -23,10 +23,77 @@ set_property(CACHE CONFIG_SERIAL_BAUD PROPERTY STRINGS
 	1200 2400 4800 9600 19200 38400 57600 115200
 )
 
-set(CONFIG_SERIAL_BUFSZ 256 CACHE STRING "Default serial buffer size in bytes")
+set(CONFIG_SERIAL_BUFSZ 256 CACHE STRING "Default serial buffer size in bytes (power of two)")
+
+set(CONFIG_SERIAL_TXBUFSZ 128 CACHE STRING "Minimum size of queued serial TX buffers that small writes are merged into")
+
+set(CONFIG_SERIAL_DMAPOOL_COUNT 4 CACHE STRING "Number of preallocated serial TX DMA buffers (at most 32)")
+
+set(CONFIG_SERIAL_DMAPOOL_BUFSZ 256 CACHE STRING "Size of each preallocated serial TX DMA buffer in bytes")
+
+set(CONFIG_SERIAL_RXDMA_BUFSZ 64 CACHE STRING "Size of each of the two serial RX DMA buffers in bytes")
+
+set(CONFIG_SERIAL_RX_IDLE_CHARS 4 CACHE STRING "Flush partial serial RX DMA buffers once the line has been idle for this many character times")
+
+set(CONFIG_SERIAL_USART_BAUD 921600 CACHE STRING "Default baud rate of the USART serial ports")
+set_property(CACHE CONFIG_SERIAL_USART_BAUD PROPERTY STRINGS
+	9600 19200 38400 57600 115200 230400 460800 921600 1000000 2000000 3000000 4000000
+)
+
+set(CONFIG_SERIAL_USART_BUFSZ 1024 CACHE STRING "Default USART serial buffer size in bytes (power of two)")
+
+set(CONFIG_SERIAL_USART_RXDMA_BUFSZ 256 CACHE STRING "Default size of each of the two USART RX DMA buffers in bytes")
+
+set(CONFIG_SERIAL_USART_RX_IDLE_CHARS 16 CACHE STRING "Default amount of idle character times after which partial USART RX DMA buffers are flushed (at most 6553)")
+
+# USART0-3 (ttyS1-ttyS4) start out with the defaults above, but can be set up individually
+foreach(usart 0 1 2 3)
+	set(CONFIG_SERIAL_USART${usart}_BAUD ${CONFIG_SERIAL_USART_BAUD} CACHE STRING "Baud rate of USART${usart}")
+	set(CONFIG_SERIAL_USART${usart}_BUFSZ ${CONFIG_SERIAL_USART_BUFSZ} CACHE STRING "USART${usart} serial buffer size in bytes (power of two)")
+	set(CONFIG_SERIAL_USART${usart}_RXDMA_BUFSZ ${CONFIG_SERIAL_USART_RXDMA_BUFSZ} CACHE STRING "Size of each of the two USART${usart} RX DMA buffers in bytes")
+	set(CONFIG_SERIAL_USART${usart}_RX_IDLE_CHARS ${CONFIG_SERIAL_USART_RX_IDLE_CHARS} CACHE STRING "Flush partial USART${usart} RX DMA buffers once the line has been idle for this many character times")
+endforeach()
+
+set(CONFIG_SERIAL_LOOPBACK_PORT 0 CACHE STRING "Serial port (ttySn) with TX wired to RX to test all baud rates on at boot, 0 to disable")
+
+set(CONFIG_PIPE_BUFSZ 512 CACHE STRING "Pipe buffer size in bytes (power of two)")
+
+set(CONFIG_BCAST_BUFSZ 512 CACHE STRING "Broadcast ring size in bytes (power of two)")
 
 set(CONFIG_PRINTF_BUFSZ 64 CACHE STRING "Default buffer size for printf() and friends")
 
+set(CONFIG_IO_BOUNCE_BUFSZ 64 CACHE STRING "Chunk size for I/O on devices that cannot access user memory")
+
+set(CONFIG_SPLICE_BUFSZ 256 CACHE STRING "Chunk size for splice() in bytes")
+
+set(CONFIG_DMA_MEMCPY_MIN 512 CACHE STRING "Minimum size in bytes for copies to be offloaded to the DMA controller")
+
+set(CONFIG_IORING_MAXPENDING 8 CACHE STRING "Maximum number of asynchronous I/O requests in flight per task")
+
+set(CONFIG_PATH_MAX 64 CACHE STRING "Maximum length of a path name in bytes, including the NUL terminator")
+
+set(CONFIG_TMPFS_NAMELEN 15 CACHE STRING "Maximum length of a file name in the in-memory filesystem")
+
+set(CONFIG_TMPFS_EXTENT_SIZE 256 CACHE STRING "Allocation unit for file contents in the in-memory filesystem")
+
+set(CONFIG_BLOCK_SECTOR_SIZE 512 CACHE STRING "Maximum sector size of block devices in bytes")
+
+set(CONFIG_BLOCK_CACHE_SIZE 8 CACHE STRING "Number of sectors in the block device cache")
+
+set(CONFIG_BLOCK_READAHEAD 4 CACHE STRING "Number of sectors to read ahead on sequential access")
+
+set(CONFIG_FLASHFS_PAGES 128 CACHE STRING "Number of flash pages reserved for the flash filesystem")
+
+set(CONFIG_FLASHFS_MAXFILES 16 CACHE STRING "Maximum number of files in the flash filesystem")
+
+set(CONFIG_FLASHFS_NAMELEN 15 CACHE STRING "Maximum length of a file name in the flash filesystem")
+
+set(CONFIG_KVSTORE_PAGES 16 CACHE STRING "Number of flash pages reserved for the key-value store (must be even)")
+
+set(CONFIG_KVSTORE_MAXKEYS 32 CACHE STRING "Maximum number of keys in the key-value store")
+
+set(CONFIG_KVSTORE_KEYLEN 31 CACHE STRING "Maximum length of a key in the key-value store")
+
 option(CONFIG_CHECK_SYSCALL_SOURCE "Prohibit inline syscalls" OFF)
 
 # This file is part of Ardix.
@@ -0,0 +1,318 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/*
+ * Write-back caching, read-ahead and eviction of the block layer, on top of a
+ * RAM disk whose backend requests are recorded.  The source is included
+ * directly so the tests can look at the cache itself.
+ */
+
+#include "../kernel/block.c"
+
+#include <ardix/ramdisk.h>
+
+#include "test.h"
+
+#if CONFIG_BLOCK_READAHEAD + 1 >= CONFIG_BLOCK_CACHE_SIZE
+#error "These tests need a cache that is larger than a read-ahead request"
+#endif
+
+#define SECTOR_SIZE 512
+#define SECTOR_COUNT 128
+
+struct request {
+	uint32_t sector;
+	unsigned int count;
+};
+
+static struct request reads[16];
+static unsigned int read_count;
+static struct request writes[16];
+static unsigned int write_count;
+static bool read_fails;
+
+static int (*ramdisk_read_orig)(struct block_device *bdev, uint32_t sector, void *const bufs[],
+				unsigned int count);
+static int (*ramdisk_write_orig)(struct block_device *bdev, uint32_t sector,
+				 const void *const bufs[], unsigned int count);
+
+static void record(struct request *log, unsigned int *log_count, uint32_t sector,
+		   unsigned int count)
+{
+	if (*log_count < 16) {
+		log[*log_count].sector = sector;
+		log[*log_count].count = count;
+	}
+	(*log_count)++;
+}
+
+static int recording_read(struct block_device *bdev, uint32_t sector, void *const bufs[],
+			  unsigned int count)
+{
+	record(reads, &read_count, sector, count);
+	if (read_fails)
+		return -EIO;
+	return ramdisk_read_orig(bdev, sector, bufs, count);
+}
+
+static int recording_write(struct block_device *bdev, uint32_t sector, const void *const bufs[],
+			   unsigned int count)
+{
+	record(writes, &write_count, sector, count);
+	return ramdisk_write_orig(bdev, sector, bufs, count);
+}
+
+static void clear_log(void)
+{
+	read_count = 0;
+	write_count = 0;
+}
+
+static void check_request(const struct request *req, uint32_t sector, unsigned int count)
+{
+	TEST_ASSERT_EQ(req->sector, sector);
+	TEST_ASSERT_EQ(req->count, count);
+}
+
+/* drop everything the previous test left in the cache and start over */
+static struct block_device *setup(void)
+{
+	static struct block_device *prev = NULL;
+	int err;
+
+	if (prev != NULL) {
+		for (unsigned int i = 0; i < CONFIG_BLOCK_CACHE_SIZE; i++) {
+			if (block_cache[i].bdev == prev)
+				block_buf_release(&block_cache[i]);
+		}
+		device_put(&prev->device);
+	}
+
+	struct block_device *bdev = ramdisk_create(SECTOR_SIZE, SECTOR_COUNT, &err);
+	TEST_ASSERT_EQ(err, 0);
+	ramdisk_read_orig = bdev->read;
+	ramdisk_write_orig = bdev->write;
+	bdev->read = recording_read;
+	bdev->write = recording_write;
+
+	read_fails = false;
+	clear_log();
+
+	prev = bdev;
+	return bdev;
+}
+
+static void fill_sector(uint8_t *data, uint32_t sector)
+{
+	memset(data, (int)(sector + 1), SECTOR_SIZE);
+}
+
+static void write_sectors(struct block_device *bdev, uint32_t sector, unsigned int count)
+{
+	uint8_t data[4 * SECTOR_SIZE];
+
+	for (unsigned int i = 0; i < count; i++)
+		fill_sector(&data[i * SECTOR_SIZE], sector + i);
+
+	TEST_ASSERT_EQ(block_device_write(&bdev->device, data, count * SECTOR_SIZE,
+					  sector * SECTOR_SIZE), count * SECTOR_SIZE);
+}
+
+static ssize_t read_sector(struct block_device *bdev, uint32_t sector)
+{
+	uint8_t data[SECTOR_SIZE];
+
+	return block_device_read(data, &bdev->device, SECTOR_SIZE, sector * SECTOR_SIZE);
+}
+
+/* check what the backend has stored, bypassing the cache */
+static void check_backend(struct block_device *bdev, uint32_t sector)
+{
+	uint8_t expected[SECTOR_SIZE];
+	uint8_t data[SECTOR_SIZE];
+	void *bufs[] = { data };
+
+	fill_sector(expected, sector);
+	TEST_ASSERT_EQ(ramdisk_read_orig(bdev, sector, bufs, 1), 0);
+	TEST_ASSERT(memcmp(data, expected, SECTOR_SIZE) == 0);
+}
+
+static bool is_cached(struct block_device *bdev, uint32_t sector)
+{
+	return block_cache_find(bdev, sector) != NULL;
+}
+
+static void check_lru(void)
+{
+	unsigned int count = 0;
+	struct block_buf *cursor;
+
+	list_for_each_entry(&block_lru, cursor, lru)
+		count++;
+	TEST_ASSERT_EQ(count, CONFIG_BLOCK_CACHE_SIZE);
+}
+
+static void test_coalesce(void)
+{
+	struct block_device *bdev = setup();
+
+	/* out of order and in separate requests, only full sectors */
+	write_sectors(bdev, 4, 1);
+	write_sectors(bdev, 2, 2);
+	write_sectors(bdev, 7, 1);
+	write_sectors(bdev, 5, 1);
+	TEST_ASSERT_EQ(read_count, 0);
+	TEST_ASSERT_EQ(write_count, 0);
+
+	TEST_ASSERT_EQ(block_sync(bdev), 0);
+	TEST_ASSERT_EQ(write_count, 2);
+	check_request(&writes[0], 2, 4);
+	check_request(&writes[1], 7, 1);
+	for (uint32_t sector = 2; sector < 6; sector++)
+		check_backend(bdev, sector);
+	check_backend(bdev, 7);
+
+	/* nothing is dirty anymore */
+	TEST_ASSERT_EQ(block_sync(bdev), 0);
+	TEST_ASSERT_EQ(write_count, 2);
+}
+
+static void test_readahead(void)
+{
+	struct block_device *bdev = setup();
+
+	/* the first read continues where the (nonexistent) previous one ended */
+	TEST_ASSERT_EQ(read_sector(bdev, 0), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_count, 1);
+	check_request(&reads[0], 0, CONFIG_BLOCK_READAHEAD + 1);
+
+	/* those are all cache hits */
+	for (uint32_t sector = 1; sector <= CONFIG_BLOCK_READAHEAD; sector++)
+		TEST_ASSERT_EQ(read_sector(bdev, sector), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_count, 1);
+
+	/* and the next miss reads ahead again */
+	TEST_ASSERT_EQ(read_sector(bdev, CONFIG_BLOCK_READAHEAD + 1), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_count, 2);
+	check_request(&reads[1], CONFIG_BLOCK_READAHEAD + 1, CONFIG_BLOCK_READAHEAD + 1);
+
+	/* random access doesn't */
+	clear_log();
+	TEST_ASSERT_EQ(read_sector(bdev, 40), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_count, 1);
+	check_request(&reads[0], 40, 1);
+
+	/* read-ahead stops at the first sector that is already cached */
+	TEST_ASSERT_EQ(read_sector(bdev, 43), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, 40), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, 41), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_count, 3);
+	check_request(&reads[2], 41, 2);
+
+	/* neither does a partial write right behind the last read */
+	uint8_t byte = 0xaa;
+	clear_log();
+	TEST_ASSERT_EQ(read_sector(bdev, 60), SECTOR_SIZE);
+	TEST_ASSERT_EQ(block_device_write(&bdev->device, &byte, 1, 61 * SECTOR_SIZE + 3), 1);
+	TEST_ASSERT_EQ(read_count, 2);
+	check_request(&reads[1], 61, 1);
+	TEST_ASSERT(!is_cached(bdev, 62));
+
+	/* close to the end, only the remaining sectors are read */
+	clear_log();
+	TEST_ASSERT_EQ(read_sector(bdev, SECTOR_COUNT - 3), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, SECTOR_COUNT - 2), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, SECTOR_COUNT - 1), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, SECTOR_COUNT), 0);
+	TEST_ASSERT_EQ(read_count, 2);
+	check_request(&reads[1], SECTOR_COUNT - 2, 2);
+}
+
+static void test_evict_writeback(void)
+{
+	struct block_device *bdev = setup();
+
+	write_sectors(bdev, 0, 2);
+
+	/* fill up the rest of the cache, the dirty sectors stay */
+	for (uint32_t i = 0; i < CONFIG_BLOCK_CACHE_SIZE - 2; i++)
+		TEST_ASSERT_EQ(read_sector(bdev, 10 + 2 * i), SECTOR_SIZE);
+	TEST_ASSERT_EQ(write_count, 0);
+	TEST_ASSERT(is_cached(bdev, 0));
+	TEST_ASSERT(is_cached(bdev, 1));
+
+	/* evicting the first one writes back both of them */
+	TEST_ASSERT_EQ(read_sector(bdev, 100), SECTOR_SIZE);
+	TEST_ASSERT_EQ(write_count, 1);
+	check_request(&writes[0], 0, 2);
+	TEST_ASSERT(!is_cached(bdev, 0));
+	check_backend(bdev, 0);
+	check_backend(bdev, 1);
+
+	/* so the second one is clean by the time it gets evicted */
+	TEST_ASSERT_EQ(read_sector(bdev, 102), SECTOR_SIZE);
+	TEST_ASSERT(!is_cached(bdev, 1));
+	TEST_ASSERT_EQ(write_count, 1);
+
+	/* recently used sectors are evicted last */
+	TEST_ASSERT_EQ(read_sector(bdev, 10), SECTOR_SIZE);
+	TEST_ASSERT_EQ(read_sector(bdev, 104), SECTOR_SIZE);
+	TEST_ASSERT(is_cached(bdev, 10));
+	TEST_ASSERT(!is_cached(bdev, 12));
+	check_lru();
+}
+
+static void test_read_error(void)
+{
+	struct block_device *bdev = setup();
+
+	for (uint32_t i = 0; i < CONFIG_BLOCK_CACHE_SIZE; i++)
+		TEST_ASSERT_EQ(read_sector(bdev, 40 + 2 * i), SECTOR_SIZE);
+	uint32_t next = 40 + 2 * (CONFIG_BLOCK_CACHE_SIZE - 1) + 1;
+
+	/* a sequential read evicts the oldest sectors for read-ahead, then fails */
+	read_fails = true;
+	clear_log();
+	TEST_ASSERT_EQ(read_sector(bdev, next), -EIO);
+	TEST_ASSERT_EQ(read_count, 1);
+	check_request(&reads[0], next, CONFIG_BLOCK_READAHEAD + 1);
+	for (uint32_t i = 0; i < CONFIG_BLOCK_READAHEAD + 1; i++) {
+		TEST_ASSERT(!is_cached(bdev, 40 + 2 * i));
+		TEST_ASSERT(!is_cached(bdev, next + i));
+	}
+	for (uint32_t i = CONFIG_BLOCK_READAHEAD + 1; i < CONFIG_BLOCK_CACHE_SIZE; i++)
+		TEST_ASSERT(is_cached(bdev, 40 + 2 * i));
+	check_lru();
+
+	/* the buffers that were taken are unused now and get recycled first */
+	read_fails = false;
+	for (uint32_t i = 0; i < CONFIG_BLOCK_READAHEAD + 1; i++)
+		TEST_ASSERT_EQ(read_sector(bdev, 100 + 2 * i), SECTOR_SIZE);
+	for (uint32_t i = CONFIG_BLOCK_READAHEAD + 1; i < CONFIG_BLOCK_CACHE_SIZE; i++)
+		TEST_ASSERT(is_cached(bdev, 40 + 2 * i));
+	check_lru();
+}
+
+int main(void)
+{
+	test_init();
+
+	TEST_RUN(test_coalesce);
+	TEST_RUN(test_readahead);
+	TEST_RUN(test_evict_writeback);
+	TEST_RUN(test_read_error);
+
+	return TEST_STATUS();
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
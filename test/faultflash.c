@@ -0,0 +1,129 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <ardix/flash.h>
+#include <ardix/kent.h>
+#include <ardix/ramflash.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "faultflash.h"
+#include "test.h"
+
+unsigned int faultflash_erases[FLASH_STORAGE_PAGES];
+
+static int (*faultflash_program_orig)(struct flash *flash, unsigned int page, const void *src);
+static int (*faultflash_write_orig)(struct flash *flash, unsigned int page, size_t offset,
+				    const void *src, size_t len);
+
+static bool faultflash_armed = false;
+static bool faultflash_dead = false;
+static unsigned int faultflash_remaining;
+
+/* returns true if the current operation is the one that gets torn */
+static bool faultflash_tear(void)
+{
+	if (!faultflash_armed)
+		return false;
+	if (faultflash_remaining != 0) {
+		faultflash_remaining--;
+		return false;
+	}
+
+	faultflash_armed = false;
+	faultflash_dead = true;
+	return true;
+}
+
+static int faultflash_program(struct flash *flash, unsigned int page, const void *src)
+{
+	if (faultflash_dead)
+		return -EIO;
+
+	faultflash_erases[page]++;
+	if (!faultflash_tear())
+		return faultflash_program_orig(flash, page, src);
+
+	/* the page got erased, but programming stopped halfway through */
+	uint32_t buf[FAULTFLASH_PAGE_SIZE / sizeof(uint32_t)];
+	memset(buf, 0xff, sizeof(buf));
+	memcpy(buf, src, FAULTFLASH_PAGE_SIZE / 2);
+	faultflash_program_orig(flash, page, buf);
+	return -EIO;
+}
+
+static int faultflash_write(struct flash *flash, unsigned int page, size_t offset,
+			    const void *src, size_t len)
+{
+	if (faultflash_dead)
+		return -EIO;
+
+	if (!faultflash_tear())
+		return faultflash_write_orig(flash, page, offset, src, len);
+
+	size_t half = (len / 2) & ~(sizeof(uint32_t) - 1);
+	if (half != 0)
+		faultflash_write_orig(flash, page, offset, src, half);
+	return -EIO;
+}
+
+struct flash *faultflash_create(void)
+{
+	int err;
+
+	struct flash *flash = ramflash_create(FAULTFLASH_PAGE_SIZE, FLASH_STORAGE_PAGES, &err);
+	TEST_ASSERT_EQ(err, 0);
+	if (flash == NULL)
+		return NULL;
+
+	faultflash_program_orig = flash->program;
+	faultflash_write_orig = flash->write;
+	flash->program = faultflash_program;
+	flash->write = faultflash_write;
+
+	memset(faultflash_erases, 0, sizeof(faultflash_erases));
+	faultflash_repair();
+
+	flash_storage = flash;
+	return flash;
+}
+
+void faultflash_destroy(void)
+{
+	if (flash_storage != NULL)
+		kent_put(&flash_storage->device.kent);
+	flash_storage = NULL;
+}
+
+void faultflash_tear_after(unsigned int ops)
+{
+	faultflash_armed = true;
+	faultflash_remaining = ops;
+}
+
+bool faultflash_torn(void)
+{
+	return faultflash_dead;
+}
+
+void faultflash_repair(void)
+{
+	faultflash_armed = false;
+	faultflash_dead = false;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,57 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <ardix/flash.h>
+
+#include <stdbool.h>
+
+/**
+ * @file faultflash.h
+ * @brief RAM storage area that can simulate a power loss while programming.
+ *
+ * This wraps a `ramflash_create()` storage area of `FLASH_STORAGE_PAGES`
+ * pages and counts how often every page is erased.  After a tear has been
+ * armed with `faultflash_tear_after()`, the operation that triggers it only
+ * programs the first half of its data, and every operation after that fails
+ * with `-EIO` until `faultflash_repair()` is called.  This is the state the
+ * storage area is in after the system lost power in the middle of a write,
+ * so the next step is usually to mount it again.
+ */
+
+/** @brief Size of a single page, the same as on the Arduino Due. */
+#define FAULTFLASH_PAGE_SIZE 256
+
+/** @brief How often every page has been erased since `faultflash_create()`. */
+extern unsigned int faultflash_erases[FLASH_STORAGE_PAGES];
+
+/** @brief Create the storage area and install it in `flash_storage`. */
+struct flash *faultflash_create(void);
+
+/** @brief Release the storage area and reset `flash_storage`. */
+void faultflash_destroy(void);
+
+/**
+ * @brief Let `ops` more program or write operations succeed, and tear the
+ * one after that.
+ */
+void faultflash_tear_after(unsigned int ops);
+
+/** @brief Whether the armed tear has happened. */
+bool faultflash_torn(void);
+
+/** @brief Disarm the tear and make the storage area usable again. */
+void faultflash_repair(void);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
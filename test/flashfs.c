@@ -0,0 +1,284 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/*
+ * Mount-time recovery and wear rotation of the flash filesystem.  The source
+ * is included directly so the tests can inspect the index in RAM.
+ */
+
+#include "../kernel/fs/flashfs.c"
+
+#include <stdlib.h>
+
+#include "faultflash.h"
+#include "test.h"
+
+#define BLOCK (FAULTFLASH_PAGE_SIZE - sizeof(struct flashfs_record))
+
+static uint8_t buf[4 * BLOCK];
+
+static void fill(uint8_t *dest, size_t len, uint8_t seed)
+{
+	for (size_t i = 0; i < len; i++)
+		dest[i] = (uint8_t)(seed + i * 7);
+}
+
+/* release everything flashfs_init() allocated, like a reboot */
+static void unmount(void)
+{
+	if (flashfs_flash == NULL)
+		return;
+
+	for (unsigned int i = 0; i < CONFIG_FLASHFS_MAXFILES; i++)
+		kfree(flashfs_inodes[i].blocks);
+	kfree(flashfs_live);
+	kfree(flashfs_page);
+	flashfs_flash = NULL;
+}
+
+static int mount(void)
+{
+	unmount();
+	return flashfs_init();
+}
+
+static void setup(void)
+{
+	unmount();
+	faultflash_destroy();
+	faultflash_create();
+	TEST_ASSERT_EQ(mount(), 0);
+}
+
+static struct file *open_file(const char *name, int flags, int *err)
+{
+	return flashfs_open(name, flags, err);
+}
+
+static ssize_t write_at(struct file *file, const void *src, size_t len, off_t offset)
+{
+	return file->device->write(file->device, src, len, offset);
+}
+
+static ssize_t read_at(struct file *file, void *dest, size_t len, off_t offset)
+{
+	return file->device->read(dest, file->device, len, offset);
+}
+
+/* create a file with `len` bytes of pattern `seed` and close it */
+static void create_file(const char *name, size_t len, uint8_t seed)
+{
+	int err;
+	uint8_t data[sizeof(buf)];
+
+	fill(data, len, seed);
+	struct file *file = open_file(name, O_CREAT | O_TRUNC | O_WRONLY, &err);
+	TEST_ASSERT_EQ(err, 0);
+	if (file == NULL)
+		return;
+	TEST_ASSERT_EQ(write_at(file, data, len, 0), len);
+	file_put(file);
+}
+
+/* check that file `name` holds exactly `len` bytes of pattern `seed` */
+static void check_file(const char *name, size_t len, uint8_t seed)
+{
+	int err;
+	uint8_t expected[sizeof(buf)];
+
+	struct file *file = open_file(name, O_RDONLY, &err);
+	TEST_ASSERT_EQ(err, 0);
+	if (file == NULL)
+		return;
+
+	fill(expected, len, seed);
+	memset(buf, 0, sizeof(buf));
+	TEST_ASSERT_EQ(file->device->size(file->device), len);
+	TEST_ASSERT_EQ(read_at(file, buf, sizeof(buf), 0), len);
+	TEST_ASSERT(memcmp(buf, expected, len) == 0);
+	file_put(file);
+}
+
+static void test_remount(void)
+{
+	setup();
+
+	create_file("a", 3 * BLOCK + 10, 1);
+	create_file("b", 5, 2);
+
+	TEST_ASSERT_EQ(mount(), 0);
+	check_file("a", 3 * BLOCK + 10, 1);
+	check_file("b", 5, 2);
+	/* two inode records and five data records */
+	TEST_ASSERT_EQ(flashfs_free, CONFIG_FLASHFS_PAGES - 7);
+}
+
+static void test_torn_data_record(void)
+{
+	int err;
+	uint8_t data[BLOCK];
+
+	setup();
+	create_file("a", 2 * BLOCK, 1);
+
+	/* overwrite the first block and lose power while it is being programmed */
+	struct file *file = open_file("a", O_WRONLY, &err);
+	TEST_ASSERT_EQ(err, 0);
+	fill(data, sizeof(data), 9);
+	TEST_ASSERT_EQ(write_at(file, data, sizeof(data), 0), sizeof(data));
+	faultflash_tear_after(0);
+	file_put(file);
+	TEST_ASSERT(faultflash_torn());
+
+	faultflash_repair();
+	TEST_ASSERT_EQ(mount(), 0);
+	/* the old version of the block is still there */
+	check_file("a", 2 * BLOCK, 1);
+	/* and the torn page is free again */
+	TEST_ASSERT_EQ(flashfs_free, CONFIG_FLASHFS_PAGES - 3);
+
+	/* the file is fully usable after recovery */
+	create_file("a", BLOCK, 9);
+	TEST_ASSERT_EQ(mount(), 0);
+	check_file("a", BLOCK, 9);
+}
+
+static void test_torn_inode_record(void)
+{
+	int err;
+
+	setup();
+	create_file("a", BLOCK + 1, 1);
+
+	/* creating a file only writes its inode record */
+	faultflash_tear_after(0);
+	TEST_ASSERT(open_file("b", O_CREAT | O_WRONLY, &err) == NULL);
+	TEST_ASSERT_EQ(err, -EIO);
+	faultflash_repair();
+
+	/* truncating a file only writes its inode record, too */
+	faultflash_tear_after(0);
+	TEST_ASSERT(open_file("a", O_TRUNC | O_WRONLY, &err) == NULL);
+	TEST_ASSERT_EQ(err, -EIO);
+	faultflash_repair();
+
+	TEST_ASSERT_EQ(mount(), 0);
+	TEST_ASSERT(open_file("b", O_RDONLY, &err) == NULL);
+	TEST_ASSERT_EQ(err, -ENOENT);
+	check_file("a", BLOCK + 1, 1);
+	TEST_ASSERT_EQ(flashfs_free, CONFIG_FLASHFS_PAGES - 3);
+}
+
+static void test_stale_records(void)
+{
+	setup();
+
+	/* data records written before truncation must not come back */
+	create_file("a", 3 * BLOCK, 1);
+	create_file("a", 5, 2);
+	/* superseded versions of the same block */
+	for (uint8_t i = 0; i < 4; i++)
+		create_file("b", BLOCK, i);
+
+	TEST_ASSERT_EQ(mount(), 0);
+	check_file("a", 5, 2);
+	check_file("b", BLOCK, 3);
+
+	struct flashfs_inode *inode = flashfs_lookup("a");
+	TEST_ASSERT(inode != NULL);
+	for (unsigned int block = 1; inode != NULL && block < inode->block_count; block++)
+		TEST_ASSERT_EQ(inode->blocks[block], FLASHFS_NO_PAGE);
+
+	/* one inode and one data record per file, everything else is free */
+	TEST_ASSERT_EQ(flashfs_free, CONFIG_FLASHFS_PAGES - 4);
+	unsigned int live = 0;
+	for (unsigned int page = 0; page < CONFIG_FLASHFS_PAGES; page++)
+		live += flashfs_live[page];
+	TEST_ASSERT_EQ(live, 4);
+}
+
+static void test_wear_rotation(void)
+{
+	int err;
+	const unsigned int rounds = 10;
+	uint8_t data[BLOCK];
+
+	setup();
+	/* long-lived data, these pages never rotate */
+	create_file("cold", 4 * BLOCK, 1);
+	create_file("hot", BLOCK, 2);
+	struct flashfs_inode *hot = flashfs_lookup("hot");
+	TEST_ASSERT(hot != NULL);
+	if (hot == NULL)
+		return;
+
+	unsigned int erases[CONFIG_FLASHFS_PAGES];
+	memcpy(erases, faultflash_erases, sizeof(erases));
+
+	for (unsigned int i = 0; i < rounds * CONFIG_FLASHFS_PAGES; i++) {
+		if (i == rounds * CONFIG_FLASHFS_PAGES / 2) {
+			/* rotation continues after the newest record when remounting */
+			uint16_t last = hot->blocks[0];
+			TEST_ASSERT_EQ(mount(), 0);
+			hot = flashfs_lookup("hot");
+			TEST_ASSERT_EQ(hot->blocks[0], last);
+			TEST_ASSERT_EQ(flashfs_head, (last + 1u) % CONFIG_FLASHFS_PAGES);
+		}
+
+		struct file *file = open_file("hot", O_WRONLY, &err);
+		fill(data, sizeof(data), (uint8_t)i);
+		TEST_ASSERT_EQ(write_at(file, data, sizeof(data), 0), sizeof(data));
+		file_put(file);
+	}
+
+	unsigned int min = UINT32_MAX;
+	unsigned int max = 0;
+	for (unsigned int page = 0; page < CONFIG_FLASHFS_PAGES; page++) {
+		unsigned int count = faultflash_erases[page] - erases[page];
+		bool is_static = page == hot->inode_page;
+		for (unsigned int block = 0; block < 4; block++)
+			is_static |= page == flashfs_lookup("cold")->blocks[block];
+		is_static |= page == flashfs_lookup("cold")->inode_page;
+
+		if (is_static) {
+			TEST_ASSERT_EQ(count, 0);
+			continue;
+		}
+		if (count < min)
+			min = count;
+		if (count > max)
+			max = count;
+	}
+
+	/* all other pages are erased equally often */
+	TEST_ASSERT(min != 0);
+	TEST_ASSERT(max - min <= 1);
+	check_file("cold", 4 * BLOCK, 1);
+}
+
+int main(void)
+{
+	test_init();
+
+	TEST_RUN(test_remount);
+	TEST_RUN(test_torn_data_record);
+	TEST_RUN(test_torn_inode_record);
+	TEST_RUN(test_stale_records);
+	TEST_RUN(test_wear_rotation);
+
+	unmount();
+	faultflash_destroy();
+	return TEST_STATUS();
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
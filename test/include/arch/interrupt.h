@@ -0,0 +1,42 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <toolchain.h>
+
+/*
+ * Host replacement for the architecture's interrupt.h, the tests call irq
+ * handlers directly and never run concurrently with them.
+ */
+
+__always_inline void __irq_enter(void)
+{
+}
+
+__always_inline void __irq_leave(void)
+{
+}
+
+void irq_uart(void);
+void irq_usart0(void);
+void irq_usart1(void);
+void irq_usart2(void);
+void irq_usart3(void);
+void irq_tc0(void);
+void irq_tc1(void);
+void irq_tc2(void);
+void irq_tc3(void);
+void irq_tc4(void);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
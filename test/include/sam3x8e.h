@@ -0,0 +1,320 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file sam3x8e.h
+ * @brief Register-level model of the peripherals the serial driver uses.
+ *
+ * This replaces the CMSIS device header for host tests.  Registers are plain
+ * memory, except that every access through a `Usart` or `TcChannel` register
+ * name first calls `mock_sync()`, which applies the side effects of whatever
+ * was written since the previous access: `IER`/`IDR` update `IMR`, `PTCR`
+ * updates `PTSR`, the PDC loads its next pointer and counter once the
+ * current counter is zero, and `CSR` reflects the state of the PDC and of
+ * the line.  ENDRX and ENDTX are set when the PDC counts the current counter
+ * down to zero, and cleared when either counter is written; since writes
+ * are only noticed when they change the value, writing a counter with the
+ * value it already has doesn't clear them.  Registers are pointer sized so
+ * PDC pointers can hold host addresses.
+ *
+ * Tests drive the other side of the line with `mock_usart_receive()` and
+ * `mock_usart_transmit()`, which move data through the PDC like the
+ * hardware does.
+ */
+
+typedef volatile uintptr_t RwReg;
+typedef volatile uintptr_t RoReg;
+typedef volatile uintptr_t WoReg;
+
+/* the register is an array of one, so the name can be a macro with a side effect */
+#define MOCK_REG(name) RwReg name##_[1]
+
+typedef struct {
+	MOCK_REG(US_CR);
+	MOCK_REG(US_MR);
+	MOCK_REG(US_IER);
+	MOCK_REG(US_IDR);
+	MOCK_REG(US_IMR);
+	MOCK_REG(US_CSR);
+	MOCK_REG(US_RHR);
+	MOCK_REG(US_THR);
+	MOCK_REG(US_BRGR);
+	MOCK_REG(US_RTOR);
+	MOCK_REG(US_TTGR);
+	MOCK_REG(US_RPR);
+	MOCK_REG(US_RCR);
+	MOCK_REG(US_TPR);
+	MOCK_REG(US_TCR);
+	MOCK_REG(US_RNPR);
+	MOCK_REG(US_RNCR);
+	MOCK_REG(US_TNPR);
+	MOCK_REG(US_TNCR);
+	MOCK_REG(US_PTCR);
+	MOCK_REG(US_PTSR);
+	/* line state that isn't directly visible through any register */
+	bool mock_timeout;
+	bool mock_ovre;
+	bool mock_frame;
+	bool mock_endrx;
+	bool mock_endtx;
+	/* PDC counters as of the last mock_sync(), to notice writes */
+	uintptr_t mock_rcr;
+	uintptr_t mock_rncr;
+	uintptr_t mock_tcr;
+	uintptr_t mock_tncr;
+	/* characters written to THR by the CPU rather than the PDC */
+	uint8_t mock_thr_log[16];
+	size_t mock_thr_count;
+} Usart;
+
+/* the UART's registers are a subset of the USART's ones */
+typedef Usart Uart;
+
+typedef struct {
+	MOCK_REG(TC_CCR);
+	MOCK_REG(TC_CMR);
+	MOCK_REG(TC_SMMR);
+	MOCK_REG(TC_CV);
+	MOCK_REG(TC_RA);
+	MOCK_REG(TC_RB);
+	MOCK_REG(TC_RC);
+	MOCK_REG(TC_SR);
+	MOCK_REG(TC_IER);
+	MOCK_REG(TC_IDR);
+	MOCK_REG(TC_IMR);
+	bool mock_enabled;
+	/* whether the counter has been started with SWTRG since it was enabled */
+	bool mock_running;
+} TcChannel;
+
+typedef struct {
+	TcChannel TC_CHANNEL[3];
+} Tc;
+
+typedef struct {
+	RwReg PMC_PCER0;
+	RwReg PMC_PCDR0;
+	RwReg PMC_PCER1;
+	RwReg PMC_PCDR1;
+} Pmc;
+
+typedef struct {
+	RwReg PIO_PER;
+	RwReg PIO_PDR;
+	RwReg PIO_ABSR;
+} Pio;
+
+/** @brief Apply all pending side effects of register writes, always returns 0. */
+unsigned int mock_sync(void);
+
+#define US_CR		US_CR_[mock_sync()]
+#define US_MR		US_MR_[mock_sync()]
+#define US_IER		US_IER_[mock_sync()]
+#define US_IDR		US_IDR_[mock_sync()]
+#define US_IMR		US_IMR_[mock_sync()]
+#define US_CSR		US_CSR_[mock_sync()]
+#define US_RHR		US_RHR_[mock_sync()]
+#define US_THR		US_THR_[mock_sync()]
+#define US_BRGR		US_BRGR_[mock_sync()]
+#define US_RTOR		US_RTOR_[mock_sync()]
+#define US_TTGR		US_TTGR_[mock_sync()]
+#define US_RPR		US_RPR_[mock_sync()]
+#define US_RCR		US_RCR_[mock_sync()]
+#define US_TPR		US_TPR_[mock_sync()]
+#define US_TCR		US_TCR_[mock_sync()]
+#define US_RNPR		US_RNPR_[mock_sync()]
+#define US_RNCR		US_RNCR_[mock_sync()]
+#define US_TNPR		US_TNPR_[mock_sync()]
+#define US_TNCR		US_TNCR_[mock_sync()]
+#define US_PTCR		US_PTCR_[mock_sync()]
+#define US_PTSR		US_PTSR_[mock_sync()]
+
+#define TC_CCR		TC_CCR_[mock_sync()]
+#define TC_CMR		TC_CMR_[mock_sync()]
+#define TC_RC		TC_RC_[mock_sync()]
+#define TC_SR		TC_SR_[mock_sync()]
+#define TC_IER		TC_IER_[mock_sync()]
+#define TC_IDR		TC_IDR_[mock_sync()]
+#define TC_IMR		TC_IMR_[mock_sync()]
+
+extern Usart mock_usarts[5];
+extern Tc mock_tcs[2];
+extern Pmc mock_pmc;
+extern Pio mock_pios[4];
+
+#define UART		((Uart *)&mock_usarts[0])
+#define USART0		(&mock_usarts[1])
+#define USART1		(&mock_usarts[2])
+#define USART2		(&mock_usarts[3])
+#define USART3		(&mock_usarts[4])
+#define TC0		(&mock_tcs[0])
+#define TC1		(&mock_tcs[1])
+#define PMC		(&mock_pmc)
+#define PIOA		(&mock_pios[0])
+#define PIOB		(&mock_pios[1])
+#define PIOC		(&mock_pios[2])
+#define PIOD		(&mock_pios[3])
+
+typedef enum {
+	UART_IRQn	= 8,
+	USART0_IRQn	= 17,
+	USART1_IRQn	= 18,
+	USART2_IRQn	= 19,
+	USART3_IRQn	= 20,
+	TC0_IRQn	= 27,
+	TC1_IRQn	= 28,
+	TC2_IRQn	= 29,
+	TC3_IRQn	= 30,
+	TC4_IRQn	= 31,
+} IRQn_Type;
+
+/** @brief Bit `irq` is set if the interrupt is enabled. */
+extern uint64_t mock_nvic_enabled;
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)
+{
+	mock_nvic_enabled |= (uint64_t)1 << irq;
+}
+
+static inline void NVIC_DisableIRQ(IRQn_Type irq)
+{
+	mock_nvic_enabled &= ~((uint64_t)1 << irq);
+}
+
+/* UART (Atmel Datasheet, Section 34) */
+#define UART_MR_PAR_NO			(0x4u << 9)
+#define UART_MR_CHMODE_NORMAL		(0x0u << 14)
+#define UART_BRGR_CD(x)			((x) & 0xffffu)
+
+/* USART (Atmel Datasheet, Section 35) */
+#define US_CR_RSTRX			(1u << 2)
+#define US_CR_RSTTX			(1u << 3)
+#define US_CR_RXEN			(1u << 4)
+#define US_CR_RXDIS			(1u << 5)
+#define US_CR_TXEN			(1u << 6)
+#define US_CR_TXDIS			(1u << 7)
+#define US_CR_RSTSTA			(1u << 8)
+#define US_CR_STTTO			(1u << 11)
+
+#define US_MR_USART_MODE_Msk		(0xfu << 0)
+#define US_MR_USART_MODE_NORMAL		(0x0u << 0)
+#define US_MR_USART_MODE_HW_HANDSHAKING	(0x2u << 0)
+#define US_MR_USCLKS_MCK		(0x0u << 4)
+#define US_MR_CHRL_8_BIT		(0x3u << 6)
+#define US_MR_PAR_NO			(0x4u << 9)
+#define US_MR_NBSTOP_1_BIT		(0x0u << 12)
+#define US_MR_CHMODE_NORMAL		(0x0u << 14)
+#define US_MR_OVER			(1u << 19)
+
+#define US_CSR_RXRDY			(1u << 0)
+#define US_CSR_TXRDY			(1u << 1)
+#define US_CSR_ENDRX			(1u << 3)
+#define US_CSR_ENDTX			(1u << 4)
+#define US_CSR_OVRE			(1u << 5)
+#define US_CSR_FRAME			(1u << 6)
+#define US_CSR_TIMEOUT			(1u << 8)
+#define US_CSR_TXBUFE			(1u << 11)
+#define US_CSR_RXBUFF			(1u << 12)
+
+#define US_IER_RXRDY			US_CSR_RXRDY
+#define US_IER_TXRDY			US_CSR_TXRDY
+#define US_IER_ENDRX			US_CSR_ENDRX
+#define US_IER_ENDTX			US_CSR_ENDTX
+#define US_IER_OVRE			US_CSR_OVRE
+#define US_IER_FRAME			US_CSR_FRAME
+#define US_IER_TIMEOUT			US_CSR_TIMEOUT
+#define US_IDR_RXRDY			US_CSR_RXRDY
+#define US_IDR_TXRDY			US_CSR_TXRDY
+#define US_IDR_ENDRX			US_CSR_ENDRX
+#define US_IDR_ENDTX			US_CSR_ENDTX
+#define US_IMR_RXRDY			US_CSR_RXRDY
+#define US_IMR_TXRDY			US_CSR_TXRDY
+#define US_IMR_ENDRX			US_CSR_ENDRX
+#define US_IMR_ENDTX			US_CSR_ENDTX
+#define US_IMR_TIMEOUT			US_CSR_TIMEOUT
+
+#define US_BRGR_CD(x)			((x) & 0xffffu)
+#define US_BRGR_FP(x)			(((x) & 0x7u) << 16)
+#define US_RTOR_TO(x)			((x) & 0xffffu)
+
+/* PDC (Atmel Datasheet, Section 26) */
+#define US_PTCR_RXTEN			(1u << 0)
+#define US_PTCR_RXTDIS			(1u << 1)
+#define US_PTCR_TXTEN			(1u << 8)
+#define US_PTCR_TXTDIS			(1u << 9)
+#define US_PTSR_RXTEN			(1u << 0)
+#define US_PTSR_TXTEN			(1u << 8)
+
+/* TC (Atmel Datasheet, Section 36) */
+#define TC_CCR_CLKEN			(1u << 0)
+#define TC_CCR_CLKDIS			(1u << 1)
+#define TC_CCR_SWTRG			(1u << 2)
+#define TC_CMR_TCCLKS_TIMER_CLOCK4	(0x3u << 0)
+#define TC_CMR_WAVSEL_UP_RC		(0x2u << 13)
+#define TC_CMR_WAVE			(1u << 15)
+#define TC_IER_CPCS			(1u << 4)
+
+/* PIO pin assignments (Atmel Datasheet, Section 9.3) */
+#define PIO_PA8A_URXD			(1u << 8)
+#define PIO_PA9A_UTXD			(1u << 9)
+#define PIO_PA10A_RXD0			(1u << 10)
+#define PIO_PA11A_TXD0			(1u << 11)
+#define PIO_PA12A_RXD1			(1u << 12)
+#define PIO_PA13A_TXD1			(1u << 13)
+#define PIO_PA14A_RTS1			(1u << 14)
+#define PIO_PA15A_CTS1			(1u << 15)
+#define PIO_PB20A_TXD2			(1u << 20)
+#define PIO_PB21A_RXD2			(1u << 21)
+#define PIO_PB22A_RTS2			(1u << 22)
+#define PIO_PB23A_CTS2			(1u << 23)
+#define PIO_PB25A_RTS0			(1u << 25)
+#define PIO_PB26A_CTS0			(1u << 26)
+#define PIO_PD4B_TXD3			(1u << 4)
+#define PIO_PD5B_RXD3			(1u << 5)
+
+/** @brief Reset all peripherals to their state after power-on. */
+void mock_reset(void);
+
+/**
+ * @brief Receive bytes on the line and let the receive PDC store them.
+ * Stops early if the receiver or the PDC is disabled, or if both PDC buffers
+ * are full, in which case the next byte is an overrun.
+ *
+ * @returns The amount of bytes the PDC has stored
+ */
+size_t mock_usart_receive(Usart *usart, const void *data, size_t len);
+
+/** @brief Let the receiver timeout expire because the line has gone idle. */
+void mock_usart_idle(Usart *usart);
+
+/**
+ * @brief Send up to `len` bytes from the transmit PDC and store them in `dest`.
+ * Nothing is sent while the transmit PDC is disabled.
+ *
+ * @returns The amount of bytes sent
+ */
+size_t mock_usart_transmit(Usart *usart, void *dest, size_t len);
+
+/** @brief Get the enabled interrupts that are currently pending. */
+uint32_t mock_usart_pending(Usart *usart);
+
+/** @brief Check whether the timer channel is enabled and has been triggered. */
+bool mock_tc_running(TcChannel *tc);
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,246 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/*
+ * Compaction, tombstones and crash recovery of the key-value store.  The
+ * source is included directly so the tests can tell when compaction happens.
+ */
+
+#include "../kernel/kvstore.c"
+
+#include "faultflash.h"
+#include "test.h"
+
+/* release everything kvstore_init() allocated, like a reboot */
+static void unmount(void)
+{
+	if (kvstore_flash == NULL)
+		return;
+
+	kfree(kvstore_buf);
+	kvstore_flash = NULL;
+}
+
+static int mount(void)
+{
+	unmount();
+	return kvstore_init();
+}
+
+static void setup(void)
+{
+	unmount();
+	faultflash_destroy();
+	faultflash_create();
+	TEST_ASSERT_EQ(mount(), 0);
+}
+
+static void check_value(const char *key, uint32_t expected)
+{
+	uint32_t value = 0;
+	TEST_ASSERT_EQ(kvstore_get(key, &value, sizeof(value)), sizeof(value));
+	TEST_ASSERT_EQ(value, expected);
+}
+
+static void check_deleted(const char *key)
+{
+	uint32_t value;
+	TEST_ASSERT_EQ(kvstore_get(key, &value, sizeof(value)), -ENOENT);
+}
+
+/* whether setting `key` to a 4 byte value is going to compact the store */
+static bool will_compact(const char *key)
+{
+	size_t size = kvstore_record_size(strlen(key), sizeof(uint32_t));
+
+	if (kvstore_tail_offset + size <= kvstore_flash->page_size)
+		return false;
+	return kvstore_tail_page + 1 >= KVSTORE_HALF_PAGES;
+}
+
+/* keep overwriting `key` until the next write compacts the store */
+static uint32_t fill_until_compaction(const char *key, uint32_t value)
+{
+	while (!will_compact(key)) {
+		TEST_ASSERT_EQ(kvstore_set(key, &value, sizeof(value)), 0);
+		value++;
+	}
+
+	return value;
+}
+
+static void test_compaction(void)
+{
+	setup();
+
+	uint32_t one = 1;
+	TEST_ASSERT_EQ(kvstore_set("static", &one, sizeof(one)), 0);
+
+	uint32_t generation = kvstore_generation;
+	uint32_t value = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		unsigned int active = kvstore_active;
+		value = fill_until_compaction("counter", value);
+		TEST_ASSERT_EQ(kvstore_set("counter", &value, sizeof(value)), 0);
+
+		/* only the live records were copied before appending the new one */
+		TEST_ASSERT_EQ(kvstore_active, !active);
+		TEST_ASSERT_EQ(kvstore_generation, generation + i + 1);
+		TEST_ASSERT_EQ(kvstore_tail_page, 0);
+		TEST_ASSERT_EQ(kvstore_tail_offset, sizeof(struct kvstore_header)
+			       + kvstore_record_size(strlen("static"), sizeof(uint32_t))
+			       + 2 * kvstore_record_size(strlen("counter"), sizeof(uint32_t)));
+		check_value("counter", value);
+		check_value("static", one);
+	}
+
+	TEST_ASSERT_EQ(mount(), 0);
+	TEST_ASSERT_EQ(kvstore_generation, generation + 3);
+	TEST_ASSERT_EQ(kvstore_count, 2);
+	check_value("counter", value);
+	check_value("static", one);
+}
+
+static void test_tombstones(void)
+{
+	uint32_t value;
+
+	setup();
+
+	value = 0;
+	TEST_ASSERT_EQ(kvstore_set("a", &value, sizeof(value)), 0);
+	value = 1;
+	TEST_ASSERT_EQ(kvstore_set("b", &value, sizeof(value)), 0);
+	value = 2;
+	TEST_ASSERT_EQ(kvstore_set("c", &value, sizeof(value)), 0);
+	TEST_ASSERT_EQ(kvstore_delete("b"), 0);
+	TEST_ASSERT_EQ(kvstore_delete("b"), -ENOENT);
+	TEST_ASSERT_EQ(kvstore_delete("nope"), -ENOENT);
+	check_deleted("b");
+	TEST_ASSERT_EQ(kvstore_count, 2);
+
+	/* the tombstone supersedes the record on flash */
+	TEST_ASSERT_EQ(mount(), 0);
+	check_value("a", 0);
+	check_deleted("b");
+	check_value("c", 2);
+	TEST_ASSERT_EQ(kvstore_count, 2);
+
+	/* deleted keys are dropped entirely when compacting */
+	value = fill_until_compaction("c", 3);
+	TEST_ASSERT_EQ(kvstore_set("c", &value, sizeof(value)), 0);
+	/* "a" and "c" were copied, and then the new value of "c" appended */
+	TEST_ASSERT_EQ(kvstore_tail_offset, sizeof(struct kvstore_header)
+		       + kvstore_record_size(1, sizeof(uint32_t)) * 3);
+	check_deleted("b");
+
+	/* and can be created again afterwards */
+	value = 42;
+	TEST_ASSERT_EQ(kvstore_set("b", &value, sizeof(value)), 0);
+	TEST_ASSERT_EQ(mount(), 0);
+	check_value("a", 0);
+	check_value("b", 42);
+	TEST_ASSERT_EQ(kvstore_delete("b"), 0);
+	TEST_ASSERT_EQ(mount(), 0);
+	check_deleted("b");
+}
+
+static void test_torn_record(void)
+{
+	uint32_t value = 1;
+
+	setup();
+	TEST_ASSERT_EQ(kvstore_set("a", &value, sizeof(value)), 0);
+
+	value = 2;
+	faultflash_tear_after(0);
+	TEST_ASSERT(kvstore_set("a", &value, sizeof(value)) != 0);
+	TEST_ASSERT(faultflash_torn());
+	faultflash_repair();
+
+	/* the torn record is skipped, along with the rest of its page */
+	TEST_ASSERT_EQ(mount(), 0);
+	check_value("a", 1);
+	TEST_ASSERT_EQ(kvstore_tail_page, 1);
+	TEST_ASSERT_EQ(kvstore_tail_offset, 0);
+
+	TEST_ASSERT_EQ(kvstore_set("a", &value, sizeof(value)), 0);
+	TEST_ASSERT_EQ(mount(), 0);
+	check_value("a", 2);
+}
+
+/*
+ * Lose power at every single step of compaction.  The steps are programming
+ * pages 1 to n - 1 of the new half, programming its first page, writing its
+ * header and finally appending the record that didn't fit.  Until the header
+ * is complete the old half stays active, and after that the new one is
+ * (with or without the new record).
+ */
+static void test_torn_compaction(void)
+{
+	const unsigned int steps = KVSTORE_HALF_PAGES + 2;
+
+	for (unsigned int step = 0; step < steps; step++) {
+		uint32_t one = 1;
+		uint32_t deleted = 2;
+
+		setup();
+		TEST_ASSERT_EQ(kvstore_set("static", &one, sizeof(one)), 0);
+		TEST_ASSERT_EQ(kvstore_set("deleted", &deleted, sizeof(deleted)), 0);
+		TEST_ASSERT_EQ(kvstore_delete("deleted"), 0);
+		uint32_t value = fill_until_compaction("counter", 0);
+		uint32_t generation = kvstore_generation;
+		unsigned int active = kvstore_active;
+
+		faultflash_tear_after(step);
+		TEST_ASSERT(kvstore_set("counter", &value, sizeof(value)) != 0);
+		TEST_ASSERT(faultflash_torn());
+		faultflash_repair();
+
+		TEST_ASSERT_EQ(mount(), 0);
+		if (step < steps - 1) {
+			TEST_ASSERT_EQ(kvstore_active, active);
+			TEST_ASSERT_EQ(kvstore_generation, generation);
+		} else {
+			/* crashed right after the header was written */
+			TEST_ASSERT_EQ(kvstore_active, !active);
+			TEST_ASSERT_EQ(kvstore_generation, generation + 1);
+		}
+		check_value("counter", value - 1);
+		check_value("static", one);
+		check_deleted("deleted");
+
+		/* the store is fully usable after recovery */
+		TEST_ASSERT_EQ(kvstore_set("counter", &value, sizeof(value)), 0);
+		TEST_ASSERT_EQ(mount(), 0);
+		check_value("counter", value);
+		check_value("static", one);
+		check_deleted("deleted");
+	}
+}
+
+int main(void)
+{
+	test_init();
+
+	TEST_RUN(test_compaction);
+	TEST_RUN(test_tombstones);
+	TEST_RUN(test_torn_record);
+	TEST_RUN(test_torn_compaction);
+
+	unmount();
+	faultflash_destroy();
+	return TEST_STATUS();
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,220 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sam3x8e.h>
+
+/* THR doesn't hold a character (anything written to it is at most 0xff) */
+#define MOCK_THR_EMPTY 0x100
+
+Usart mock_usarts[5];
+Tc mock_tcs[2];
+Pmc mock_pmc;
+Pio mock_pios[4];
+uint64_t mock_nvic_enabled;
+
+volatile uint32_t SystemCoreClock = 84000000;
+
+static void mock_sync_usart(Usart *u)
+{
+	uintptr_t cr = u->US_CR_[0];
+	if (cr & US_CR_STTTO)
+		u->mock_timeout = false;
+	if (cr & US_CR_RSTSTA) {
+		u->mock_ovre = false;
+		u->mock_frame = false;
+	}
+	u->US_CR_[0] = 0;
+
+	u->US_IMR_[0] |= u->US_IER_[0];
+	u->US_IER_[0] = 0;
+	u->US_IMR_[0] &= ~u->US_IDR_[0];
+	u->US_IDR_[0] = 0;
+
+	uintptr_t ptcr = u->US_PTCR_[0];
+	if (ptcr & US_PTCR_RXTEN)
+		u->US_PTSR_[0] |= US_PTSR_RXTEN;
+	if (ptcr & US_PTCR_RXTDIS)
+		u->US_PTSR_[0] &= ~US_PTSR_RXTEN;
+	if (ptcr & US_PTCR_TXTEN)
+		u->US_PTSR_[0] |= US_PTSR_TXTEN;
+	if (ptcr & US_PTCR_TXTDIS)
+		u->US_PTSR_[0] &= ~US_PTSR_TXTEN;
+	u->US_PTCR_[0] = 0;
+
+	/* writing either counter acknowledges the end of the buffer */
+	if (u->US_RCR_[0] != u->mock_rcr || u->US_RNCR_[0] != u->mock_rncr)
+		u->mock_endrx = false;
+	if (u->US_TCR_[0] != u->mock_tcr || u->US_TNCR_[0] != u->mock_tncr)
+		u->mock_endtx = false;
+
+	/* the next pointer and counter are loaded as soon as the current counter is zero */
+	if (u->US_RCR_[0] == 0 && u->US_RNCR_[0] != 0) {
+		u->US_RPR_[0] = u->US_RNPR_[0];
+		u->US_RCR_[0] = u->US_RNCR_[0];
+		u->US_RNCR_[0] = 0;
+	}
+	if (u->US_TCR_[0] == 0 && u->US_TNCR_[0] != 0) {
+		u->US_TPR_[0] = u->US_TNPR_[0];
+		u->US_TCR_[0] = u->US_TNCR_[0];
+		u->US_TNCR_[0] = 0;
+	}
+	u->mock_rcr = u->US_RCR_[0];
+	u->mock_rncr = u->US_RNCR_[0];
+	u->mock_tcr = u->US_TCR_[0];
+	u->mock_tncr = u->US_TNCR_[0];
+
+	if (u->US_THR_[0] != MOCK_THR_EMPTY) {
+		if (u->mock_thr_count < sizeof(u->mock_thr_log))
+			u->mock_thr_log[u->mock_thr_count++] = (uint8_t)u->US_THR_[0];
+		u->US_THR_[0] = MOCK_THR_EMPTY;
+	}
+
+	uintptr_t csr = US_CSR_TXRDY;
+	if (u->mock_endrx)
+		csr |= US_CSR_ENDRX;
+	if (u->US_RCR_[0] == 0 && u->US_RNCR_[0] == 0)
+		csr |= US_CSR_RXBUFF;
+	if (u->mock_endtx)
+		csr |= US_CSR_ENDTX;
+	if (u->US_TCR_[0] == 0 && u->US_TNCR_[0] == 0)
+		csr |= US_CSR_TXBUFE;
+	if (u->mock_timeout)
+		csr |= US_CSR_TIMEOUT;
+	if (u->mock_ovre)
+		csr |= US_CSR_OVRE;
+	if (u->mock_frame)
+		csr |= US_CSR_FRAME;
+	u->US_CSR_[0] = csr;
+}
+
+static void mock_sync_tc(TcChannel *tc)
+{
+	uintptr_t ccr = tc->TC_CCR_[0];
+	if (ccr & TC_CCR_CLKEN)
+		tc->mock_enabled = true;
+	if (ccr & TC_CCR_CLKDIS)
+		tc->mock_enabled = false;
+	if (ccr & TC_CCR_SWTRG)
+		tc->TC_CV_[0] = 0;
+	tc->mock_running = tc->mock_enabled && (tc->mock_running || (ccr & TC_CCR_SWTRG));
+	tc->TC_CCR_[0] = 0;
+
+	tc->TC_IMR_[0] |= tc->TC_IER_[0];
+	tc->TC_IER_[0] = 0;
+	tc->TC_IMR_[0] &= ~tc->TC_IDR_[0];
+	tc->TC_IDR_[0] = 0;
+}
+
+unsigned int mock_sync(void)
+{
+	for (unsigned int i = 0; i < 5; i++)
+		mock_sync_usart(&mock_usarts[i]);
+	for (unsigned int i = 0; i < 2; i++) {
+		for (unsigned int j = 0; j < 3; j++)
+			mock_sync_tc(&mock_tcs[i].TC_CHANNEL[j]);
+	}
+
+	return 0;
+}
+
+void mock_reset(void)
+{
+	memset(mock_usarts, 0, sizeof(mock_usarts));
+	memset(mock_tcs, 0, sizeof(mock_tcs));
+	memset(&mock_pmc, 0, sizeof(mock_pmc));
+	memset(mock_pios, 0, sizeof(mock_pios));
+	mock_nvic_enabled = 0;
+
+	for (unsigned int i = 0; i < 5; i++) {
+		mock_usarts[i].US_THR_[0] = MOCK_THR_EMPTY;
+		/* the transmit counter is zero, so ENDTX is set while idle */
+		mock_usarts[i].mock_endtx = true;
+	}
+	mock_sync();
+}
+
+size_t mock_usart_receive(Usart *usart, const void *data, size_t len)
+{
+	const uint8_t *src = data;
+	size_t done = 0;
+
+	mock_sync();
+	if (!(usart->US_PTSR_[0] & US_PTSR_RXTEN))
+		return 0;
+
+	while (done < len) {
+		if (usart->US_RCR_[0] == 0) {
+			/* both buffers are full, RHR is overwritten */
+			usart->mock_ovre = true;
+			break;
+		}
+
+		*(uint8_t *)usart->US_RPR_[0] = src[done++];
+		usart->US_RPR_[0]++;
+		usart->mock_rcr = --usart->US_RCR_[0];
+		if (usart->mock_rcr == 0)
+			usart->mock_endrx = true;
+		/* the receiver timeout restarts with every character */
+		usart->mock_timeout = false;
+		mock_sync();
+	}
+
+	mock_sync();
+	return done;
+}
+
+void mock_usart_idle(Usart *usart)
+{
+	usart->mock_timeout = true;
+	mock_sync();
+}
+
+size_t mock_usart_transmit(Usart *usart, void *dest, size_t len)
+{
+	uint8_t *tmp = dest;
+	size_t done = 0;
+
+	mock_sync();
+	if (!(usart->US_PTSR_[0] & US_PTSR_TXTEN))
+		return 0;
+
+	while (done < len && usart->US_TCR_[0] != 0) {
+		tmp[done++] = *(const uint8_t *)usart->US_TPR_[0];
+		usart->US_TPR_[0]++;
+		usart->mock_tcr = --usart->US_TCR_[0];
+		if (usart->mock_tcr == 0)
+			usart->mock_endtx = true;
+		mock_sync();
+	}
+
+	return done;
+}
+
+uint32_t mock_usart_pending(Usart *usart)
+{
+	mock_sync();
+	return (uint32_t)(usart->US_CSR_[0] & usart->US_IMR_[0]);
+}
+
+bool mock_tc_running(TcChannel *tc)
+{
+	mock_sync();
+	return tc->mock_running;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
@@ -0,0 +1,617 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/*
+ * Register-level tests of the SAM3X8E serial driver against the peripheral
+ * model in include/sam3x8e.h.  The source is included directly to get at the
+ * internal helpers and the interrupt handlers.
+ */
+
+#include "../arch/at91sam3x8e/serial.c"
+
+#include "test.h"
+
+#define USART0_INDEX 1
+#define RXDMA_BUFSZ CONFIG_SERIAL_USART0_RXDMA_BUFSZ
+#define RING_SIZE CONFIG_SERIAL_USART0_BUFSZ
+
+static unsigned int dmabufs_live = 0;
+static unsigned int rx_events[2];
+static unsigned int tx_kevents;
+
+static void test_dmabuf_destroy(struct kent *kent)
+{
+	dmabufs_live--;
+	kfree(kent_to_dmabuf(kent));
+}
+
+struct dmabuf *dmabuf_create(struct device *dev, size_t len)
+{
+	struct dmabuf *buf = kmalloc(sizeof(*buf) + len);
+	if (buf == NULL)
+		return NULL;
+
+	buf->kent.parent = devices_kent;
+	buf->kent.destroy = test_dmabuf_destroy;
+	kent_init(&buf->kent);
+	buf->pool = NULL;
+	buf->len = len;
+
+	dmabufs_live++;
+	return buf;
+}
+
+void dmabuf_get(struct dmabuf *buf)
+{
+	kent_get(&buf->kent);
+}
+
+void dmabuf_put(struct dmabuf *buf)
+{
+	kent_put(&buf->kent);
+}
+
+void serial_rx_notify(struct serial_device *dev, enum serial_rx_event event)
+{
+	rx_events[event]++;
+}
+
+void device_kevent_create_and_dispatch(struct device *device, enum device_kevent_flags flags)
+{
+	if (flags & DEVICE_KEVENT_TX)
+		tx_kevents++;
+}
+
+/* next byte the other side of the line sends, and the next one we expect to read */
+static uint8_t line_seq;
+static uint8_t ring_seq;
+
+/* shut down the port from the previous test and bring up a fresh one */
+static struct arch_serial_device *setup(unsigned int index)
+{
+	static struct arch_serial_device *prev = NULL;
+
+	if (prev != NULL) {
+		arch_serial_exit(&prev->device);
+		rxring_destroy(prev->device.rx);
+		prev->device.rx = NULL;
+		TEST_ASSERT_EQ(dmabufs_live, 0);
+	}
+
+	mock_reset();
+	struct arch_serial_device *arch_dev = &arch_serial_devices[index];
+	struct serial_device *dev = &arch_dev->device;
+	dev->id = (int)index;
+	memset(&dev->stats, 0, sizeof(dev->stats));
+	dev->rx = rxring_create(dev->rx_bufsz);
+	TEST_ASSERT(dev->rx != NULL);
+	TEST_ASSERT_EQ(arch_serial_init(dev), 0);
+
+	memset(rx_events, 0, sizeof(rx_events));
+	tx_kevents = 0;
+	line_seq = 0;
+	ring_seq = 0;
+
+	prev = arch_dev;
+	return arch_dev;
+}
+
+/* receive `len` bytes of the sequence, returns how many the PDC took */
+static size_t line_send(struct arch_serial_device *arch_dev, size_t len)
+{
+	uint8_t data[2 * RING_SIZE];
+
+	for (size_t i = 0; i < len; i++)
+		data[i] = (uint8_t)(line_seq + i);
+
+	size_t done = mock_usart_receive(arch_dev->port->regs, data, len);
+	line_seq += (uint8_t)done;
+	return done;
+}
+
+/* read up to `len` bytes from the ring and check they continue the sequence */
+static size_t ring_take(struct arch_serial_device *arch_dev, size_t len)
+{
+	uint8_t data[2 * RING_SIZE];
+
+	size_t done = rxring_read(data, arch_dev->device.rx, len);
+	for (size_t i = 0; i < done; i++) {
+		if (data[i] != ring_seq) {
+			TEST_ASSERT_EQ(data[i], ring_seq);
+			break;
+		}
+		ring_seq++;
+	}
+
+	return done;
+}
+
+/* run the irq handler if any enabled interrupt is pending */
+static bool serial_irq_pending(struct arch_serial_device *arch_dev)
+{
+	if (mock_usart_pending(arch_dev->port->regs) == 0)
+		return false;
+
+	serial_irq(arch_dev);
+	return true;
+}
+
+/* baud rate resulting from the given register values */
+static uint32_t decode_baud(bool is_uart, uint32_t mr, uint32_t brgr)
+{
+	if (is_uart)
+		return SystemCoreClock / (16 * (brgr & 0xffff));
+
+	uint32_t div = (brgr & 0xffff) * 8 + ((brgr >> 16) & 0x7);
+	return SystemCoreClock / ((mr & US_MR_OVER ? 1 : 2) * div);
+}
+
+static uint32_t baud_error(uint32_t actual, uint32_t baud)
+{
+	return actual > baud ? actual - baud : baud - actual;
+}
+
+static void test_baud_regs(void)
+{
+	static const long int usart_rates[] = {
+		1200, 9600, 57600, 115200, 230400, 460800, 921600,
+		1000000, 2000000, 3000000, 4000000, 6000000, 10500000,
+	};
+	const struct arch_serial_port *uart = &arch_serial_ports[0];
+	const struct arch_serial_port *usart = &arch_serial_ports[USART0_INDEX];
+	uint32_t mr;
+	uint32_t brgr;
+
+	for (unsigned int i = 0; i < sizeof(usart_rates) / sizeof(usart_rates[0]); i++) {
+		uint32_t baud = (uint32_t)usart_rates[i];
+
+		TEST_ASSERT_EQ(baud_regs(usart, baud, &mr, &brgr), 0);
+		TEST_ASSERT_EQ(mr & US_MR_USART_MODE_Msk, US_MR_USART_MODE_NORMAL);
+		TEST_ASSERT_EQ(mr & ~(US_MR_OVER | US_MR_USART_MODE_Msk),
+			       US_MR_CHRL_8_BIT | US_MR_PAR_NO);
+		/* 8x oversampling only if 16x can't get there */
+		TEST_ASSERT_EQ(!!(mr & US_MR_OVER), baud > SystemCoreClock / 16);
+
+		/* the divider is the best one, neither neighbour comes closer */
+		uint32_t actual = decode_baud(false, mr, brgr);
+		uint32_t div = (brgr & 0xffff) * 8 + ((brgr >> 16) & 0x7);
+		uint32_t over = mr & US_MR_OVER ? 1 : 2;
+		TEST_ASSERT(baud_error(actual, baud)
+			    <= baud_error(SystemCoreClock / (over * (div + 1)), baud));
+		if (div > 8) {
+			TEST_ASSERT(baud_error(actual, baud)
+				    <= baud_error(SystemCoreClock / (over * (div - 1)), baud));
+		}
+	}
+
+	/* the usual rates are within 1 % on both kinds of port */
+	TEST_ASSERT_EQ(baud_regs(usart, 115200, &mr, &brgr), 0);
+	TEST_ASSERT_EQ(brgr, US_BRGR_CD(45) | US_BRGR_FP(5));
+	TEST_ASSERT(baud_error(decode_baud(false, mr, brgr), 115200) < 1152);
+	TEST_ASSERT_EQ(baud_regs(usart, 6000000, &mr, &brgr), 0);
+	TEST_ASSERT_EQ(decode_baud(false, mr, brgr), 6000000);
+	TEST_ASSERT_EQ(baud_regs(uart, 115200, &mr, &brgr), 0);
+	TEST_ASSERT_EQ(mr, UART_MR_PAR_NO | UART_MR_CHMODE_NORMAL);
+	TEST_ASSERT_EQ(brgr, UART_BRGR_CD(46));
+	TEST_ASSERT(baud_error(decode_baud(true, mr, brgr), 115200) < 1152);
+	TEST_ASSERT_EQ(baud_regs(uart, SystemCoreClock / 16, &mr, &brgr), 0);
+	TEST_ASSERT_EQ(brgr, UART_BRGR_CD(1));
+
+	/* out of range, either way */
+	TEST_ASSERT_EQ(baud_regs(usart, 0, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(usart, -9600, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(usart, SystemCoreClock / 8 + 1, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(usart, 50, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(uart, SystemCoreClock / 16 + 1, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(uart, 50, &mr, &brgr), -EINVAL);
+	TEST_ASSERT_EQ(baud_regs(uart, 100000000, &mr, &brgr), -EINVAL);
+}
+
+static void test_set_baud(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	struct serial_device *dev = &arch_dev->device;
+	Usart *regs = arch_dev->port->regs;
+
+	/* the receiver timeout is in bit periods and restarts with every byte */
+	TEST_ASSERT_EQ(regs->US_RTOR, US_RTOR_TO(CONFIG_SERIAL_USART0_RX_IDLE_CHARS * 10));
+	TEST_ASSERT(regs->US_IMR & US_IMR_TIMEOUT);
+	TEST_ASSERT(!(regs->US_IMR & US_IMR_RXRDY));
+
+	arch_serial_set_hwflow(dev, true);
+	TEST_ASSERT_EQ(regs->US_MR & US_MR_USART_MODE_Msk, US_MR_USART_MODE_HW_HANDSHAKING);
+	TEST_ASSERT_EQ(PIOB->PIO_PDR, PIO_PB25A_RTS0 | PIO_PB26A_CTS0);
+
+	/* changing the rate keeps handshaking on */
+	TEST_ASSERT_EQ(arch_serial_set_baud(dev, 2000000), 0);
+	TEST_ASSERT_EQ(regs->US_MR & US_MR_USART_MODE_Msk, US_MR_USART_MODE_HW_HANDSHAKING);
+	TEST_ASSERT_EQ(decode_baud(false, regs->US_MR, regs->US_BRGR), 2000000);
+
+	/* a rate that can't be set doesn't touch the registers */
+	uint32_t mr = regs->US_MR;
+	uint32_t brgr = regs->US_BRGR;
+	TEST_ASSERT_EQ(arch_serial_set_baud(dev, 50), -EINVAL);
+	TEST_ASSERT_EQ(regs->US_MR, mr);
+	TEST_ASSERT_EQ(regs->US_BRGR, brgr);
+
+	arch_serial_set_hwflow(dev, false);
+	TEST_ASSERT_EQ(regs->US_MR & US_MR_USART_MODE_Msk, US_MR_USART_MODE_NORMAL);
+	TEST_ASSERT_EQ(PIOB->PIO_PER, PIO_PB25A_RTS0 | PIO_PB26A_CTS0);
+
+	/* USART3's flow control pins aren't bonded out */
+	TEST_ASSERT(!arch_serial_has_hwflow(&arch_serial_devices[4].device));
+
+	/* the UART's idle check timer follows the baud rate */
+	arch_dev = setup(0);
+	TEST_ASSERT(arch_dev->port->regs->US_IMR & US_IMR_RXRDY);
+	uint32_t rc = arch_dev->rx_idle_rc;
+	TEST_ASSERT_EQ(arch_serial_set_baud(&arch_dev->device, CONFIG_SERIAL_BAUD * 2), 0);
+	TEST_ASSERT_EQ(arch_dev->rx_idle_rc, rc / 2);
+	TEST_ASSERT_EQ(arch_dev->port->tc->TC_RC, rc / 2);
+}
+
+static void test_rx_idle(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+
+	/* partial buffers stay where they are while data is coming in */
+	TEST_ASSERT_EQ(line_send(arch_dev, 10), 10);
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(rxring_len(arch_dev->device.rx), 0);
+
+	/* and are flushed once the line goes quiet */
+	mock_usart_idle(arch_dev->port->regs);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(rx_events[SERIAL_RX_DATA], 1);
+	TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), 10);
+	/* STTTO acknowledged the timeout */
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+
+	TEST_ASSERT_EQ(line_send(arch_dev, 5), 5);
+	mock_usart_idle(arch_dev->port->regs);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), 5);
+	TEST_ASSERT_EQ(arch_dev->device.stats.rx_bytes, 15);
+}
+
+static void test_uart_idle_check(void)
+{
+	struct arch_serial_device *arch_dev = setup(0);
+	Usart *regs = arch_dev->port->regs;
+	TcChannel *tc = arch_dev->port->tc;
+
+	/* the first byte starts the timer through RXRDY */
+	TEST_ASSERT_EQ(line_send(arch_dev, 3), 3);
+	serial_irq(arch_dev);
+	TEST_ASSERT(mock_tc_running(tc));
+	TEST_ASSERT(!(regs->US_IMR & US_IMR_RXRDY));
+
+	/* still busy at the first tick */
+	TEST_ASSERT_EQ(line_send(arch_dev, 3), 3);
+	rx_timer_irq(arch_dev);
+	TEST_ASSERT_EQ(rxring_len(arch_dev->device.rx), 0);
+	TEST_ASSERT(mock_tc_running(tc));
+
+	/* quiet for a whole period */
+	rx_timer_irq(arch_dev);
+	TEST_ASSERT_EQ(rx_events[SERIAL_RX_DATA], 1);
+	TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), 6);
+	TEST_ASSERT(!mock_tc_running(tc));
+	TEST_ASSERT(regs->US_IMR & US_IMR_RXRDY);
+}
+
+static void test_rx_switch(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	Usart *regs = arch_dev->port->regs;
+
+	TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ + 5), RXDMA_BUFSZ + 5);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), RXDMA_BUFSZ + 5);
+
+	/* the full buffer went back to the PDC as the next one */
+	TEST_ASSERT_EQ(arch_dev->rxcur, 1);
+	TEST_ASSERT_EQ(arch_dev->rxpos, 5);
+	TEST_ASSERT_EQ(regs->US_RNPR, (uintptr_t)arch_dev->rxbuf[0]);
+	TEST_ASSERT_EQ(regs->US_RNCR, RXDMA_BUFSZ);
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+
+	/* go around both buffers a few times */
+	for (unsigned int i = 0; i < 5; i++) {
+		TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ - 1), RXDMA_BUFSZ - 1);
+		serial_irq_pending(arch_dev);
+		mock_usart_idle(regs);
+		TEST_ASSERT(serial_irq_pending(arch_dev));
+		TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), RXDMA_BUFSZ - 1);
+	}
+
+	TEST_ASSERT_EQ(arch_dev->device.stats.dropped, 0);
+	TEST_ASSERT_EQ(arch_dev->device.stats.overruns, 0);
+}
+
+static void test_rx_stopped(void)
+{
+	for (unsigned int offset = 0; offset < 2; offset++) {
+		struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+		Usart *regs = arch_dev->port->regs;
+
+		/* start in the second buffer the second time around */
+		if (offset != 0) {
+			TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ + 3), RXDMA_BUFSZ + 3);
+			TEST_ASSERT_EQ(rx_flush(arch_dev), RXDMA_BUFSZ + 3);
+			TEST_ASSERT_EQ(arch_dev->rxcur, 1);
+		}
+
+		/* fill both buffers without anybody flushing them */
+		size_t len = 2 * RXDMA_BUFSZ - arch_dev->rxpos;
+		TEST_ASSERT_EQ(line_send(arch_dev, len + 1), len);
+		TEST_ASSERT_EQ(regs->US_RCR, 0);
+		TEST_ASSERT_EQ(regs->US_RNCR, 0);
+		if (offset != 0) {
+			/* RPR points right behind buffer 0, i.e. at the start of the current one */
+			TEST_ASSERT_EQ(regs->US_RPR, (uintptr_t)arch_dev->rxbuf[1]);
+		}
+
+		TEST_ASSERT(serial_irq_pending(arch_dev));
+		TEST_ASSERT_EQ(arch_dev->device.stats.overruns, 1);
+		TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), len + (offset != 0 ? RXDMA_BUFSZ + 3 : 0));
+
+		/* both buffers are back in the PDC and reception continues in order */
+		TEST_ASSERT_EQ(regs->US_RCR, RXDMA_BUFSZ);
+		TEST_ASSERT_EQ(regs->US_RNCR, RXDMA_BUFSZ);
+		TEST_ASSERT_EQ(arch_dev->rxpos, 0);
+		/* the overrun byte is lost, the sequence resumes after it */
+		line_seq++;
+		ring_seq++;
+		TEST_ASSERT_EQ(line_send(arch_dev, 7), 7);
+		mock_usart_idle(regs);
+		TEST_ASSERT(serial_irq_pending(arch_dev));
+		TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), 7);
+	}
+}
+
+static void test_rx_held(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	struct serial_device *dev = &arch_dev->device;
+	Usart *regs = arch_dev->port->regs;
+
+	arch_serial_set_hwflow(dev, true);
+
+	/* leave 24 bytes of room in the ring */
+	for (size_t left = RING_SIZE - 24; left != 0; ) {
+		size_t chunk = left < RXDMA_BUFSZ ? left : RXDMA_BUFSZ;
+		TEST_ASSERT_EQ(line_send(arch_dev, chunk), chunk);
+		if (!serial_irq_pending(arch_dev)) {
+			mock_usart_idle(regs);
+			serial_irq_pending(arch_dev);
+		}
+		left -= chunk;
+	}
+	TEST_ASSERT_EQ(rxring_space(dev->rx), 24);
+
+	/* completes the current buffer, which fits, and starts the next one */
+	TEST_ASSERT_EQ(line_send(arch_dev, 24 + 100), 24 + 100);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(rxring_space(dev->rx), 0);
+	TEST_ASSERT(!arch_dev->rx_held);
+
+	/* the next buffer doesn't fit and is held back instead of dropped */
+	TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ - 100), RXDMA_BUFSZ - 100);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT(arch_dev->rx_held);
+	TEST_ASSERT(!(regs->US_IMR & US_IMR_ENDRX));
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+
+	/* the PDC fills the other buffer and then stops, RTS goes high */
+	TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ), RXDMA_BUFSZ);
+	TEST_ASSERT_EQ(regs->US_RCR, 0);
+	TEST_ASSERT_EQ(regs->US_RNCR, 0);
+
+	/* draining some of the ring only moves part of the held buffer */
+	TEST_ASSERT_EQ(ring_take(arch_dev, 50), 50);
+	arch_serial_rx_drained(dev);
+	TEST_ASSERT(arch_dev->rx_held);
+	TEST_ASSERT_EQ(rxring_space(dev->rx), 0);
+
+	/* and draining all of it eventually resumes reception */
+	size_t total = 50;
+	while (arch_dev->rx_held || rxring_len(dev->rx) != 0) {
+		size_t done = ring_take(arch_dev, RING_SIZE);
+		if (done == 0 && arch_dev->rx_held) {
+			TEST_ASSERT(done != 0);
+			break;
+		}
+		total += done;
+		arch_serial_rx_drained(dev);
+	}
+	TEST_ASSERT_EQ(total, RING_SIZE + 2 * RXDMA_BUFSZ);
+	TEST_ASSERT(regs->US_IMR & US_IMR_ENDRX);
+	TEST_ASSERT_EQ(regs->US_RCR, RXDMA_BUFSZ);
+	TEST_ASSERT_EQ(regs->US_RNCR, RXDMA_BUFSZ);
+	TEST_ASSERT_EQ(dev->stats.dropped, 0);
+	TEST_ASSERT(rx_events[SERIAL_RX_DATA] != 0);
+}
+
+static void test_rx_dropped(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	struct serial_device *dev = &arch_dev->device;
+
+	/* without flow control, whatever doesn't fit is lost */
+	for (unsigned int i = 0; i < RING_SIZE / RXDMA_BUFSZ + 1; i++) {
+		TEST_ASSERT_EQ(line_send(arch_dev, RXDMA_BUFSZ), RXDMA_BUFSZ);
+		TEST_ASSERT(serial_irq_pending(arch_dev));
+	}
+
+	TEST_ASSERT(!arch_dev->rx_held);
+	TEST_ASSERT_EQ(dev->stats.dropped, RXDMA_BUFSZ);
+	TEST_ASSERT_EQ(dev->stats.rx_bytes, RING_SIZE + RXDMA_BUFSZ);
+	TEST_ASSERT_EQ(ring_take(arch_dev, RING_SIZE), RING_SIZE);
+}
+
+static ssize_t write_str(struct arch_serial_device *arch_dev, const char *str)
+{
+	return arch_serial_write(&arch_dev->device, str, strlen(str));
+}
+
+static void test_tx_queue(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	Usart *regs = arch_dev->port->regs;
+	char out[64];
+
+	/* the first write goes straight to the PDC */
+	TEST_ASSERT_EQ(write_str(arch_dev, "hello"), 5);
+	TEST_ASSERT(arch_dev->txbuf != NULL);
+	TEST_ASSERT(arch_dev->txnext == NULL);
+	TEST_ASSERT_EQ(regs->US_TCR, 5);
+	TEST_ASSERT(regs->US_IMR & US_IMR_ENDTX);
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+
+	/* the second one is queued behind it with extra room */
+	TEST_ASSERT_EQ(write_str(arch_dev, ", "), 2);
+	TEST_ASSERT(arch_dev->txnext != NULL);
+	TEST_ASSERT_EQ(arch_dev->txnext->len, CONFIG_SERIAL_TXBUFSZ);
+	TEST_ASSERT_EQ(regs->US_TNCR, 2);
+
+	/* nothing is reaped while the PDC is still working on it */
+	TEST_ASSERT_EQ(mock_usart_transmit(regs, out, 3), 3);
+	tx_reap(arch_dev);
+	TEST_ASSERT_EQ(dmabufs_live, 2);
+
+	/* the PDC switches to the queued buffer, the finished one is released */
+	TEST_ASSERT_EQ(mock_usart_transmit(regs, out + 3, 2), 2);
+	TEST_ASSERT_EQ(regs->US_TCR, 2);
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(dmabufs_live, 1);
+	TEST_ASSERT(arch_dev->txnext == NULL);
+	TEST_ASSERT_EQ(tx_kevents, 1);
+
+	/* a new write can't be merged into the buffer the PDC is sending */
+	TEST_ASSERT_EQ(write_str(arch_dev, "world"), 5);
+	TEST_ASSERT_EQ(dmabufs_live, 2);
+	TEST_ASSERT_EQ(mock_usart_transmit(regs, out + 5, sizeof(out) - 5), 7);
+	TEST_ASSERT(memcmp(out, "hello, world", 12) == 0);
+
+	/* once everything is out, ENDTX is turned off */
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(dmabufs_live, 0);
+	TEST_ASSERT(arch_dev->txbuf == NULL);
+	TEST_ASSERT(!(regs->US_IMR & US_IMR_ENDTX));
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+}
+
+static void test_tx_large(void)
+{
+	static uint8_t data[0x10000 + 16];
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	Usart *regs = arch_dev->port->regs;
+
+	/* write() and writev() both enqueue as much as US_TCR can take */
+	TEST_ASSERT_EQ(arch_serial_write(&arch_dev->device, data, sizeof(data)), 0xffff);
+	TEST_ASSERT_EQ(regs->US_TCR, 0xffff);
+
+	struct iovec iov[] = {
+		{ .iov_base = data, .iov_len = 0x8000 },
+		{ .iov_base = data, .iov_len = 0x8000 },
+	};
+	arch_dev = setup(USART0_INDEX);
+	regs = arch_dev->port->regs;
+	TEST_ASSERT_EQ(arch_serial_writev(&arch_dev->device, iov, 2), 0xffff);
+	TEST_ASSERT_EQ(regs->US_TCR, 0xffff);
+}
+
+static void test_tx_append(void)
+{
+	struct arch_serial_device *arch_dev = setup(USART0_INDEX);
+	struct serial_device *dev = &arch_dev->device;
+	Usart *regs = arch_dev->port->regs;
+	char out[2 * CONFIG_SERIAL_TXBUFSZ];
+	char data[CONFIG_SERIAL_TXBUFSZ];
+
+	TEST_ASSERT_EQ(write_str(arch_dev, "a"), 1);
+	TEST_ASSERT_EQ(write_str(arch_dev, "b"), 1);
+
+	/* small writes are merged into the queued buffer */
+	TEST_ASSERT_EQ(write_str(arch_dev, "cd"), 2);
+	TEST_ASSERT_EQ(write_str(arch_dev, "ef"), 2);
+	TEST_ASSERT_EQ(dmabufs_live, 2);
+	TEST_ASSERT_EQ(arch_dev->txnext_len, 5);
+	TEST_ASSERT_EQ(regs->US_TNCR, 5);
+	/* the PDC was paused for the append and is running again */
+	TEST_ASSERT(regs->US_PTSR & US_PTSR_TXTEN);
+
+	/* until it is full */
+	memset(data, 'x', sizeof(data));
+	TEST_ASSERT_EQ(arch_serial_write(dev, data, sizeof(data)), CONFIG_SERIAL_TXBUFSZ - 5);
+	TEST_ASSERT(!arch_serial_tx_ready(dev));
+	TEST_ASSERT_EQ(arch_serial_write(dev, data, 1), -EBUSY);
+
+	/*
+	 * The PDC takes the queued buffer before we get to append to it.
+	 * Pretend there is room left so tx_append() gets that far.
+	 */
+	TEST_ASSERT_EQ(mock_usart_transmit(regs, out, 1), 1);
+	TEST_ASSERT(arch_dev->txnext != NULL);
+	struct iovec iov = { .iov_base = data, .iov_len = 1 };
+	arch_dev->txnext_len--;
+	TEST_ASSERT_EQ(tx_append(arch_dev, &iov, 1), 0);
+	arch_dev->txnext_len++;
+	TEST_ASSERT_EQ(regs->US_TCR, CONFIG_SERIAL_TXBUFSZ);
+
+	/* a pending flow control character keeps the PDC paused after appending */
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(write_str(arch_dev, "g"), 1);
+	arch_serial_send_xchar(dev, 0x13);
+	TEST_ASSERT_EQ(write_str(arch_dev, "h"), 1);
+	TEST_ASSERT(!(regs->US_PTSR & US_PTSR_TXTEN));
+	TEST_ASSERT_EQ(mock_usart_transmit(regs, out + 1, sizeof(out) - 1), 0);
+
+	/* until TXRDY has sent it */
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(regs->mock_thr_count, 1);
+	TEST_ASSERT_EQ(regs->mock_thr_log[0], 0x13);
+	TEST_ASSERT(regs->US_PTSR & US_PTSR_TXTEN);
+
+	size_t len = 1 + mock_usart_transmit(regs, out + 1, sizeof(out) - 1);
+	TEST_ASSERT_EQ(len, 1 + CONFIG_SERIAL_TXBUFSZ + 2);
+	TEST_ASSERT(memcmp(out, "abcdefxxx", 9) == 0);
+	TEST_ASSERT(memcmp(&out[len - 2], "gh", 2) == 0);
+
+	/* a single ENDTX releases both buffers */
+	TEST_ASSERT(serial_irq_pending(arch_dev));
+	TEST_ASSERT(!serial_irq_pending(arch_dev));
+	TEST_ASSERT_EQ(dmabufs_live, 0);
+}
+
+int main(void)
+{
+	test_init();
+
+	TEST_RUN(test_baud_regs);
+	TEST_RUN(test_set_baud);
+	TEST_RUN(test_rx_idle);
+	TEST_RUN(test_uart_idle_check);
+	TEST_RUN(test_rx_switch);
+	TEST_RUN(test_rx_stopped);
+	TEST_RUN(test_rx_held);
+	TEST_RUN(test_rx_dropped);
+	TEST_RUN(test_tx_queue);
+	TEST_RUN(test_tx_large);
+	TEST_RUN(test_tx_append);
+
+	return TEST_STATUS();
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
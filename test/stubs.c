@@ -0,0 +1,195 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+/*
+ * Host replacements for the parts of the kernel that depend on the scheduler
+ * or on assembly.  The tests are single threaded, so locks only check that
+ * they are used correctly and atomic operations are plain arithmetic.
+ */
+
+#include <ardix/atom.h>
+#include <ardix/atomic.h>
+#include <ardix/device.h>
+#include <ardix/file.h>
+#include <ardix/kent.h>
+#include <ardix/malloc.h>
+#include <ardix/mutex.h>
+
+#include <arch-generic/flash.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "test.h"
+
+unsigned int test_failures = 0;
+
+static int test_atomic_level = 0;
+
+struct kent *devices_kent = NULL;
+
+static void test_devices_destroy(struct kent *kent)
+{
+	/* the root devices kent is immortal */
+	TEST_ASSERT(kent == NULL);
+}
+
+void test_init(void)
+{
+	static struct kent test_devices_kent;
+
+	if (kent_root_init() != 0)
+		return;
+
+	test_devices_kent.parent = kent_root;
+	test_devices_kent.destroy = test_devices_destroy;
+	TEST_ASSERT_EQ(kent_init(&test_devices_kent), 0);
+	devices_kent = &test_devices_kent;
+}
+
+void *kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void *atomic_kmalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void kfree(void *ptr)
+{
+	free(ptr);
+}
+
+void atomic_enter(void)
+{
+	test_atomic_level++;
+}
+
+void atomic_leave(void)
+{
+	TEST_ASSERT(test_atomic_level > 0);
+	test_atomic_level--;
+}
+
+int is_atomic(void)
+{
+	return test_atomic_level;
+}
+
+int _atom_get(int *count)
+{
+	return ++*count;
+}
+
+int _atom_put(int *count)
+{
+	return --*count;
+}
+
+int _atom_get_unless_zero(int *count)
+{
+	return *count == 0 ? 0 : ++*count;
+}
+
+void mutex_init(struct mutex *mutex)
+{
+	mutex->lock = 0;
+	spin_init(&mutex->wait_queue_lock);
+	list_init(&mutex->wait_queue);
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+	/* there is nobody else who could ever release it */
+	TEST_ASSERT(mutex->lock == 0);
+	mutex->lock = 1;
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+	TEST_ASSERT(mutex->lock != 0);
+	mutex->lock = 0;
+}
+
+int device_init(struct device *dev)
+{
+	if (dev->kent.destroy == NULL)
+		return -EFAULT;
+	if (dev->kent.parent == NULL)
+		dev->kent.parent = devices_kent;
+
+	mutex_init(&dev->lock);
+	dev->flags = 0;
+	dev->dmapool = NULL;
+	dev->read = NULL;
+	dev->write = NULL;
+	dev->writev = NULL;
+	dev->poll = NULL;
+	dev->size = NULL;
+	dev->close = NULL;
+	dev->write_dma = NULL;
+	dev->map_rx = NULL;
+	dev->tcattr = NULL;
+	dev->tcflush = NULL;
+	dev->tcstats = NULL;
+
+	return kent_init(&dev->kent);
+}
+
+static void test_file_destroy(struct kent *kent)
+{
+	struct file *file = container_of(kent, struct file, kent);
+
+	if (file->device->close != NULL)
+		file->device->close(file->device, file);
+
+	kfree(file);
+}
+
+struct file *file_create(struct device *device, enum file_type type, int *err)
+{
+	struct file *f = kmalloc(sizeof(*f));
+	if (f == NULL) {
+		*err = -ENOMEM;
+		return NULL;
+	}
+
+	f->kent.parent = &device->kent;
+	f->kent.destroy = test_file_destroy;
+	kent_init(&f->kent);
+
+	f->device = device;
+	f->pos = 0;
+	f->type = type;
+	f->flags = 0;
+	mutex_init(&f->lock);
+
+	*err = 0;
+	return f;
+}
+
+void file_put(struct file *file)
+{
+	kent_put(&file->kent);
+}
+
+/* tests install their own storage area in flash_storage */
+struct flash *arch_flash_init(void)
+{
+	return NULL;
+}
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */
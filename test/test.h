@@ -0,0 +1,62 @@
+/* See the end of this file for copyright, license, and warranty information. */
+
+#pragma once
+
+#include <stdio.h>
+
+/**
+ * @file test.h
+ * @brief Minimal harness for the host-side unit tests.
+ *
+ * Every test program is built from the kernel sources under test, `stubs.c`
+ * and a `main()` that calls `test_init()` and runs each test case with
+ * `TEST_RUN()`.  Failed assertions are reported and counted, but don't stop
+ * the test case, so a single run shows everything that is broken.
+ */
+
+extern unsigned int test_failures;
+
+/** @brief Report a failure if `expr` is false. */
+#define TEST_ASSERT(expr) do {							\
+	if (!(expr)) {								\
+		printf("%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #expr); \
+		test_failures++;						\
+	}									\
+} while (0)
+
+/** @brief Report a failure if the integers `a` and `b` are not equal. */
+#define TEST_ASSERT_EQ(a, b) do {						\
+	long long _a = (long long)(a);						\
+	long long _b = (long long)(b);						\
+	if (_a != _b) {								\
+		printf("%s:%d: assertion failed: %s == %s (%lld != %lld)\n",	\
+		       __FILE__, __LINE__, #a, #b, _a, _b);			\
+		test_failures++;						\
+	}									\
+} while (0)
+
+/** @brief Run a single test case and print its result. */
+#define TEST_RUN(fn) do {							\
+	unsigned int _failures = test_failures;					\
+	fn();									\
+	printf("%s %s\n", test_failures == _failures ? "ok    " : "FAILED", #fn); \
+} while (0)
+
+/** @brief Set up the kernel objects all tests rely on (the kent tree). */
+void test_init(void);
+
+/** @brief Exit status for `main()`. */
+#define TEST_STATUS() (test_failures == 0 ? 0 : 1)
+
+/*
+ * This file is part of Ardix.
+ * Copyright (c) 2021 Felix Kopp <owo@fef.moe>.
+ *
+ * Ardix is non-violent software: you may only use, redistribute,
+ * and/or modify it under the terms of the CNPLv6+ as found in
+ * the LICENSE file in the source code root directory or at
+ * <https://git.pixie.town/thufie/CNPL>.
+ *
+ * Ardix comes with ABSOLUTELY NO WARRANTY, to the extent
+ * permitted by applicable law.  See the CNPLv6+ for details.
+ */